@@ -525,10 +525,10 @@ void DemoState()
 	if (!animPaused)
 	#endif
 	{
-		for (int i = 0; i < renderer->AnimationCount(); i++)
+		if (renderer->AnimationCount() > 0)
 		{
-			renderer->UpdateAnimation( i, frameTime );
-			camMoved = true; // will remain false if scene has no animations
+			renderer->UpdateAnimations( frameTime );
+			camMoved = true;
 		}
 	}
 	renderer->SynchronizeSceneData();
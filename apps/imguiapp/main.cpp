@@ -252,10 +252,10 @@ int main()
 		if (hasFocus) if (HandleInput( frameTime )) camMoved = true;
 		if (HandleMaterialChange()) camMoved = true;
 		// update animations
-		if (!animPaused) for (int i = 0; i < renderer->AnimationCount(); i++)
+		if (!animPaused && renderer->AnimationCount() > 0)
 		{
-			renderer->UpdateAnimation( i, frameTime );
-			camMoved = true; // will remain false if scene has no animations
+			renderer->UpdateAnimations( frameTime );
+			camMoved = true;
 		}
 		renderer->SynchronizeSceneData();
 		// wait for rendering to complete
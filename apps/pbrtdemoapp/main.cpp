@@ -142,10 +142,10 @@ int main()
 		// poll events, may affect probepos so needs to happen between HandleInput and Render
 		glfwPollEvents();
 		// update animations
-		if (!animPaused) for (int i = 0; i < renderer->AnimationCount(); i++)
+		if (!animPaused && renderer->AnimationCount() > 0)
 		{
-			renderer->UpdateAnimation( i, deltaTime );
-			camMoved = true; // will remain false if scene has no animations
+			renderer->UpdateAnimations( deltaTime );
+			camMoved = true;
 		}
 		renderer->SynchronizeSceneData();
 		// render
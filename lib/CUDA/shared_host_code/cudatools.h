@@ -267,6 +267,12 @@ public:
 		}
 		return devPtr;
 	}
+	T* CopyToDevice( const uint64_t first, const uint64_t count )
+	{
+		// partial update of an existing device buffer
+		if (count > 0) CHK_CUDA( cudaMemcpy( devPtr + first, hostPtr + first, count * sizeof( T ), cudaMemcpyHostToDevice ) );
+		return devPtr;
+	}
 	T* StageCopyToDevice()
 	{
 		if (sizeInBytes > 0)
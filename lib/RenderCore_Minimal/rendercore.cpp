@@ -54,7 +54,80 @@ void RenderCore::SetGeometry( const int meshIdx, const float4* vertexData, const
 	// copy the supplied 'fat triangles'
 	newMesh.triangles = new CoreTri[vertexCount / 3];
 	memcpy( newMesh.triangles, triangleData, (vertexCount / 3) * sizeof( CoreTri ) );
-	meshes.push_back( newMesh );
+	// replace existing mesh data, if any
+	if (meshIdx < (int)meshes.size())
+	{
+		delete[] meshes[meshIdx].vertices;
+		delete[] meshes[meshIdx].triangles;
+		meshes[meshIdx] = newMesh;
+	}
+	else meshes.push_back( newMesh );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::UpdateGeometry                                                 |
+//  |  Update the vertex positions and normals of an existing model.        LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool RenderCore::UpdateGeometry( const int meshIdx, const float4* vertexData, const float3* vertexNormals, const int vertexCount )
+{
+	Mesh& mesh = meshes[meshIdx];
+	assert( vertexCount == mesh.vcount );
+	memcpy( mesh.vertices, vertexData, vertexCount * sizeof( float4 ) );
+	for (int i = 0; i < vertexCount / 3; i++)
+	{
+		CoreTri& tri = mesh.triangles[i];
+		tri.vertex0 = make_float3( vertexData[i * 3 + 0] );
+		tri.vertex1 = make_float3( vertexData[i * 3 + 1] );
+		tri.vertex2 = make_float3( vertexData[i * 3 + 2] );
+		const float3 N = normalize( cross( tri.vertex1 - tri.vertex0, tri.vertex2 - tri.vertex0 ) );
+		tri.Nx = N.x, tri.Ny = N.y, tri.Nz = N.z;
+		if (vertexNormals) tri.vN0 = vertexNormals[i * 3 + 0], tri.vN1 = vertexNormals[i * 3 + 1], tri.vN2 = vertexNormals[i * 3 + 2];
+	}
+	return true;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::SetLights                                                      |
+//  |  Set the light data.                                                  LH2'19|
+//  +-----------------------------------------------------------------------------+
+void RenderCore::SetLights( const CoreLightTri* triLightData, const int triLightCount,
+	const CorePointLight* pointLightData, const int pointLightCount,
+	const CoreSpotLight* spotLightData, const int spotLightCount,
+	const CoreDirectionalLight* directionalLightData, const int directionalLightCount )
+{
+	triLights.assign( triLightData, triLightData + triLightCount );
+	pointLights.assign( pointLightData, pointLightData + pointLightCount );
+	spotLights.assign( spotLightData, spotLightData + spotLightCount );
+	directionalLights.assign( directionalLightData, directionalLightData + directionalLightCount );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::UpdateTriLights etc.                                           |
+//  |  Overwrite a range of the light data received via SetLights.          LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool RenderCore::UpdateTriLights( const int first, const CoreLightTri* data, const int count )
+{
+	assert( first + count <= (int)triLights.size() );
+	memcpy( triLights.data() + first, data, count * sizeof( CoreLightTri ) );
+	return true;
+}
+bool RenderCore::UpdatePointLights( const int first, const CorePointLight* data, const int count )
+{
+	assert( first + count <= (int)pointLights.size() );
+	memcpy( pointLights.data() + first, data, count * sizeof( CorePointLight ) );
+	return true;
+}
+bool RenderCore::UpdateSpotLights( const int first, const CoreSpotLight* data, const int count )
+{
+	assert( first + count <= (int)spotLights.size() );
+	memcpy( spotLights.data() + first, data, count * sizeof( CoreSpotLight ) );
+	return true;
+}
+bool RenderCore::UpdateDirectionalLights( const int first, const CoreDirectionalLight* data, const int count )
+{
+	assert( first + count <= (int)directionalLights.size() );
+	memcpy( directionalLights.data() + first, data, count * sizeof( CoreDirectionalLight ) );
+	return true;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -41,6 +41,15 @@ public:
 	void Init();
 	void SetTarget( GLTexture* target, const uint spp );
 	void SetGeometry( const int meshIdx, const float4* vertexData, const int vertexCount, const int triangleCount, const CoreTri* triangles );
+	bool UpdateGeometry( const int meshIdx, const float4* vertexData, const float3* vertexNormals, const int vertexCount ) override;
+	void SetLights( const CoreLightTri* triLights, const int triLightCount,
+		const CorePointLight* pointLights, const int pointLightCount,
+		const CoreSpotLight* spotLights, const int spotLightCount,
+		const CoreDirectionalLight* directionalLights, const int directionalLightCount );
+	bool UpdateTriLights( const int first, const CoreLightTri* triLights, const int count ) override;
+	bool UpdatePointLights( const int first, const CorePointLight* pointLights, const int count ) override;
+	bool UpdateSpotLights( const int first, const CoreSpotLight* spotLights, const int count ) override;
+	bool UpdateDirectionalLights( const int first, const CoreDirectionalLight* directionalLights, const int count ) override;
 	void Render( const ViewPyramid& view, const Convergence converge, bool async );
 	void WaitForRender() { /* this core does not support asynchronous rendering yet */ }
 	CoreStats GetCoreStats() const override;
@@ -50,14 +59,10 @@ public:
 	inline void SetProbePos( const int2 pos ) override {}
 	inline void Setting( const char* name, float value ) override {}
 	inline void SetTextures( const CoreTexDesc* tex, const int textureCount ) override {}
+	inline bool AcceptsTexelStorage( const TexelStorage storage ) const override { return true; }
 	inline void SetMaterials( CoreMaterial* mat, const int materialCount ) override {}
-	inline void SetLights( const CoreLightTri* triLights, const int triLightCount,
-		const CorePointLight* pointLights, const int pointLightCount,
-		const CoreSpotLight* spotLights, const int spotLightCount,
-		const CoreDirectionalLight* directionalLights, const int directionalLightCount ) override
-	{
-	}
 	inline void SetSkyData( const float3* pixels, const uint width, const uint height, const mat4& worldToLight ) override {}
+	inline bool SetSkyDataHalf( const ushort* pixels, const uint width, const uint height, const mat4& worldToLight ) override { return true; }
 	inline void SetInstance( const int instanceIdx, const int modelIdx, const mat4& transform ) override {}
 	inline void FinalizeInstances() override {}
 
@@ -68,6 +73,10 @@ private:
 	Bitmap* screen = 0;								// temporary storage of RenderCore output; will be copied to render target
 	int targetTextureID = 0;						// ID of the target OpenGL texture
 	vector<Mesh> meshes;							// mesh data storage
+	vector<CoreLightTri> triLights;					// light data received via SetLights / Update*Lights
+	vector<CorePointLight> pointLights;
+	vector<CoreSpotLight> spotLights;
+	vector<CoreDirectionalLight> directionalLights;
 public:
 	CoreStats coreStats;							// rendering statistics
 };
@@ -98,6 +98,27 @@ void RenderCore::SetGeometry( const int meshIdx, const float4* vertexData, const
 		mesh->material[i] = triangles[i].material;
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::UpdateGeometry                                                 |
+//  |  Update vertex positions and normals of an existing model; topology, uvs    |
+//  |  and materials are unchanged.                                         LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool RenderCore::UpdateGeometry( const int meshIdx, const float4* vertexData, const float3* vertexNormals, const int vertexCount )
+{
+	Mesh* mesh = meshes[meshIdx];
+	assert( vertexCount == mesh->verts );
+	float3 bmin = make_float3( 1e34f ), bmax = -bmin;
+	for (int i = 0; i < vertexCount; i++)
+		mesh->pos[i] = make_float3( vertexData[i] ),
+		bmin.x = min( bmin.x, vertexData[i].x ), bmin.y = min( bmin.y, vertexData[i].y ), bmin.z = min( bmin.z, vertexData[i].z ),
+		bmax.x = max( bmax.x, vertexData[i].x ), bmax.y = max( bmax.y, vertexData[i].y ), bmax.z = max( bmax.z, vertexData[i].z );
+	mesh->bounds[0] = bmin, mesh->bounds[1] = bmax;
+	for (int i = 0; i < vertexCount / 3; i++)
+		mesh->N[i] = normalize( cross( mesh->pos[i * 3 + 1] - mesh->pos[i * 3], mesh->pos[i * 3 + 2] - mesh->pos[i * 3] ) );
+	if (vertexNormals) memcpy( mesh->norm, vertexNormals, vertexCount * sizeof( float3 ) );
+	return true;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::SetInstance                                                    |
 //  |  Set instance details.                                                LH2'19|
@@ -128,20 +149,45 @@ void RenderCore::SetInstance( const int instanceIdx, const int meshIdx, const ma
 
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::SetTextures                                                    |
-//  |  Set the texture data.                                                LH2'19|
+//  |  Set the texture data. HDR textures are clamped to 8 bits; compressed       |
+//  |  textures are decoded. Textures with an unchanged CoreTexDesc::version are  |
+//  |  skipped.                                                             LH2'20|
 //  +-----------------------------------------------------------------------------+
 void RenderCore::SetTextures( const CoreTexDesc* tex, const int textures )
 {
 	// copy the supplied array of texture descriptors
+	textureVersion.resize( textures, 0 );
 	for (int i = 0; i < textures; i++)
 	{
 		Texture* t;
 		if (i < rasterizer.scene.texList.size()) t = rasterizer.scene.texList[i];
 		else rasterizer.scene.texList.push_back( t = new Texture() );
+		if (t->pixels && tex[i].version == textureVersion[i] && tex[i].version > 0) continue;
+		textureVersion[i] = tex[i].version;
+		FREE64( t->pixels );
 		t->pixels = (uint*)MALLOC64( tex[i].pixelCount * sizeof( uint ) );
-		if (tex[i].idata) memcpy( t->pixels, tex[i].idata, tex[i].pixelCount * sizeof( uint ) );
-		else memcpy( t->pixels, 0, tex[i].pixelCount * sizeof( uint ) /* assume integer textures */ );
 		t->width = tex[i].width, t->height = tex[i].height;
+		if (IsBlockCompressed( tex[i].storage ))
+		{
+			// base level only, as below
+			DecodeBCLevel( tex[i].bdata, t->width, t->height, tex[i].storage, t->pixels );
+			continue;
+		}
+		if (tex[i].storage != TexelStorage::ARGB64 && tex[i].storage != TexelStorage::ARGB128)
+		{
+			memcpy( t->pixels, tex[i].idata, tex[i].pixelCount * sizeof( uint ) );
+			continue;
+		}
+		// base level only; the rasterizer does not use MIP levels
+		const uint texels = t->width * t->height;
+		vector<float4> hdr( texels );
+		if (tex[i].storage == TexelStorage::ARGB64) HalfToFloat( tex[i].hdata, (float*)hdr.data(), texels * 4 );
+		else memcpy( hdr.data(), tex[i].fdata, texels * sizeof( float4 ) );
+		for (uint j = 0; j < texels; j++)
+		{
+			const float4 c = clamp( hdr[j], 0.0f, 1.0f ) * 255.0f;
+			t->pixels[j] = (uint)c.x + ((uint)c.y << 8) + ((uint)c.z << 16) + ((uint)c.w << 24);
+		}
 	}
 }
 
@@ -175,14 +221,46 @@ void RenderCore::SetMaterials( CoreMaterial* mat, const int materialCount )
 
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::SetLights                                                      |
-//  |  Set the light data.                                                  LH2'19|
+//  |  Set the light data. Stored for future use; not used for shading yet. LH2'19|
 //  +-----------------------------------------------------------------------------+
-void RenderCore::SetLights( const CoreLightTri* triLights, const int triLightCount,
-	const CorePointLight* pointLights, const int pointLightCount,
-	const CoreSpotLight* spotLights, const int spotLightCount,
-	const CoreDirectionalLight* directionalLights, const int directionalLightCount )
+void RenderCore::SetLights( const CoreLightTri* triLightData, const int triLightCount,
+	const CorePointLight* pointLightData, const int pointLightCount,
+	const CoreSpotLight* spotLightData, const int spotLightCount,
+	const CoreDirectionalLight* directionalLightData, const int directionalLightCount )
 {
-	// not supported yet
+	triLights.assign( triLightData, triLightData + triLightCount );
+	pointLights.assign( pointLightData, pointLightData + pointLightCount );
+	spotLights.assign( spotLightData, spotLightData + spotLightCount );
+	directionalLights.assign( directionalLightData, directionalLightData + directionalLightCount );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::UpdateTriLights etc.                                           |
+//  |  Overwrite a range of the light data received via SetLights.          LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool RenderCore::UpdateTriLights( const int first, const CoreLightTri* data, const int count )
+{
+	assert( first + count <= (int)triLights.size() );
+	memcpy( triLights.data() + first, data, count * sizeof( CoreLightTri ) );
+	return true;
+}
+bool RenderCore::UpdatePointLights( const int first, const CorePointLight* data, const int count )
+{
+	assert( first + count <= (int)pointLights.size() );
+	memcpy( pointLights.data() + first, data, count * sizeof( CorePointLight ) );
+	return true;
+}
+bool RenderCore::UpdateSpotLights( const int first, const CoreSpotLight* data, const int count )
+{
+	assert( first + count <= (int)spotLights.size() );
+	memcpy( spotLights.data() + first, data, count * sizeof( CoreSpotLight ) );
+	return true;
+}
+bool RenderCore::UpdateDirectionalLights( const int first, const CoreDirectionalLight* data, const int count )
+{
+	assert( first + count <= (int)directionalLights.size() );
+	memcpy( directionalLights.data() + first, data, count * sizeof( CoreDirectionalLight ) );
+	return true;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -194,6 +272,16 @@ void RenderCore::SetSkyData( const float3* pixels, const uint width, const uint
 	// not supported yet
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  RenderCore::SetSkyDataHalf                                                 |
+//  |  Set the sky dome data, RGBA16F.                                      LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool RenderCore::SetSkyDataHalf( const ushort* pixels, const uint width, const uint height, const mat4& /* worldToLight */ )
+{
+	// not supported yet; no need to expand the data
+	return true;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::Setting                                                        |
 //  |  Modify a render setting.                                             LH2'19|
@@ -46,17 +46,25 @@ public:
 	// passing data. Note: RenderCore always copies what it needs; the passed data thus remains the
 	// property of the caller, and can be safely deleted or modified as soon as these calls return.
 	void SetTextures( const CoreTexDesc* tex, const int textureCount );
+	bool AcceptsTexelStorage( const TexelStorage storage ) const override { return true; }
+	bool SkipsUnchangedTextures() const override { return true; }
 	void SetMaterials( CoreMaterial* mat, const int materialCount ); // textures must be in sync when calling this
 	void SetLights( const CoreLightTri* triLights, const int triLightCount,
 		const CorePointLight* pointLights, const int pointLightCount,
 		const CoreSpotLight* spotLights, const int spotLightCount,
 		const CoreDirectionalLight* directionalLights, const int directionalLightCount );
+	bool UpdateTriLights( const int first, const CoreLightTri* triLights, const int count ) override;
+	bool UpdatePointLights( const int first, const CorePointLight* pointLights, const int count ) override;
+	bool UpdateSpotLights( const int first, const CoreSpotLight* spotLights, const int count ) override;
+	bool UpdateDirectionalLights( const int first, const CoreDirectionalLight* directionalLights, const int count ) override;
 	void SetSkyData( const float3* pixels, const uint width, const uint height, const mat4& worldToLight );
+	bool SetSkyDataHalf( const ushort* pixels, const uint width, const uint height, const mat4& worldToLight ) override;
 	// geometry and instances:
 	// a scene is setup by first passing a number of meshes (geometry), then a number of instances.
 	// note that stored meshes can be used zero, one or multiple times in the scene.
 	// also note that, when using alpha flags, materials must be in sync.
 	void SetGeometry( const int meshIdx, const float4* vertexData, const int vertexCount, const int triangleCount, const CoreTri* triangles );
+	bool UpdateGeometry( const int meshIdx, const float4* vertexData, const float3* vertexNormals, const int vertexCount ) override;
 	void SetInstance( const int instanceIdx, const int modelIdx, const mat4& transform );
 	void FinalizeInstances() { /* not needed for the software rasterizer */ }
 	void SetProbePos( const int2 pos );
@@ -71,8 +79,13 @@ private:
 	int maxPixels = 0;								// max screen size buffers can accomodate without a realloc
 	int2 probePos = make_int2( 0 );					// triangle picking; primary ray for this pixel copies its triid to coreStats.probedTriid
 	int textureCount = 0;							// size of texture descriptor array
+	vector<uint> textureVersion;					// per texture: CoreTexDesc::version of the copied texels
 	Rasterizer rasterizer;							// rasterization functionality
 	vector<Mesh*> meshes;							// list of meshes, for easy access in SetGeometry
+	vector<CoreLightTri> triLights;					// light data received via SetLights / Update*Lights
+	vector<CorePointLight> pointLights;
+	vector<CoreSpotLight> spotLights;
+	vector<CoreDirectionalLight> directionalLights;
 public:
 	CoreStats coreStats;							// rendering statistics
 };
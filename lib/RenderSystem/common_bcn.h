@@ -0,0 +1,196 @@
+/* common_bcn.h - Copyright 2019/2021 Utrecht University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	   http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   In this file: decoding of block compressed (BC1/3/5/7) texels, for the
+   RenderSystem and CPU cores. Texels are 32-bit, with channel 0 (red, or
+   normal x) in the lowest byte. The encoder is in host_texture.cpp.
+*/
+
+#pragma once
+
+namespace lighthouse2
+{
+
+inline bool IsBlockCompressed( const TexelStorage storage ) { return storage >= TexelStorage::BC1 && storage <= TexelStorage::BC7; }
+inline uint BCBlockBytes( const TexelStorage storage ) { return storage == TexelStorage::BC1 ? 8 : 16; }
+inline size_t BCLevelBytes( const uint width, const uint height, const TexelStorage storage )
+{
+	return (size_t)((width + 3) >> 2) * ((height + 3) >> 2) * BCBlockBytes( storage );
+}
+
+// BC1 color palette; 4-color mode if c0 > c1, else 3 colors and transparent black
+inline void BC1Palette( const uchar* block, uint palette[4], const bool forceFourColors )
+{
+	const uint c0 = block[0] + (block[1] << 8), c1 = block[2] + (block[3] << 8);
+	int p[4][3];
+	p[0][0] = ((c0 >> 11) << 3) | (c0 >> 13), p[0][1] = (((c0 >> 5) & 63) << 2) | ((c0 >> 9) & 3), p[0][2] = ((c0 & 31) << 3) | ((c0 >> 2) & 7);
+	p[1][0] = ((c1 >> 11) << 3) | (c1 >> 13), p[1][1] = (((c1 >> 5) & 63) << 2) | ((c1 >> 9) & 3), p[1][2] = ((c1 & 31) << 3) | ((c1 >> 2) & 7);
+	const bool fourColors = forceFourColors || c0 > c1;
+	for (int c = 0; c < 3; c++)
+	{
+		if (fourColors) p[2][c] = (2 * p[0][c] + p[1][c]) / 3, p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+		else p[2][c] = (p[0][c] + p[1][c]) / 2, p[3][c] = 0;
+	}
+	for (int i = 0; i < 4; i++) palette[i] = p[i][0] + (p[i][1] << 8) + (p[i][2] << 16) + (fourColors || i < 3 ? 0xff000000 : 0);
+}
+
+// BC4 single channel palette; 8 values if a0 > a1, else 6 values, 0 and 255
+inline void BC4Palette( const uchar* block, uchar palette[8] )
+{
+	const int a0 = block[0], a1 = block[1];
+	palette[0] = a0, palette[1] = a1;
+	if (a0 > a1) for (int i = 2; i < 8; i++) palette[i] = (uchar)(((8 - i) * a0 + (i - 1) * a1) / 7);
+	else
+	{
+		for (int i = 2; i < 6; i++) palette[i] = (uchar)(((6 - i) * a0 + (i - 1) * a1) / 5);
+		palette[6] = 0, palette[7] = 255;
+	}
+}
+
+// expand the 3-bit indices of a BC4 block to one byte per texel, placed at byte 'channel' of each 32-bit texel
+inline void BC4Shuffles( const uchar* block, const int channel, __m128i rows[4] )
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++) bits |= (uint64_t)block[2 + i] << (8 * i);
+	for (int r = 0; r < 4; r++)
+	{
+		uint mask[4];
+		for (int k = 0; k < 4; k++) mask[k] = (0x80808080u & ~(0xffu << (8 * channel))) | ((uint)((bits >> (3 * (r * 4 + k))) & 7) << (8 * channel));
+		rows[r] = _mm_loadu_si128( (const __m128i*)mask );
+	}
+}
+
+// BC1 color block; one byte shuffle per row of four texels
+inline void DecodeBC1Colors( const uchar* block, uint* out, const int pitch, const bool forceFourColors )
+{
+	uint palette[4];
+	BC1Palette( block, palette, forceFourColors );
+	const __m128i colors = _mm_loadu_si128( (const __m128i*)palette );
+	for (int r = 0; r < 4; r++)
+	{
+		const uint bits = block[4 + r];
+		const __m128i index = _mm_setr_epi32( bits & 3, (bits >> 2) & 3, (bits >> 4) & 3, bits >> 6 );
+		const __m128i mask = _mm_add_epi32( _mm_mullo_epi32( index, _mm_set1_epi32( 0x04040404 ) ), _mm_set1_epi32( 0x03020100 ) );
+		_mm_storeu_si128( (__m128i*)(out + r * pitch), _mm_shuffle_epi8( colors, mask ) );
+	}
+}
+
+// BC4 channel; replaces byte 'channel' of the texels in 'out'
+inline void DecodeBC4Channel( const uchar* block, const int channel, uint* out, const int pitch )
+{
+	uchar palette[16] = {};
+	BC4Palette( block, palette );
+	const __m128i values = _mm_loadu_si128( (const __m128i*)palette ), keep = _mm_set1_epi32( ~(0xff << (8 * channel)) );
+	__m128i rows[4];
+	BC4Shuffles( block, channel, rows );
+	for (int r = 0; r < 4; r++)
+	{
+		__m128i* row = (__m128i*)(out + r * pitch);
+		_mm_storeu_si128( row, _mm_or_si128( _mm_and_si128( _mm_loadu_si128( row ), keep ), _mm_shuffle_epi8( values, rows[r] ) ) );
+	}
+}
+
+// BC7; mode 6 only (one subset, RGBA, 4-bit indices), which is what the encoder writes. Other modes decode to black.
+inline void DecodeBC7Block( const uchar* block, uint* out, const int pitch )
+{
+	uint64_t lo, hi;
+	memcpy( &lo, block, 8 ), memcpy( &hi, block + 8, 8 );
+	if ((lo & 127) != 64)
+	{
+		for (int r = 0; r < 4; r++) memset( out + r * pitch, 0, 16 );
+		return;
+	}
+	int e[2][4];
+	for (int c = 0; c < 4; c++) for (int j = 0; j < 2; j++) e[j][c] = (int)((lo >> (7 + c * 14 + j * 7)) & 127) << 1;
+	const int p0 = (int)((lo >> 63) & 1), p1 = (int)(hi & 1);
+	for (int c = 0; c < 4; c++) e[0][c] |= p0, e[1][c] |= p1;
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	uint palette[16];
+	for (int i = 0; i < 16; i++)
+	{
+		palette[i] = 0;
+		for (int c = 0; c < 4; c++) palette[i] += (uint)(((64 - weights[i]) * e[0][c] + weights[i] * e[1][c] + 32) >> 6) << (8 * c);
+	}
+	// indices start at bit 65; the anchor index has 3 bits
+	const uint64_t bits = hi >> 1;
+	for (int i = 0, shift = 0; i < 16; i++)
+	{
+		const int width = i == 0 ? 3 : 4;
+		out[(i >> 2) * pitch + (i & 3)] = palette[(bits >> shift) & ((1 << width) - 1)];
+		shift += width;
+	}
+}
+
+// normal z from x and y, for BC5 normal maps
+inline void BC5ReconstructZ( uint* out, const int pitch )
+{
+	const __m128 scale = _mm_set1_ps( 2.0f / 255 ), one = _mm_set1_ps( 1 ), half255 = _mm_set1_ps( 127.5f );
+	const __m128i byteMask = _mm_set1_epi32( 255 );
+	for (int r = 0; r < 4; r++)
+	{
+		__m128i* row = (__m128i*)(out + r * pitch);
+		const __m128i t = _mm_loadu_si128( row );
+		const __m128 x = _mm_sub_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( t, byteMask ) ), scale ), one );
+		const __m128 y = _mm_sub_ps( _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( t, 8 ), byteMask ) ), scale ), one );
+		const __m128 z = _mm_sqrt_ps( _mm_max_ps( _mm_setzero_ps(), _mm_sub_ps( _mm_sub_ps( one, _mm_mul_ps( x, x ) ), _mm_mul_ps( y, y ) ) ) );
+		const __m128i zb = _mm_cvtps_epi32( _mm_add_ps( _mm_mul_ps( z, half255 ), half255 ) );
+		_mm_storeu_si128( row, _mm_or_si128( _mm_and_si128( t, _mm_set1_epi32( 0xffff ) ), _mm_or_si128( _mm_slli_epi32( zb, 16 ), _mm_set1_epi32( 0xff000000 ) ) ) );
+	}
+}
+
+// decode one 4x4 block; rows of 'out' are 'pitch' texels apart
+inline void DecodeBCBlock( const uchar* block, const TexelStorage storage, uint* out, const int pitch )
+{
+	switch (storage)
+	{
+	case TexelStorage::BC1: DecodeBC1Colors( block, out, pitch, false ); break;
+	case TexelStorage::BC3: DecodeBC1Colors( block + 8, out, pitch, true ); DecodeBC4Channel( block, 3, out, pitch ); break;
+	case TexelStorage::BC5:
+		for (int r = 0; r < 4; r++) memset( out + r * pitch, 0, 16 );
+		DecodeBC4Channel( block, 0, out, pitch );
+		DecodeBC4Channel( block + 8, 1, out, pitch );
+		BC5ReconstructZ( out, pitch );
+		break;
+	case TexelStorage::BC7: DecodeBC7Block( block, out, pitch ); break;
+	default: break;
+	}
+}
+
+// decode a full level; 'out' holds width * height texels
+inline void DecodeBCLevel( const uchar* blocks, const uint width, const uint height, const TexelStorage storage, uint* out )
+{
+	const uint blockBytes = BCBlockBytes( storage ), bw = (width + 3) >> 2, bh = (height + 3) >> 2;
+	uint tile[16];
+	for (uint by = 0; by < bh; by++) for (uint bx = 0; bx < bw; bx++)
+	{
+		const uchar* block = blocks + (by * bw + bx) * blockBytes;
+		const uint x = bx * 4, y = by * 4;
+		if (x + 4 <= width && y + 4 <= height) { DecodeBCBlock( block, storage, out + x + y * width, width ); continue; }
+		// partial block at the right or bottom edge
+		DecodeBCBlock( block, storage, tile, 4 );
+		for (uint v = 0; v < 4 && y + v < height; v++) for (uint u = 0; u < 4 && x + u < width; u++) out[x + u + (y + v) * width] = tile[u + v * 4];
+	}
+}
+
+// fetch a single texel, e.g. for sampling compressed data directly
+inline uint FetchBCTexel( const uchar* blocks, const uint width, const TexelStorage storage, const uint x, const uint y )
+{
+	uint tile[16];
+	DecodeBCBlock( blocks + ((y >> 2) * ((width + 3) >> 2) + (x >> 2)) * BCBlockBytes( storage ), storage, tile, 4 );
+	return tile[(x & 3) + (y & 3) * 4];
+}
+
+} // namespace lighthouse2
+
+// EOF
@@ -331,13 +331,18 @@ enum TexelStorage
 {
 	ARGB32 = 0,									// regular texture data, RenderCore::texel32data
 	ARGB128,									// hdr texture data, RenderCore::texel128data
-	NRM32										// int32 encoded normal map data, RenderCore::normal32data
+	NRM32,										// int32 encoded normal map data, RenderCore::normal32data
+	ARGB64,										// hdr texture data, RGBA16F; see CoreAPI_Base::AcceptsTexelStorage
+	BC1,										// block compressed texture data, see common_bcn.h; opaque color
+	BC3,										// color with alpha
+	BC5,										// normal map, x and y
+	BC7											// color with alpha, high quality
 };
 struct CoreTexDesc
 {
 	// This structure will never be stored on the GPU. RenderCore will use this to free the RenderSystem of
 	// the burden of maintaining the continuous arrays of texel data, which really is a RenderCore job.
-	union { float4* fdata; uchar4* idata; }; // points to the texel data in the original texture
+	union { float4* fdata; uchar4* idata; ushort* hdata; uchar* bdata; }; // points to the texel data in the original texture
 #ifdef __CLORCUDA__
 	// skip initial values in device code
 	uint pixelCount;							// width and height are irrelevant; already stored with material
@@ -355,9 +360,29 @@ struct CoreTexDesc
 	uint firstPixel = 0;						// start in continuous storage of the texture
 	uint MIPlevels = 1;							// number of MIP levels
 	TexelStorage storage = ARGB32;
+	uint version = 0;							// changes when the texels change; see TexelPool
 #endif
 };
 
+//  +-----------------------------------------------------------------------------+
+//  |  SkyAliasEntry                                                              |
+//  |  Walker / Vose alias table entry, for importance sampling the sky dome in   |
+//  |  constant time. The table has IBLHEIGHT row entries, followed by IBLWIDTH   |
+//  |  column entries for each row. To sample: pick a row r uniformly; keep it if |
+//  |  a uniform random number is below 'threshold', otherwise use 'alias'. Then  |
+//  |  pick a column in the same way in the entries of row r. 'pdf' is the        |
+//  |  probability of the entry relative to a uniform choice; for a cell, the     |
+//  |  product of the row and column values is its pdf over the unit square.      |
+//  |                                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+struct SkyAliasEntry
+{
+	float threshold;							// probability of keeping this entry
+	uint alias;									// alternative entry
+	float pdf;									// relative probability of this entry
+	float dummy;
+};
+
 //  +-----------------------------------------------------------------------------+
 //  |  CoreLightTri - see HostTriLight for host-side version.                     |
 //  |  Data layout for a light emitting triangle.                           LH2'19|
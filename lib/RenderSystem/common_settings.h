@@ -28,12 +28,7 @@
 #define SCRHEIGHT			768
 
 // skydome defines
-// #define IBL						// calculate pdf and cdf for ibl renderer
 // #define TESTSKY					// red/green/blue area lights for debugging
-#define IBLWIDTH			512
-#define IBLHEIGHT			256
-#define IBLWBITS			9
-#define IBLHBITS			8
 
 // PNEE settings
 #define PHOTONCOUNT			5000000
@@ -54,10 +49,12 @@
 #define MINROUGHNESS		0.0001f	// minimal GGX roughness
 #define BLACK				make_float3( 0 )
 #define WHITE				make_float3( 1 )
-#define MIPLEVELCOUNT		5
+#define MIPLEVELCOUNT		5	// MIP levels used by texture sampling; host textures store the full chain
+#define IBLWIDTH			512	// resolution of the sky dome importance sampling table
+#define IBLHEIGHT			256
 
 // file format versions
-#define BINTEXFILEVERSION	0x10001001
+#define BINTEXFILEVERSION	0x10001004
 
 // tools
 
@@ -0,0 +1,103 @@
+/* common_texelpool.h - Copyright 2019/2021 Utrecht University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	   http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+   In this file: suballocation of a continuous texel array, for cores that
+   store the texels of all textures of one storage type in a single buffer.
+*/
+
+#pragma once
+
+namespace lighthouse2
+{
+
+//  +-----------------------------------------------------------------------------+
+//  |  TexelPool                                                                  |
+//  |  Hands out ranges of a continuous texel array, one per texture slot.        |
+//  |  Ranges are rounded up to size classes, four per power of two; a freed      |
+//  |  range is reused by the next texture of the same class. Offsets therefore   |
+//  |  never move, and a core only copies the textures for which Place returns    |
+//  |  true, using CoreTexDesc::version to skip unchanged ones. When Size grows   |
+//  |  beyond the capacity of the core's buffer, the buffer must be enlarged;     |
+//  |  the existing contents stay valid at the same offsets.                LH2'20|
+//  +-----------------------------------------------------------------------------+
+class TexelPool
+{
+public:
+	// find a range for the texels of 'slot'; returns true if they must be copied to Offset( slot )
+	bool Place( const int slot, const uint count, const uint version )
+	{
+		if (slot >= (int)slots.size()) slots.resize( slot + 1 );
+		Slot& s = slots[slot];
+		if (s.size > 0 && s.count == count && s.version == version) return false;
+		const uint size = SizeClass( count );
+		if (s.size != size)
+		{
+			Release( s );
+			s.offset = Allocate( size ), s.size = size;
+		}
+		s.count = count, s.version = version;
+		return true;
+	}
+	// texture 'slot' no longer uses this pool, e.g. because its storage type changed
+	void Remove( const int slot ) { if (slot < (int)slots.size()) Release( slots[slot] ); }
+	// forget the slots of textures that were removed from the scene
+	void Trim( const int slotCount )
+	{
+		for (int i = slotCount; i < (int)slots.size(); i++) Release( slots[i] );
+		if (slotCount < (int)slots.size()) slots.resize( slotCount );
+	}
+	uint Offset( const int slot ) const { return slots[slot].offset; }
+	uint Size() const { return top; }			// texels in use or free; minimum capacity of the buffer
+	static uint SizeClass( const uint count )
+	{
+		if (count <= minClass) return minClass;
+		uint p = minClass;
+		while (p <= count / 2) p <<= 1;			// largest power of two not above 'count'
+		const uint step = p >> 2;
+		return (count + step - 1) / step * step;
+	}
+	static constexpr uint minClass = 256;		// smallest range, in texels
+private:
+	struct Slot
+	{
+		uint offset = 0, size = 0;				// range in the texel array; size 0: no range
+		uint count = 0, version = 0;			// texels and CoreTexDesc::version at the last copy
+	};
+	uint Allocate( const uint size )
+	{
+		auto free = freeRanges.find( size );
+		if (free == freeRanges.end() || free->second.size() == 0)
+		{
+			const uint offset = top;
+			top += size;
+			return offset;
+		}
+		const uint offset = free->second.back();
+		free->second.pop_back();
+		return offset;
+	}
+	void Release( Slot& s )
+	{
+		if (s.size > 0) freeRanges[s.size].push_back( s.offset );
+		s = Slot();
+	}
+	// data members
+	vector<Slot> slots;							// per texture
+	map<uint, vector<uint>> freeRanges;			// size class to offsets of free ranges
+	uint top = 0;								// end of the used part of the texel array
+};
+
+} // namespace lighthouse2
+
+// EOF
@@ -72,6 +72,8 @@ struct SystemStats
 {
 	// scene
 	float sceneUpdateTime = 0;			// time spent updating the scene graph
+	size_t textureBytes = 0;			// texels in host memory
+	size_t releasedTextureBytes = 0;	// texels dropped from host memory after upload, see HostTexture::releaseAfterUpload
 };
 
 //  +-----------------------------------------------------------------------------+
@@ -101,6 +103,16 @@ public:
 	virtual void Shutdown() = 0;
 	// SetTextures: update the texture data in the RenderCore using the supplied data.
 	virtual void SetTextures( const CoreTexDesc* tex, const int textureCount ) = 0;
+	// AcceptsTexelStorage: true if the core handles textures with the specified storage. Half precision (ARGB64) textures are
+	// sent as ARGB128 to cores that do not take them, without MIP levels; block compressed textures are decoded to ARGB32
+	// or NRM32. By default, a core takes the uncompressed storage types only.
+	virtual bool AcceptsTexelStorage( const TexelStorage storage ) const
+	{
+		return storage == TexelStorage::ARGB32 || storage == TexelStorage::ARGB128 || storage == TexelStorage::NRM32;
+	}
+	// SkipsUnchangedTextures: true if SetTextures ignores the texels of textures with an unchanged CoreTexDesc::version. The
+	// texel pointers of those textures are then null, so the host texels may be released, see HostTexture::releaseAfterUpload.
+	virtual bool SkipsUnchangedTextures() const { return false; }
 	// SetMaterials: update the material list used by the RenderCore. Textures referenced by the materials must be set in advance.
 	virtual void SetMaterials( CoreMaterial* mat, const int materialCount ) = 0;
 	// SetLights: update the point lights, spot lights and directional lights.
@@ -108,10 +120,27 @@ public:
 		const CorePointLight* pointLights, const int pointLightCount,
 		const CoreSpotLight* spotLights, const int spotLightCount,
 		const CoreDirectionalLight* directionalLights, const int directionalLightCount ) = 0;
+	// Update*Lights: overwrite 'count' lights, starting at 'first', in the light arrays received via SetLights. The number of
+	// lights does not change. A core that returns false does not support partial updates; it will receive SetLights instead.
+	virtual bool UpdateTriLights( const int first, const CoreLightTri* triLights, const int count ) { return false; }
+	virtual bool UpdatePointLights( const int first, const CorePointLight* pointLights, const int count ) { return false; }
+	virtual bool UpdateSpotLights( const int first, const CoreSpotLight* spotLights, const int count ) { return false; }
+	virtual bool UpdateDirectionalLights( const int first, const CoreDirectionalLight* directionalLights, const int count ) { return false; }
 	// SetSkyData: specify the data required for sky dome rendering.
 	virtual void SetSkyData( const float3* pixels, const uint width, const uint height, const mat4& worldToLight = mat4() ) = 0;
+	// SetSkyDataHalf: as SetSkyData, for RGBA16F pixels. Returns false if the core does not support this; the sky will then be
+	// expanded and sent via SetSkyData.
+	virtual bool SetSkyDataHalf( const ushort* pixels, const uint width, const uint height, const mat4& worldToLight = mat4() ) { return false; }
+	// SetSkySampler: importance sampling table for the sky dome, see SkyAliasEntry. The table is only built for cores that
+	// return true from WantsSkySampler.
+	virtual bool WantsSkySampler() const { return false; }
+	virtual void SetSkySampler( const SkyAliasEntry* table, const uint width, const uint height ) {}
 	// SetGeometry: update the geometry for a single mesh.
 	virtual void SetGeometry( const int meshIdx, const float4* vertexData, const int vertexCount, const int triangleCount, const CoreTri* triangles ) = 0;
+	// UpdateGeometry: replace the vertex positions and, if not null, vertex normals of a mesh received earlier via SetGeometry.
+	// Topology, uvs and materials are unchanged; face normals follow from the new positions. Returns false if the core does not
+	// support this; the mesh will then be sent via SetGeometry.
+	virtual bool UpdateGeometry( const int meshIdx, const float4* vertexData, const float3* vertexNormals, const int vertexCount ) { return false; }
 	// SetInstance: update the data on a single instance.
 	virtual void SetInstance( const int instanceIdx, const int modelIdx, const mat4& transform = mat4::Identity() ) = 0;
 	// FinalizeInstances: allow the core to do any finalizing work after receiving all geometry and instances.
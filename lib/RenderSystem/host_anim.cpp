@@ -53,7 +53,7 @@ void HostAnimation::Sampler::ConvertFromGLTFSampler( const tinygltfAnimationSamp
 		// b is an array of floats (for scale or translation)
 		float* f = (float*)b;
 		const int N = (int)outputAccessor.count;
-		for (int i = 0; i < N; i++) vec3Key.push_back( make_float3( f[i * 3], f[i * 3 + 1], f[i * 3 + 2] ) );
+		for (int i = 0; i < N; i++) key.push_back( make_float4( f[i * 3], f[i * 3 + 1], f[i * 3 + 2], 0 ) );
 	}
 	else if (outputAccessor.type == TINYGLTF_TYPE_SCALAR)
 	{
@@ -83,192 +83,271 @@ void HostAnimation::Sampler::ConvertFromGLTFSampler( const tinygltfAnimationSamp
 		case TINYGLTF_COMPONENT_TYPE_SHORT: for (int k = 0; k < N; k++, b += 2) fdata.push_back( max( *((char*)b) / 32767.0f, -1.0f ) ); break;
 		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: for (int k = 0; k < N; k++, b += 2) fdata.push_back( *((char*)b) / 65535.0f ); break;
 		}
-		for (int i = 0; i < outputAccessor.count; i++) vec4Key.push_back( quat( fdata[i * 4 + 3], fdata[i * 4], fdata[i * 4 + 1], fdata[i * 4 + 2] ) );
+		for (int i = 0; i < outputAccessor.count; i++) key.push_back( make_float4( fdata[i * 4], fdata[i * 4 + 1], fdata[i * 4 + 2], fdata[i * 4 + 3] ) );
 	}
 	else assert( false );
 }
 
 //  +-----------------------------------------------------------------------------+
-//  |  Sampler::SampleFloat, SampleVec3, SampleVec4                               |
-//  |  Get a value from the sampler.                                        LH2'19|
+//  |  HostAnimation::Channel::Channel                                            |
+//  |  Constructor.                                                         LH2'19|
 //  +-----------------------------------------------------------------------------+
-float HostAnimation::Sampler::SampleFloat( float currentTime, int k, int i, int count ) const
+HostAnimation::Channel::Channel( const tinygltfAnimationChannel& gltfChannel, const tinygltfModel& gltfModel, const int nodeBase )
 {
-	// handle valid out-of-bounds
-	if (k == 0 && currentTime < t[0]) return interpolation == SPLINE ? floatKey[1] : floatKey[0];
-	// determine interpolation parameters
-	const float t0 = t[k], t1 = t[k + 1];
-	const float f = (currentTime - t0) / (t1 - t0);
-	// sample
-	if (f <= 0) return floatKey[0]; switch (interpolation)
-	{
-	case SPLINE:
+	ConvertFromGLTFChannel( gltfChannel, gltfModel, nodeBase );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Channel::ConvertFromGLTFChannel                             |
+//  |  Convert a gltf animation channel.                                    LH2'19|
+//  +-----------------------------------------------------------------------------+
+void HostAnimation::Channel::ConvertFromGLTFChannel( const tinygltfAnimationChannel& gltfChannel, const tinygltfModel& gltfModel, const int nodeBase )
+{
+	samplerIdx = gltfChannel.sampler;
+	nodeIdx = gltfChannel.target_node + nodeBase;
+	if (gltfChannel.target_path.compare( "translation" ) == 0) target = 0;
+	if (gltfChannel.target_path.compare( "rotation" ) == 0) target = 1;
+	if (gltfChannel.target_path.compare( "scale" ) == 0) target = 2;
+	if (gltfChannel.target_path.compare( "weights" ) == 0) target = 3;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Channel::Advance                                            |
+//  |  Advance channel animation time and locate the current key frame.     LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostAnimation::Channel::Advance( const float dt, const Sampler* sampler )
+{
+	if (baked.frames > 0)
 	{
-		const float t = f, t2 = t * t, t3 = t2 * t;
-		const float p0 = floatKey[(k * count + i) * 3 + 1];
-		const float m0 = (t1 - t0) * floatKey[(k * count + i) * 3 + 2];
-		const float p1 = floatKey[((k + 1) * count + i) * 3 + 1];
-		const float m1 = (t1 - t0) * floatKey[((k + 1) * count + i) * 3];
-		return m0 * (t3 - 2 * t2 + t) + p0 * (2 * t3 - 3 * t2 + 1) + p1 * (-2 * t3 + 3 * t2) + m1 * (t3 - t2);
+		// baked track: samples are at a fixed rate, no key frame search needed
+		if (baked.duration == 0) return;
+		t = fmodf( t + dt, baked.duration );
+		if (t < 0) t += baked.duration;
+		return;
 	}
-	case Sampler::STEP:
-		return floatKey[k];
-	default:
-		return (1 - f) * floatKey[k * count + i] + f * floatKey[(k + 1) * count + i];
-	};
+	const vector<float>& keyTime = sampler->t;
+	const int keyCount = (int)keyTime.size();
+	const float animDuration = keyTime[keyCount - 1];
+	if (animDuration == 0 /* book scene */ || keyCount == 1 /* bird */) { k = -1; return; }
+	// advance animation timer
+	t += dt;
+	if (t >= animDuration || t < 0) { t = fmodf( t, animDuration ); if (t < 0) t += animDuration; }
+	Locate( sampler );
 }
-float3 HostAnimation::Sampler::SampleVec3( float currentTime, int k ) const
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Channel::Locate                                             |
+//  |  Find the key frame for the current time. The key frame is cached between   |
+//  |  calls: normally the time is still in the same interval, or in the next     |
+//  |  one. Otherwise (seek, wrap-around, large time steps) a binary search is    |
+//  |  used.                                                                LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostAnimation::Channel::Locate( const Sampler* sampler )
+{
+	const vector<float>& keyTime = sampler->t;
+	const int keyCount = (int)keyTime.size();
+	if (keyCount == 1 || keyTime[keyCount - 1] == 0) { k = -1; return; }
+	// try the cached key frame and its successor
+	if (k < 0 || k > keyCount - 2) k = 0;
+	if (t >= keyTime[k] && t < keyTime[k + 1]) return;
+	if (k + 2 < keyCount && t >= keyTime[k + 1] && t < keyTime[k + 2]) { k++; return; }
+	// fall back to binary search
+	k = clamp( (int)(upper_bound( keyTime.begin(), keyTime.end(), t ) - keyTime.begin()) - 1, 0, keyCount - 2 );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  EncodeRotation / DecodeRotation                                            |
+//  |  Smallest-three quaternion compression: the largest component is dropped    |
+//  |  (and reconstructed from the unit length), the other three are stored in    |
+//  |  15 bits each. The index of the dropped component is stored in the top      |
+//  |  bits of the first two values.                                        LH2'20|
+//  +-----------------------------------------------------------------------------+
+static const float SQRT2 = 1.41421356f;
+static void EncodeRotation( const float4 rotation, ushort* d )
 {
-	// handle valid out-of-bounds
-	if (k == 0 && currentTime < t[0]) return interpolation == SPLINE ? vec3Key[1] : vec3Key[0];
-	// determine interpolation parameters
-	const float t0 = t[k], t1 = t[k + 1];
-	const float f = (currentTime - t0) / (t1 - t0);
-	// sample
-	if (f <= 0) return vec3Key[0]; switch (interpolation)
+	const float4 q = normalize( rotation );
+	const float c[4] = { q.x, q.y, q.z, q.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++) if (fabsf( c[i] ) > fabsf( c[largest] )) largest = i;
+	const float sign = c[largest] < 0 ? -1.0f : 1.0f; // q and -q are the same rotation
+	for (int i = 0, j = 0; i < 4; i++) if (i != largest)
 	{
-	case SPLINE:
+		// the remaining components are in [-1/sqrt(2)..1/sqrt(2)]
+		const float v = clamp( c[i] * sign * (SQRT2 * 0.5f) + 0.5f, 0.0f, 1.0f );
+		d[j++] = (ushort)(v * 32767 + 0.5f);
+	}
+	d[0] |= (largest & 1) << 15, d[1] |= (largest >> 1) << 15;
+}
+static float4 DecodeRotation( const ushort* d )
+{
+	static const int slot[4][3] = { { 1, 2, 3 }, { 0, 2, 3 }, { 0, 1, 3 }, { 0, 1, 2 } };
+	const int largest = (d[0] >> 15) | ((d[1] >> 15) << 1);
+	float c[4], sum = 0;
+	for (int j = 0; j < 3; j++)
 	{
-		const float t = f, t2 = t * t, t3 = t2 * t;
-		const float3 p0 = vec3Key[k * 3 + 1];
-		const float3 m0 = (t1 - t0) * vec3Key[k * 3 + 2];
-		const float3 p1 = vec3Key[(k + 1) * 3 + 1];
-		const float3 m1 = (t1 - t0) * vec3Key[(k + 1) * 3];
-		return m0 * (t3 - 2 * t2 + t) + p0 * (2 * t3 - 3 * t2 + 1) + p1 * (-2 * t3 + 3 * t2) + m1 * (t3 - t2);
+		const float v = ((d[j] & 32767) * (2.0f / 32767) - 1) * (SQRT2 * 0.5f);
+		c[slot[largest][j]] = v, sum += v * v;
 	}
-	case Sampler::STEP: return vec3Key[k];
-	default: return (1 - f) * vec3Key[k] + f * vec3Key[k + 1];
-	};
+	c[largest] = sqrtf( max( 0.0f, 1 - sum ) );
+	return make_float4( c[0], c[1], c[2], c[3] );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Channel::Fetch                                              |
+//  |  Get the two values to interpolate, and the interpolation factor, for the   |
+//  |  current time. Step and spline interpolation are resolved here; these       |
+//  |  yield a == b. For rotations, linear interpolation means slerp.       LH2'20|
+//  +-----------------------------------------------------------------------------+
+static float4 Hermite( const float4 p0, const float4 m0, const float4 p1, const float4 m1, const float t )
+{
+	const float t2 = t * t, t3 = t2 * t;
+	return m0 * (t3 - 2 * t2 + t) + p0 * (2 * t3 - 3 * t2 + 1) + p1 * (-2 * t3 + 3 * t2) + m1 * (t3 - t2);
 }
-quat HostAnimation::Sampler::SampleQuat( float currentTime, int k ) const
+void HostAnimation::Channel::Fetch( const Sampler* sampler, float4& a, float4& b, float& f ) const
 {
-	// handle valid out-of-bounds
-	if (k == 0 && currentTime < t[0]) return interpolation == SPLINE ? vec4Key[1] : vec4Key[0];
-	// determine interpolation parameters
-	const float t0 = t[k], t1 = t[k + 1];
-	const float f = (currentTime - t0) / (t1 - t0);
-	// sample
-	quat key;
-	if (f <= 0) return vec4Key[0]; else switch (interpolation)
+	if (baked.frames > 0)
 	{
-#if 1
-	case SPLINE:
+		// baked track: fixed cost, no interpolation mode switch
+		const float frame = t * baked.rate;
+		const int i0 = min( (int)frame, baked.frames - 1 ), i1 = min( i0 + 1, baked.frames - 1 );
+		const ushort* q0 = baked.data.data() + i0 * 3, * q1 = baked.data.data() + i1 * 3;
+		f = min( frame - i0, 1.0f ) * baked.blend;
+		if (target == 1) { a = DecodeRotation( q0 ), b = DecodeRotation( q1 ); return; }
+		a = baked.base + baked.scale * make_float4( q0[0], q0[1], q0[2], 0 );
+		b = baked.base + baked.scale * make_float4( q1[0], q1[1], q1[2], 0 );
+		return;
+	}
+	const vector<float4>& key = sampler->key;
+	f = 0;
+	if (k < 0) { a = b = key[sampler->FirstValue()]; return; }
+	const float t0 = sampler->t[k], t1 = sampler->t[k + 1];
+	const float u = clamp( (t - t0) / (t1 - t0), 0.0f, 1.0f ); // clamps times before the first key
+	switch (sampler->interpolation)
 	{
-		const float t = f, t2 = t * t, t3 = t2 * t;
-		const quat p0 = vec4Key[k * 3 + 1];
-		const quat m0 = vec4Key[k * 3 + 2] * (t1 - t0);
-		const quat p1 = vec4Key[(k + 1) * 3 + 1];
-		const quat m1 = vec4Key[(k + 1) * 3] * (t1 - t0);
-		key = m0 * (t3 - 2 * t2 + t) + p0 * (2 * t3 - 3 * t2 + 1) + p1 * (-2 * t3 + 3 * t2) + m1 * (t3 - t2);
-		key.normalize();
+	case Sampler::SPLINE:
+		a = b = Hermite( key[k * 3 + 1], (t1 - t0) * key[k * 3 + 2], key[(k + 1) * 3 + 1], (t1 - t0) * key[(k + 1) * 3], u );
+		if (target == 1) a = b = normalize( a );
 		break;
-	}
-#endif
-	case STEP:
-		key = vec4Key[k];
+	case Sampler::STEP:
+		a = b = key[k];
 		break;
 	default:
-		key = quat::slerp( vec4Key[k], vec4Key[k + 1], f );
-		key.normalize();
+		a = key[k], b = key[k + 1], f = u;
 		break;
-	};
-	key.normalize();
-	return key;
+	}
 }
-
-//  +-----------------------------------------------------------------------------+
-//  |  HostAnimation::Channel::Channel                                            |
-//  |  Constructor.                                                         LH2'19|
-//  +-----------------------------------------------------------------------------+
-HostAnimation::Channel::Channel( const tinygltfAnimationChannel& gltfChannel, const tinygltfModel& gltfModel, const int nodeBase )
+void HostAnimation::Channel::Fetch( const Sampler* sampler, const int i, const int count, float& a, float& b, float& f ) const
 {
-	ConvertFromGLTFChannel( gltfChannel, gltfModel, nodeBase );
+	if (baked.frames > 0)
+	{
+		const float frame = t * baked.rate;
+		const int i0 = min( (int)frame, baked.frames - 1 ), i1 = min( i0 + 1, baked.frames - 1 );
+		a = baked.base.x + baked.scale.x * baked.data[i0 * count + i];
+		b = baked.base.x + baked.scale.x * baked.data[i1 * count + i];
+		f = min( frame - i0, 1.0f ) * baked.blend;
+		return;
+	}
+	const vector<float>& key = sampler->floatKey;
+	f = 0;
+	if (k < 0) { a = b = key[min( i * (sampler->interpolation == Sampler::SPLINE ? 3 : 1) + sampler->FirstValue(), (int)key.size() - 1 )]; return; }
+	const float t0 = sampler->t[k], t1 = sampler->t[k + 1];
+	const float u = clamp( (t - t0) / (t1 - t0), 0.0f, 1.0f );
+	switch (sampler->interpolation)
+	{
+	case Sampler::SPLINE:
+	{
+		const float t2 = u * u, t3 = t2 * u;
+		const float p0 = key[(k * count + i) * 3 + 1];
+		const float m0 = (t1 - t0) * key[(k * count + i) * 3 + 2];
+		const float p1 = key[((k + 1) * count + i) * 3 + 1];
+		const float m1 = (t1 - t0) * key[((k + 1) * count + i) * 3];
+		a = b = m0 * (t3 - 2 * t2 + u) + p0 * (2 * t3 - 3 * t2 + 1) + p1 * (-2 * t3 + 3 * t2) + m1 * (t3 - t2);
+		break;
+	}
+	case Sampler::STEP:
+		a = b = key[k * count + i];
+		break;
+	default:
+		a = key[k * count + i], b = key[(k + 1) * count + i], f = u;
+		break;
+	}
 }
 
 //  +-----------------------------------------------------------------------------+
-//  |  HostAnimation::Channel::ConvertFromGLTFChannel                             |
-//  |  Convert a gltf animation channel.                                    LH2'19|
+//  |  Slerp                                                                      |
+//  |  Spherical interpolation along the shortest arc; falls back to normalized   |
+//  |  lerp for nearly identical rotations.                                 LH2'20|
 //  +-----------------------------------------------------------------------------+
-void HostAnimation::Channel::ConvertFromGLTFChannel( const tinygltfAnimationChannel& gltfChannel, const tinygltfModel& gltfModel, const int nodeBase )
+static float4 Slerp( const float4 a, const float4 b, const float u )
 {
-	samplerIdx = gltfChannel.sampler;
-	nodeIdx = gltfChannel.target_node + nodeBase;
-	if (gltfChannel.target_path.compare( "translation" ) == 0) target = 0;
-	if (gltfChannel.target_path.compare( "rotation" ) == 0) target = 1;
-	if (gltfChannel.target_path.compare( "scale" ) == 0) target = 2;
-	if (gltfChannel.target_path.compare( "weights" ) == 0) target = 3;
+	float cosTheta = dot( a, b );
+	const float sign = cosTheta < 0 ? -1.0f : 1.0f;
+	cosTheta *= sign;
+	float s0 = 1 - u, s1 = u * sign;
+	if (cosTheta < 0.9995f)
+	{
+		const float angle = acosf( cosTheta ), invSin = 1.0f / sinf( angle );
+		s0 = sinf( (1 - u) * angle ) * invSin, s1 = sinf( u * angle ) * invSin * sign;
+	}
+	return normalize( s0 * a + s1 * b );
 }
 
 //  +-----------------------------------------------------------------------------+
-//  |  HostAnimation::Channel::Update                                             |
-//  |  Advance channel animation time.                                      LH2'19|
+//  |  HostAnimation::Channel::Bake                                               |
+//  |  Resample the channel at a fixed rate and quantize the samples: rotations   |
+//  |  use smallest-three, other values are range-quantized to 16 bit. After      |
+//  |  this, the channel no longer uses its sampler.                        LH2'20|
 //  +-----------------------------------------------------------------------------+
-void HostAnimation::Channel::Update( const float dt, const Sampler* sampler )
+void HostAnimation::Channel::Bake( const Sampler* sampler, const float rate, const int count )
 {
-	// advance animation timer
-	t += dt;
-	int keyCount = (int)sampler->t.size();
-	float animDuration = sampler->t[keyCount - 1];
-	if (animDuration == 0 /* book scene */ || keyCount == 1 /* bird */)
+	if (baked.frames > 0) return;
+	const int keyCount = (int)sampler->t.size();
+	const float duration = keyCount > 1 ? sampler->t[keyCount - 1] : 0;
+	const int frames = duration > 0 ? max( 2, (int)ceilf( duration * rate ) + 1 ) : 1;
+	const int values = target == 3 ? count : 1;
+	// evaluate the source curves at the sample times
+	vector<float4> sample( frames * values );
+	k = 0;
+	for (int i = 0; i < frames; i++)
 	{
-		if (target == 0) // translation
-		{
-			HostScene::nodePool[nodeIdx]->translation = sampler->vec3Key[0];
-			HostScene::nodePool[nodeIdx]->transformed = true;
-		}
-		else if (target == 1) // rotation
+		t = frames > 1 ? (i * duration) / (frames - 1) : 0;
+		Locate( sampler );
+		if (target == 3) for (int j = 0; j < count; j++)
 		{
-			HostScene::nodePool[nodeIdx]->rotation = sampler->vec4Key[0];
-			HostScene::nodePool[nodeIdx]->transformed = true;
+			float a, b, u;
+			Fetch( sampler, j, count, a, b, u );
+			sample[i * count + j].x = a + u * (b - a);
 		}
-		else if (target == 2) // scale
+		else
 		{
-			HostScene::nodePool[nodeIdx]->scale = sampler->vec3Key[0];
-			HostScene::nodePool[nodeIdx]->transformed = true;
-		}
-		else // target == 3, weight
-		{
-			int weightCount = (int)HostScene::nodePool[nodeIdx]->weights.size();
-			for (int i = 0; i < weightCount; i++)
-				HostScene::nodePool[nodeIdx]->weights[i] = sampler->floatKey[0];
-			HostScene::nodePool[nodeIdx]->morphed = true;
+			float4 a, b;
+			float u;
+			Fetch( sampler, a, b, u );
+			sample[i] = target == 1 ? Slerp( a, b, u ) : (a + u * (b - a));
 		}
 	}
+	// quantize
+	baked.stride = target == 3 ? count : 3;
+	baked.data.resize( frames * baked.stride );
+	if (target == 1) for (int i = 0; i < frames; i++) EncodeRotation( sample[i], baked.data.data() + i * 3 );
 	else
 	{
-		while (t >= animDuration) t -= animDuration, k = 0;
-		while (t >= sampler->t[(k + 1) % keyCount]) k++;
-		// determine interpolation parameters
-		assert( k < keyCount - 1 );
-		assert( t >= 0 && t < animDuration );
-		assert( t < sampler->t[k + 1] );
-		// apply anination key
-		if (target == 0) // translation
-		{
-			assert( sampler->t.size() == sampler->vec3Key.size() );
-			HostScene::nodePool[nodeIdx]->translation = sampler->SampleVec3( t, k );
-			HostScene::nodePool[nodeIdx]->transformed = true;
-		}
-		else if (target == 1) // rotation
-		{
-			assert( sampler->t.size() == sampler->vec4Key.size() );
-			HostScene::nodePool[nodeIdx]->rotation = sampler->SampleQuat( t, k );
-			HostScene::nodePool[nodeIdx]->transformed = true;
-		}
-		else if (target == 2) // scale
-		{
-			assert( sampler->t.size() == sampler->vec3Key.size() );
-			HostScene::nodePool[nodeIdx]->scale = sampler->SampleVec3( t, k );
-			HostScene::nodePool[nodeIdx]->transformed = true;
-		}
-		else // target == 3, weight
+		float4 lo = make_float4( 1e34f ), hi = make_float4( -1e34f );
+		for (const float4& v : sample) lo = fminf( lo, v ), hi = fmaxf( hi, v );
+		baked.base = lo, baked.scale = (hi - lo) * (1.0f / 65535);
+		const float4 invScale = make_float4( baked.scale.x > 0 ? 1 / baked.scale.x : 0, baked.scale.y > 0 ? 1 / baked.scale.y : 0, baked.scale.z > 0 ? 1 / baked.scale.z : 0, 0 );
+		for (int i = 0; i < frames * values; i++)
 		{
-			int weightCount = (int)HostScene::nodePool[nodeIdx]->weights.size();
-			for (int i = 0; i < weightCount; i++)
-				HostScene::nodePool[nodeIdx]->weights[i] = sampler->SampleFloat( t, k, i, weightCount );
-			HostScene::nodePool[nodeIdx]->morphed = true;
+			const float4 q = (sample[i] - lo) * invScale + make_float4( 0.5f );
+			if (target == 3) baked.data[i] = (ushort)q.x; else
+				baked.data[i * 3] = (ushort)q.x, baked.data[i * 3 + 1] = (ushort)q.y, baked.data[i * 3 + 2] = (ushort)q.z;
 		}
 	}
+	baked.rate = frames > 1 ? (frames - 1) / duration : 0;
+	baked.duration = duration;
+	baked.blend = sampler->interpolation == Sampler::STEP ? 0.0f : 1.0f;
+	baked.frames = frames;
+	t = 0, k = 0;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -288,6 +367,9 @@ void HostAnimation::ConvertFromGLTFAnim( tinygltfAnimation& gltfAnim, tinygltfMo
 {
 	for (int i = 0; i < gltfAnim.samplers.size(); i++) sampler.push_back( new Sampler( gltfAnim.samplers[i], gltfModel ) );
 	for (int i = 0; i < gltfAnim.channels.size(); i++) channel.push_back( new Channel( gltfAnim.channels[i], gltfModel, nodeBase ) );
+	for (Channel* c : channel) targetNodes.push_back( c->nodeIdx );
+	sort( targetNodes.begin(), targetNodes.end() );
+	targetNodes.erase( unique( targetNodes.begin(), targetNodes.end() ), targetNodes.end() );
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -299,13 +381,130 @@ void HostAnimation::Reset()
 	for (int i = 0; i < channel.size(); i++) channel[i]->Reset();
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Bake                                                        |
+//  |  Bake all channels to a fixed sample rate, then release the key frame       |
+//  |  data of the samplers.                                                LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostAnimation::Bake( const float rate )
+{
+	if (isBaked || rate <= 0) return;
+	for (Channel* c : channel)
+	{
+		const int count = c->target == 3 ? (int)HostScene::nodePool[c->nodeIdx]->weights.size() : 1;
+		c->Bake( sampler[c->samplerIdx], rate, count );
+	}
+	for (Sampler* s : sampler)
+	{
+		vector<float>().swap( s->t );
+		vector<float4>().swap( s->key );
+		vector<float>().swap( s->floatKey );
+	}
+	isBaked = true;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostAnimation::Update                                                      |
 //  |  Advance channel animation timers.                                    LH2'19|
 //  +-----------------------------------------------------------------------------+
 void HostAnimation::Update( const float dt )
 {
-	for (int i = 0; i < channel.size(); i++) channel[i]->Update( dt, sampler[channel[i]->samplerIdx] );
+	Update( vector<HostAnimation*>( 1, this ), dt );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostAnimation::Update                                                      |
+//  |  Advance and apply the channels of a set of animations in a batch:          |
+//  |  1. advance all timers and fetch key frames into SoA arrays;                |
+//  |  2. interpolate all values: lerp for vectors / weights, slerp for rotations;|
+//  |  3. apply the results to the nodes.                                         |
+//  |  Steps 1 and 2 run in parallel for large batches.                     LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostAnimation::Update( const vector<HostAnimation*>& animations, const float dt )
+{
+	Update( animations, vector<float>( animations.size(), dt ) );
+}
+void HostAnimation::Update( const vector<HostAnimation*>& animations, const vector<float>& dt )
+{
+	// scratch data, reused between calls on the same thread; the parallel steps below run on other
+	// threads, so they must use these references rather than the thread_local object itself
+	struct Scratch
+	{
+		vector<Channel*> chan;
+		vector<const Sampler*> samp;
+		vector<float> chanDt;
+		vector<int> first, rotations;
+		vector<float> ax, ay, az, aw, bx, by, bz, bw, f, rx, ry, rz, rw;
+	};
+	static thread_local Scratch scratch;
+	vector<Channel*>& chan = scratch.chan;
+	vector<const Sampler*>& samp = scratch.samp;
+	vector<float>& chanDt = scratch.chanDt;
+	vector<int>& first = scratch.first, & rotations = scratch.rotations;
+	vector<float>& ax = scratch.ax, & ay = scratch.ay, & az = scratch.az, & aw = scratch.aw;
+	vector<float>& bx = scratch.bx, & by = scratch.by, & bz = scratch.bz, & bw = scratch.bw;
+	vector<float>& f = scratch.f, & rx = scratch.rx, & ry = scratch.ry, & rz = scratch.rz, & rw = scratch.rw;
+	// gather channels and assign SoA entries; a weights channel uses one entry per weight
+	chan.clear(), samp.clear(), chanDt.clear(), first.clear(), rotations.clear();
+	int entries = 0;
+	for (int s = (int)animations.size(), i = 0; i < s; i++) for (Channel* c : animations[i]->channel)
+	{
+		if (c->target == 1) rotations.push_back( entries );
+		chan.push_back( c ), samp.push_back( animations[i]->sampler[c->samplerIdx] ), chanDt.push_back( dt[i] ), first.push_back( entries );
+		entries += c->target == 3 ? (int)HostScene::nodePool[c->nodeIdx]->weights.size() : 1;
+	}
+	first.push_back( entries );
+	for (vector<float>* v : { &ax, &ay, &az, &aw, &bx, &by, &bz, &bw, &f, &rx, &ry, &rz, &rw }) v->resize( entries );
+	const int channelCount = (int)chan.size(), rotationCount = (int)rotations.size();
+	auto inChunks = []( const int count, auto&& func ) {
+		const int chunkSize = 512, chunks = (count + chunkSize - 1) / chunkSize;
+		auto chunk = [&]( int c ) { for (int i = c * chunkSize, e = min( count, i + chunkSize ); i < e; i++) func( i ); };
+		if (chunks > 1) ParallelFor( 0, chunks, chunk ); else if (chunks == 1) chunk( 0 );
+	};
+	// 1. advance and fetch
+	inChunks( channelCount, [&]( const int i ) {
+		Channel* c = chan[i];
+		const Sampler* s = samp[i];
+		const int e = first[i];
+		c->Advance( chanDt[i], s );
+		if (c->target == 3) for (int n = first[i + 1] - e, j = 0; j < n; j++) c->Fetch( s, j, n, ax[e + j], bx[e + j], f[e + j] );
+		else
+		{
+			float4 a, b;
+			c->Fetch( s, a, b, f[e] );
+			ax[e] = a.x, ay[e] = a.y, az[e] = a.z, aw[e] = a.w;
+			bx[e] = b.x, by[e] = b.y, bz[e] = b.z, bw[e] = b.w;
+		}
+	} );
+	// 2a. lerp all entries; branch-free, so the compiler can vectorize this
+	inChunks( (entries + 63) / 64, [&]( const int c ) {
+		for (int e = c * 64, end = min( entries, e + 64 ); e < end; e++)
+		{
+			rx[e] = ax[e] + f[e] * (bx[e] - ax[e]);
+			ry[e] = ay[e] + f[e] * (by[e] - ay[e]);
+			rz[e] = az[e] + f[e] * (bz[e] - az[e]);
+			rw[e] = aw[e] + f[e] * (bw[e] - aw[e]);
+		}
+	} );
+	// 2b. slerp rotations
+	inChunks( rotationCount, [&]( const int i ) {
+		const int e = rotations[i];
+		const float4 q = Slerp( make_float4( ax[e], ay[e], az[e], aw[e] ), make_float4( bx[e], by[e], bz[e], bw[e] ), f[e] );
+		rx[e] = q.x, ry[e] = q.y, rz[e] = q.z, rw[e] = q.w;
+	} );
+	// 3. apply
+	for (int i = 0; i < channelCount; i++)
+	{
+		HostNode* node = HostScene::nodePool[chan[i]->nodeIdx];
+		const int e = first[i];
+		switch (chan[i]->target)
+		{
+		case 0: node->translation = make_float3( rx[e], ry[e], rz[e] ), node->transformed = true; break;
+		case 1: node->rotation = quat( rw[e], rx[e], ry[e], rz[e] ), node->transformed = true; break;
+		case 2: node->scale = make_float3( rx[e], ry[e], rz[e] ), node->transformed = true; break;
+		default: for (int j = e; j < first[i + 1]; j++) node->weights[j - e] = rx[j]; node->morphed = true; break;
+		}
+	}
 }
 
 // EOF
\ No newline at end of file
@@ -20,6 +20,17 @@
 namespace lighthouse2
 {
 
+//  +-----------------------------------------------------------------------------+
+//  |  AnimationLOD                                                               |
+//  |  Animation level of detail tier, see HostScene::UpdateAnimations.     LH2'20|
+//  +-----------------------------------------------------------------------------+
+struct AnimationLOD
+{
+	float distance;					// the tier is used up to this distance from the camera
+	int interval;					// update every 'interval' frames; 0 freezes the pose
+	bool skinning;					// update skinned meshes; if false, skinned meshes keep their last pose
+};
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostAnimation                                                              |
 //  |  Host-side animation definition.                                      LH2'19|
@@ -37,12 +48,9 @@ class HostAnimation
 		};
 		Sampler( const tinygltfAnimationSampler& gltfSampler, const tinygltfModel& gltfModel );
 		void ConvertFromGLTFSampler( const tinygltfAnimationSampler& gltfSampler, const tinygltfModel& gltfModel );
-		float SampleFloat( float t, int k, int i, int count ) const;
-		float3 SampleVec3( float t, int k ) const;
-		quat SampleQuat( float t, int k ) const;
+		int FirstValue() const { return interpolation == SPLINE ? 1 : 0; }
 		vector<float> t;				// key frame times
-		vector<float3> vec3Key;			// vec3 key frames (location or scale)
-		vector<quat> vec4Key;			// vec4 key frames (rotation)
+		vector<float4> key;				// vec3 key frames (location or scale; w unused) or quaternion key frames (rotation; xyzw)
 		vector<float> floatKey;			// float key frames (weight)
 		int interpolation;				// interpolation type: linear, spline, step
 	};
@@ -54,11 +62,25 @@ class HostAnimation
 		int nodeIdx;					// index of the node this channel affects
 		int target;						// 0: translation, 1: rotation, 2: scale, 3: weights
 		void Reset() { t = 0, k = 0; }
-		void Update( const float t, const Sampler* sampler );	// apply this channel to the target nde for time t
+		void Advance( const float dt, const Sampler* sampler );	// advance the animation timer and locate the key frame
+		void Locate( const Sampler* sampler );	// find the key frame for the current time
+		void Bake( const Sampler* sampler, const float rate, const int count );	// resample to a fixed rate and quantize
+		void Fetch( const Sampler* sampler, float4& a, float4& b, float& f ) const;	// keys to interpolate for translation / rotation / scale
+		void Fetch( const Sampler* sampler, const int i, const int count, float& a, float& b, float& f ) const; // idem, for weight i
 		void ConvertFromGLTFChannel( const tinygltfAnimationChannel& gltfChannel, const tinygltfModel& gltfModel, const int nodeBase );
 		// data
 		float t = 0;					// animation timer
-		int k = 0;						// current keyframe
+		int k = 0;						// current keyframe; cached between updates, -1 for constant channels
+		struct Track					// baked channel data; replaces the sampler once baked
+		{
+			int frames = 0;				// number of samples; 0 if the channel has not been baked
+			int stride = 0;				// quantized values per sample
+			float rate = 0;				// samples per second
+			float duration = 0;			// length of the track in seconds
+			float blend = 1;			// 0 for step interpolation, 1 otherwise
+			float4 base, scale;			// dequantization: value = base + scale * q (translation, scale, weights)
+			vector<ushort> data;		// frames * stride quantized values; rotations use smallest-three in 48 bits
+		} baked;
 	};
 public:
 	HostAnimation( tinygltfAnimation& gltfAnim, tinygltfModel& gltfModel, const int nodeBase );
@@ -66,7 +88,15 @@ public:
 	vector<Channel*> channel;		// animation channels
 	void Reset();					// reset all channels
 	void Update( const float dt );	// advance and apply all channels
+	static void Update( const vector<HostAnimation*>& animations, const float dt );	// advance and apply several animations at once
+	static void Update( const vector<HostAnimation*>& animations, const vector<float>& dt );	// idem, with a time step per animation
+	void Bake( const float rate = 30 );	// resample all channels to a fixed rate and quantize them
+	bool IsBaked() const { return isBaked; }
 	void ConvertFromGLTFAnim( tinygltfAnimation& gltfAnim, tinygltfModel& gltfModel, const int nodeBase );
+	vector<int> targetNodes;		// nodes affected by this animation; used for LOD selection
+	float lodTime = 0;				// time accumulated while updates are skipped by the LOD system
+private:
+	bool isBaked = false;			// all channels have been baked; the samplers no longer hold key data
 };
 
 } // namespace lighthouse2
@@ -23,6 +23,16 @@
 //  |  - For MIS, we store the original triangle (idx and instance idx).    LH2'20|
 //  +-----------------------------------------------------------------------------+
 HostTriLight::HostTriLight( HostTri* origTri, int origIdx, int origInstance )
+{
+	Set( origTri, origIdx, origInstance );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTriLight::Set                                                          |
+//  |  (Re)initialize the light from a (transformed) triangle. Leaves the         |
+//  |  handle and mesh index intact, so the light can be updated in place.  LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTriLight::Set( HostTri* origTri, int origIdx, int origInstance )
 {
 	triIdx = origIdx;
 	instIdx = origInstance;
@@ -29,10 +29,13 @@ public:
 	HostTriLight() = default;
 	HostTriLight( HostTri* origTri, int origIdx, int origInstance );
 	// methods
+	void Set( HostTri* origTri, int origIdx, int origInstance );
 	CoreLightTri ConvertToCoreLightTri();
 	// data members
 	int triIdx = 0;								// the index of the triangle this ltri is based on
 	int instIdx = 0;							// the instance to which this triangle belongs
+	int meshIdx = -1;							// the mesh that owns triangle triIdx
+	int handle = -1;							// stable handle, see HostScene::AddTriLight
 	float3 vertex0 = make_float3( 0 );
 	float3 vertex1 = make_float3( 0 );
 	float3 vertex2 = make_float3( 0 );
@@ -215,4 +215,52 @@ void HostMaterial::ConvertFrom( const tinygltfMaterial& original, const tinygltf
 	}
 }
 
+// helpers: the material properties, field by field, without the padding between them
+template <class T> static void Append( vector<uchar>& out, const T& value )
+{
+	const uchar* bytes = (const uchar*)&value;
+	out.insert( out.end(), bytes, bytes + sizeof( T ) );
+}
+static void Append( vector<uchar>& out, const HostMaterial::Vec3Value& v )
+{
+	Append( out, v.value ), Append( out, v.textureID ), Append( out, v.scale );
+	Append( out, v.uvscale.x ), Append( out, v.uvscale.y ), Append( out, v.uvoffset.x ), Append( out, v.uvoffset.y );
+	Append( out, v.size.x ), Append( out, v.size.y );
+}
+static void Append( vector<uchar>& out, const HostMaterial::ScalarValue& v )
+{
+	Append( out, v.value ), Append( out, v.textureID ), Append( out, v.component ), Append( out, v.scale );
+	Append( out, v.uvscale.x ), Append( out, v.uvscale.y ), Append( out, v.uvoffset.x ), Append( out, v.uvoffset.y );
+	Append( out, v.size.x ), Append( out, v.size.y );
+}
+static vector<uchar> PackProperties( const HostMaterial& m )
+{
+	vector<uchar> out;
+	out.reserve( 2048 );
+	for (const HostMaterial::Vec3Value* v : { &m.color, &m.detailColor, &m.normals, &m.detailNormals, &m.absorption,
+		&m.Ks, &m.eta_rgb, &m.scatterDistance, &m.Kr, &m.opacity }) Append( out, *v );
+	for (const HostMaterial::ScalarValue* v : { &m.metallic, &m.subsurface, &m.specular, &m.roughness, &m.specularTint,
+		&m.anisotropic, &m.sheen, &m.sheenTint, &m.clearcoat, &m.clearcoatGloss, &m.transmission, &m.eta, &m.reflection,
+		&m.refraction, &m.ior, &m.urough, &m.vrough, &m.sigma, &m.specTrans, &m.diffTrans, &m.flatness }) Append( out, *v );
+	Append( out, m.flags ), Append( out, (uint)m.pbrtMaterialType ), Append( out, m.thin );
+	return out;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMaterial::ContentHash / SameParameters                                 |
+//  |  Hash and exact comparison of the material properties, i.e. the data that   |
+//  |  is copied to the CoreMaterial; name, origin and ID are ignored. Used to    |
+//  |  merge identical materials, see HostScene::FindOrAddMaterial.         LH2'20|
+//  +-----------------------------------------------------------------------------+
+uint64_t HostMaterial::ContentHash() const
+{
+	const vector<uchar> properties = PackProperties( *this );
+	return FastHash64( properties.data(), properties.size() );
+}
+
+bool HostMaterial::SameParameters( const HostMaterial& other ) const
+{
+	return PackProperties( *this ) == PackProperties( other );
+}
+
 // EOF
\ No newline at end of file
@@ -80,6 +80,8 @@ public:
 	void ConvertFrom( const tinyobjMaterial& );
 	void ConvertFrom( const tinygltfMaterial&, const tinygltfModel&, const vector<int>& texIdx );
 	bool IsEmissive() { float3& c = color(); return c.x > 1 || c.y > 1 || c.z > 1; /* ignores vec3map */ }
+	uint64_t ContentHash() const;
+	bool SameParameters( const HostMaterial& other ) const;
 
 	// START OF DATA THAT WILL BE COPIED TO COREMATERIAL
 
@@ -80,9 +80,9 @@ HostMesh::HostMesh( const char* file, const char* dir, const float scale, const
 	LoadGeometry( file, dir, scale, flatShaded );
 }
 
-HostMesh::HostMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<int>& matIdx, const int materialOverride )
+HostMesh::HostMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<HostTexture*>& colorTextures, const int materialOverride )
 {
-	ConvertFromGTLFMesh( gltfMesh, gltfModel, matIdx, materialOverride );
+	ConvertFromGTLFMesh( gltfMesh, gltfModel, colorTextures, materialOverride );
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -124,23 +124,297 @@ void HostMesh::LoadGeometry( const char* file, const char* dir, const float scal
 	}
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  OBJ parsing                                                                |
+//  |  The file is mapped and split at line boundaries into chunks, which are     |
+//  |  parsed in parallel. Negative (relative) indices and material names can     |
+//  |  only be resolved once all chunks are known; this happens in ParseOBJ.      |
+//  |                                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+struct OBJChunk
+{
+	vector<float> positions, normals, uvs;
+	vector<tinyobj::index_t> corners;		// three per triangle
+	vector<uint> relative;					// corner * 3 + attribute, for indices that still need the chunk base
+	vector<int> faceMaterial;				// per triangle: slot in usemtl, or -1 for the material active at the chunk start
+	vector<string> usemtl, mtllib;
+};
+
+static inline const char* SkipBlanks( const char* p ) { while (*p == ' ' || *p == '\t') p++; return p; }
+static inline bool IsDigit( const char c ) { return c >= '0' && c <= '9'; }
+
+// fast float parsing: up to 19 significant digits, scaled by an exact power of ten where possible
+static const char* ParseFloat( const char* p, float& value )
+{
+	static const double pow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	p = SkipBlanks( p );
+	const char* start = p;
+	const bool negative = *p == '-';
+	if (*p == '-' || *p == '+') p++;
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0;
+	bool any = false;
+	for (; IsDigit( *p ); p++, any = true)
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa > 0) digits++; } else exponent++;
+	if (*p == '.') for (p++; IsDigit( *p ); p++, any = true)
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa > 0) digits++; exponent--; }
+	if (!any)
+	{
+		// 'nan', 'inf' and friends are rare; leave them to the C library
+		value = 0;
+		if (*p != 'n' && *p != 'N' && *p != 'i' && *p != 'I') return start;
+		char* end;
+		value = strtof( start, &end );
+		return end;
+	}
+	if ((*p == 'e' || *p == 'E') && (IsDigit( p[1] ) || ((p[1] == '-' || p[1] == '+') && IsDigit( p[2] ))))
+	{
+		const bool negativeExponent = *++p == '-';
+		if (*p == '-' || *p == '+') p++;
+		int e = 0;
+		for (; IsDigit( *p ); p++) if (e < 10000) e = e * 10 + (*p - '0');
+		exponent += negativeExponent ? -e : e;
+	}
+	double d = (double)mantissa;
+	if (exponent < 0 && exponent >= -22) d /= pow10[-exponent];
+	else if (exponent >= 0 && exponent <= 22) d *= pow10[exponent];
+	else d *= pow( 10.0, exponent );
+	value = (float)(negative ? -d : d);
+	return p;
+}
+
+static const char* ParseInt( const char* p, int& value, bool& valid )
+{
+	const bool negative = *p == '-';
+	if (*p == '-' || *p == '+') p++;
+	valid = IsDigit( *p );
+	int v = 0;
+	for (; IsDigit( *p ); p++) v = v * 10 + (*p - '0');
+	value = negative ? -v : v;
+	return p;
+}
+
+// first whitespace delimited word at p
+static string ParseName( const char* p )
+{
+	p = SkipBlanks( p );
+	const char* end = p;
+	while (*end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '\n') end++;
+	return string( p, end );
+}
+
+// parse the lines in [first,last); last is a line end or the end of the file
+static void ParseOBJChunk( const char* first, const char* last, OBJChunk& chunk )
+{
+	vector<tinyobj::index_t> polygon;
+	vector<uchar> polygonRelative;
+	string tail;
+	int currentMaterial = -1;
+	for (const char* line = first; line < last;)
+	{
+		const char* lineEnd = (const char*)memchr( line, '\n', last - line );
+		const char* next = lineEnd ? lineEnd + 1 : last;
+		if (!lineEnd)
+		{
+			// last line of the file without a line end: parse a terminated copy
+			tail.assign( line, last );
+			line = tail.c_str();
+		}
+		const char* p = SkipBlanks( line );
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			float x, y, z;
+			p = ParseFloat( ParseFloat( ParseFloat( p + 2, x ), y ), z );
+			chunk.positions.push_back( x ), chunk.positions.push_back( y ), chunk.positions.push_back( z );
+		}
+		else if (p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			float x, y, z;
+			p = ParseFloat( ParseFloat( ParseFloat( p + 3, x ), y ), z );
+			chunk.normals.push_back( x ), chunk.normals.push_back( y ), chunk.normals.push_back( z );
+		}
+		else if (p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			float u, v;
+			p = ParseFloat( ParseFloat( p + 3, u ), v );
+			chunk.uvs.push_back( u ), chunk.uvs.push_back( v );
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// corners: v, v/t, v//n or v/t/n; positive indices are absolute, negative ones count back from the
+			// current line, which is only known relative to the chunk here
+			const int counts[3] = { (int)chunk.positions.size() / 3, (int)chunk.uvs.size() / 2, (int)chunk.normals.size() / 3 };
+			polygon.clear(), polygonRelative.clear();
+			p = SkipBlanks( p + 1 );
+			while (*p && *p != '\r' && *p != '\n' && *p != '#')
+			{
+				int raw[3] = { 0, 0, 0 };
+				bool valid[3] = { false, false, false };
+				p = ParseInt( p, raw[0], valid[0] );
+				if (*p == '/')
+				{
+					if (*++p != '/') p = ParseInt( p, raw[1], valid[1] );
+					if (*p == '/') p = ParseInt( p + 1, raw[2], valid[2] );
+				}
+				int index[3];
+				uchar relative = 0;
+				for (int a = 0; a < 3; a++)
+				{
+					if (!valid[a] || raw[a] == 0) index[a] = a == 0 ? INT_MIN : -1; // a missing vertex index is an error
+					else if (raw[a] > 0) index[a] = raw[a] - 1;
+					else index[a] = counts[a] + raw[a], relative |= 1 << a;
+				}
+				polygon.push_back( { index[0], index[2], index[1] } ); // index_t: vertex, normal, texcoord
+				polygonRelative.push_back( relative );
+				while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+				p = SkipBlanks( p );
+			}
+			// triangle fan
+			for (size_t k = 1; k + 1 < polygon.size(); k++)
+			{
+				const size_t c[3] = { 0, k, k + 1 };
+				for (int i = 0; i < 3; i++)
+				{
+					const uint corner = (uint)chunk.corners.size();
+					chunk.corners.push_back( polygon[c[i]] );
+					// attribute order in 'relative' follows index_t: vertex, normal, texcoord
+					if (polygonRelative[c[i]] & 1) chunk.relative.push_back( corner * 3 + 0 );
+					if (polygonRelative[c[i]] & 4) chunk.relative.push_back( corner * 3 + 1 );
+					if (polygonRelative[c[i]] & 2) chunk.relative.push_back( corner * 3 + 2 );
+				}
+				chunk.faceMaterial.push_back( currentMaterial );
+			}
+		}
+		else if (strncmp( p, "usemtl", 6 ) == 0 && (p[6] == ' ' || p[6] == '\t'))
+		{
+			currentMaterial = (int)chunk.usemtl.size();
+			chunk.usemtl.push_back( ParseName( p + 7 ) );
+		}
+		else if (strncmp( p, "mtllib", 6 ) == 0 && (p[6] == ' ' || p[6] == '\t'))
+		{
+			// all file names on the line; the first one that loads is used
+			for (p = SkipBlanks( p + 7 ); *p && *p != '\r' && *p != '\n'; p = SkipBlanks( p ))
+			{
+				const string name = ParseName( p );
+				if (name.size() == 0) break;
+				chunk.mtllib.push_back( name );
+				p += name.size();
+			}
+			chunk.mtllib.push_back( "" ); // separates mtllib lines
+		}
+		line = next;
+	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  ParseOBJ                                                                   |
+//  |  Parse an obj file into a single tinyobj shape, and load the materials of   |
+//  |  its mtllib files in order, like tinyobj::LoadObj does. Polygons are        |
+//  |  triangulated as fans.                                                LH2'20|
+//  +-----------------------------------------------------------------------------+
+static void ParseOBJ( const string& fileName, const char* directory, tinyobj::attrib_t& attrib, tinyobj::shape_t& shape, vector<tinyobj::material_t>& materials )
+{
+	MappedFile file( fileName.c_str() );
+	FATALERROR_IF( !file.Valid(), "could not open %s", fileName.c_str() );
+	const char* data = (const char*)file.data, *dataEnd = data + file.size;
+	// chunks of at least 1MB, a few per hardware thread, each starting at a line start
+	const int chunkCount = (int)max( (size_t)1, min( (size_t)thread::hardware_concurrency() * 4, file.size >> 20 ) );
+	vector<const char*> bounds( chunkCount + 1, dataEnd );
+	bounds[0] = data;
+	for (int c = 1; c < chunkCount; c++)
+	{
+		const char* p = max( bounds[c - 1], data + file.size * c / chunkCount );
+		const char* lineEnd = (const char*)memchr( p - 1, '\n', dataEnd - (p - 1) );
+		bounds[c] = lineEnd ? lineEnd + 1 : dataEnd;
+	}
+	vector<OBJChunk> chunks( chunkCount );
+	ParallelFor( 0, chunkCount, [&]( int c ) { ParseOBJChunk( bounds[c], bounds[c + 1], chunks[c] ); } );
+	// chunk bases
+	vector<int> positionBase( chunkCount + 1, 0 ), normalBase( chunkCount + 1, 0 ), uvBase( chunkCount + 1, 0 );
+	vector<size_t> cornerBase( chunkCount + 1, 0 );
+	for (int c = 0; c < chunkCount; c++)
+	{
+		positionBase[c + 1] = positionBase[c] + (int)chunks[c].positions.size() / 3;
+		normalBase[c + 1] = normalBase[c] + (int)chunks[c].normals.size() / 3;
+		uvBase[c + 1] = uvBase[c] + (int)chunks[c].uvs.size() / 2;
+		cornerBase[c + 1] = cornerBase[c] + chunks[c].corners.size();
+	}
+	FATALERROR_IF( cornerBase[chunkCount] == 0, "no faces in %s", fileName.c_str() );
+	// materials: mtllib files in order of appearance; usemtl names are resolved once all are loaded
+	tinyobj::MaterialFileReader reader( directory );
+	map<string, int> materialMap;
+	bool loaded = false;
+	for (auto& chunk : chunks) for (auto& name : chunk.mtllib)
+	{
+		if (name.size() == 0) { loaded = false; continue; }
+		string warn, err;
+		if (!loaded) loaded = reader( name, &materials, &materialMap, &warn, &err );
+	}
+	vector<int> startMaterial( chunkCount );
+	vector<vector<int>> usemtlIDs( chunkCount );
+	for (int current = -1, c = 0; c < chunkCount; c++)
+	{
+		startMaterial[c] = current;
+		for (auto& name : chunks[c].usemtl)
+		{
+			auto m = materialMap.find( name );
+			usemtlIDs[c].push_back( current = (m == materialMap.end() ? -1 : m->second) );
+		}
+	}
+	// merge
+	attrib.vertices.resize( positionBase[chunkCount] * 3 );
+	attrib.normals.resize( normalBase[chunkCount] * 3 );
+	attrib.texcoords.resize( uvBase[chunkCount] * 2 );
+	shape.mesh.indices.resize( cornerBase[chunkCount] );
+	shape.mesh.material_ids.resize( cornerBase[chunkCount] / 3 );
+	shape.mesh.num_face_vertices.assign( cornerBase[chunkCount] / 3, 3 );
+	atomic<bool> invalid( false );
+	ParallelFor( 0, chunkCount, [&]( int c ) {
+		OBJChunk& chunk = chunks[c];
+		if (chunk.positions.size()) memcpy( attrib.vertices.data() + positionBase[c] * 3, chunk.positions.data(), chunk.positions.size() * sizeof( float ) );
+		if (chunk.normals.size()) memcpy( attrib.normals.data() + normalBase[c] * 3, chunk.normals.data(), chunk.normals.size() * sizeof( float ) );
+		if (chunk.uvs.size()) memcpy( attrib.texcoords.data() + uvBase[c] * 2, chunk.uvs.data(), chunk.uvs.size() * sizeof( float ) );
+		const int base[3] = { positionBase[c], normalBase[c], uvBase[c] };
+		for (const uint r : chunk.relative)
+		{
+			tinyobj::index_t& corner = chunk.corners[r / 3];
+			(r % 3 == 0 ? corner.vertex_index : r % 3 == 1 ? corner.normal_index : corner.texcoord_index) += base[r % 3];
+		}
+		tinyobj::index_t* corners = shape.mesh.indices.data() + cornerBase[c];
+		for (size_t s = chunk.corners.size(), i = 0; i < s; i++)
+		{
+			const tinyobj::index_t& corner = chunk.corners[i];
+			if (corner.vertex_index < 0 || corner.vertex_index >= positionBase[chunkCount] ||
+				corner.normal_index < -1 || corner.normal_index >= normalBase[chunkCount] ||
+				corner.texcoord_index < -1 || corner.texcoord_index >= uvBase[chunkCount]) invalid = true;
+			corners[i] = corner;
+		}
+		int* ids = shape.mesh.material_ids.data() + cornerBase[c] / 3;
+		for (size_t s = chunk.faceMaterial.size(), i = 0; i < s; i++)
+			ids[i] = chunk.faceMaterial[i] == -1 ? startMaterial[c] : usemtlIDs[c][chunk.faceMaterial[i]];
+		chunk = OBJChunk(); // release early; large files
+	} );
+	FATALERROR_IF( invalid, "invalid face indices in %s", fileName.c_str() );
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostMesh::LoadGeometryFromObj                                              |
-//  |  Load an obj file using tinyobj.                                      LH2'19|
+//  |  Load an obj file. Geometry is parsed by ParseOBJ; materials are converted  |
+//  |  from tinyobj materials, as before.                                   LH2'20|
 //  +-----------------------------------------------------------------------------+
 void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* directory, const mat4& transform, const bool flatShaded )
 {
 	// load obj file
 	tinyobj::attrib_t attrib;
-	vector<tinyobj::shape_t> shapes;
+	tinyobj::shape_t shape;
 	vector<tinyobj::material_t> materials;
-	map<string, GLuint> textures;
-	string err, warn;
 	Timer timer;
 	timer.reset();
-	tinyobj::LoadObj( &attrib, &shapes, &materials, &err, &warn, fileName.c_str(), directory );
-	FATALERROR_IF( err.size() > 0 || shapes.size() == 0, "tinyobj failed to load %s: %s", fileName.c_str(), err.c_str() );
+	ParseOBJ( fileName, directory, attrib, shape, materials );
 	printf( "loaded mesh in %5.3fs\n", timer.elapsed() );
+	const vector<tinyobj::index_t>& indices = shape.mesh.indices;
+	const int triCount = (int)indices.size() / 3;
 	// material offset: if we loaded an object before this one, material indices should not start at 0.
 	int matIdxOffset = (int)HostScene::materials.size();
 	// process materials
@@ -150,17 +424,28 @@ void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* director
 	chdir( directory ); // SetCurrentDirectory( directory );
 	materialList.clear();
 	materialList.reserve( materials.size() );
+	// load the textures used by the materials in parallel; material conversion will find them
+	vector<pair<string, uint>> textureFiles;
+	for (auto& mtl : materials)
+	{
+		if (mtl.diffuse_texname != "") textureFiles.push_back( make_pair( mtl.diffuse_texname, (uint)(HostTexture::LINEARIZED | HostTexture::FLIPPED) ) );
+		if (mtl.normal_texname != "") textureFiles.push_back( make_pair( mtl.normal_texname, (uint)HostTexture::FLIPPED ) );
+		if (mtl.specular_texname != "") textureFiles.push_back( make_pair( mtl.specular_texname, (uint)HostTexture::FLIPPED ) );
+	}
+	HostScene::PreloadTextures( textureFiles );
+	vector<int> matIdx; // scene material ID per OBJ material; identical materials are merged
 	for (auto& mtl : materials)
 	{
 		// initialize
 		HostMaterial* material = new HostMaterial();
-		material->ID = (int)HostScene::materials.size();
 		material->origin = fileName;
 		material->ConvertFrom( mtl );
 		material->flags |= HostMaterial::FROM_MTL;
 		material->MarkAsDirty();
-		HostScene::materials.push_back( material );
-		materialList.push_back( material->ID );
+		const int matID = HostScene::FindOrAddMaterial( material );
+		if (HostScene::materials[matID] != material) delete material;
+		if (find( materialList.begin(), materialList.end(), matID ) == materialList.end()) materialList.push_back( matID );
+		matIdx.push_back( matID );
 	}
 	chdir( currDir ); // SetCurrentDirectory( currDir );
 	printf( "materials finalized in %5.3fs\n", timer.elapsed() );
@@ -169,36 +454,32 @@ void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* director
 	vector<float> alphas;
 	timer.reset();
 	alphas.resize( verts, 1.0f ); // we will have one alpha value per unique vertex normal
-	for (uint s = (uint)shapes.size(), i = 0; i < s; i++)
-	{
-		vector<tinyobj::index_t>& indices = shapes[i].mesh.indices;
-		if (flatShaded) for (uint s = (uint)indices.size(), f = 0; f < s; f++) alphas[indices[f].normal_index] = 1; else
-			for (uint s = (uint)indices.size(), f = 0; f < s; f += 3)
-			{
-				const int idx0 = indices[f + 0].vertex_index, nidx0 = indices[f + 0].normal_index;
-				const int idx1 = indices[f + 1].vertex_index, nidx1 = indices[f + 1].normal_index;
-				const int idx2 = indices[f + 2].vertex_index, nidx2 = indices[f + 2].normal_index;
-				const float3 vert0 = make_float3( attrib.vertices[idx0 * 3 + 0], attrib.vertices[idx0 * 3 + 1], attrib.vertices[idx0 * 3 + 2] );
-				const float3 vert1 = make_float3( attrib.vertices[idx1 * 3 + 0], attrib.vertices[idx1 * 3 + 1], attrib.vertices[idx1 * 3 + 2] );
-				const float3 vert2 = make_float3( attrib.vertices[idx2 * 3 + 0], attrib.vertices[idx2 * 3 + 1], attrib.vertices[idx2 * 3 + 2] );
-				float3 N = normalize( cross( vert1 - vert0, vert2 - vert0 ) );
-				float3 vN0, vN1, vN2;
-				if (nidx0 > -1)
-				{
-					vN0 = make_float3( attrib.normals[nidx0 * 3 + 0], attrib.normals[nidx0 * 3 + 1], attrib.normals[nidx0 * 3 + 2] );
-					vN1 = make_float3( attrib.normals[nidx1 * 3 + 0], attrib.normals[nidx1 * 3 + 1], attrib.normals[nidx1 * 3 + 2] );
-					vN2 = make_float3( attrib.normals[nidx2 * 3 + 0], attrib.normals[nidx2 * 3 + 1], attrib.normals[nidx2 * 3 + 2] );
-				if (dot( N, vN0 ) < 0 && dot( N, vN1 ) < 0 && dot( N, vN2 ) < 0) N *= -1.0f; // flip if not consistent with vertex normals
-				alphas[nidx0] = min( alphas[nidx0], max( 0.7f, dot( vN0, N ) ) );
-				alphas[nidx1] = min( alphas[nidx1], max( 0.7f, dot( vN1, N ) ) );
-				alphas[nidx2] = min( alphas[nidx2], max( 0.7f, dot( vN2, N ) ) );
-			}
-				else
-				{
-					vN0 = vN1 = vN2 = N;
-				}
+	if (flatShaded) for (uint s = (uint)indices.size(), f = 0; f < s; f++) alphas[indices[f].normal_index] = 1; else
+		for (uint s = (uint)indices.size(), f = 0; f < s; f += 3)
+		{
+			const int idx0 = indices[f + 0].vertex_index, nidx0 = indices[f + 0].normal_index;
+			const int idx1 = indices[f + 1].vertex_index, nidx1 = indices[f + 1].normal_index;
+			const int idx2 = indices[f + 2].vertex_index, nidx2 = indices[f + 2].normal_index;
+			const float3 vert0 = make_float3( attrib.vertices[idx0 * 3 + 0], attrib.vertices[idx0 * 3 + 1], attrib.vertices[idx0 * 3 + 2] );
+			const float3 vert1 = make_float3( attrib.vertices[idx1 * 3 + 0], attrib.vertices[idx1 * 3 + 1], attrib.vertices[idx1 * 3 + 2] );
+			const float3 vert2 = make_float3( attrib.vertices[idx2 * 3 + 0], attrib.vertices[idx2 * 3 + 1], attrib.vertices[idx2 * 3 + 2] );
+			float3 N = normalize( cross( vert1 - vert0, vert2 - vert0 ) );
+			float3 vN0, vN1, vN2;
+			if (nidx0 > -1)
+			{
+				vN0 = make_float3( attrib.normals[nidx0 * 3 + 0], attrib.normals[nidx0 * 3 + 1], attrib.normals[nidx0 * 3 + 2] );
+				vN1 = make_float3( attrib.normals[nidx1 * 3 + 0], attrib.normals[nidx1 * 3 + 1], attrib.normals[nidx1 * 3 + 2] );
+				vN2 = make_float3( attrib.normals[nidx2 * 3 + 0], attrib.normals[nidx2 * 3 + 1], attrib.normals[nidx2 * 3 + 2] );
+			if (dot( N, vN0 ) < 0 && dot( N, vN1 ) < 0 && dot( N, vN2 ) < 0) N *= -1.0f; // flip if not consistent with vertex normals
+			alphas[nidx0] = min( alphas[nidx0], max( 0.7f, dot( vN0, N ) ) );
+			alphas[nidx1] = min( alphas[nidx1], max( 0.7f, dot( vN1, N ) ) );
+			alphas[nidx2] = min( alphas[nidx2], max( 0.7f, dot( vN2, N ) ) );
+		}
+			else
+			{
+				vN0 = vN1 = vN2 = N;
 			}
-	}
+		}
 	// finalize alpha values based on max dots
 	const float w = 0.03632f;
 	for (uint i = 0; i < verts; i++)
@@ -207,42 +488,36 @@ void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* director
 		alphas[i] = acosf( nnv ) * (1 + w * (1 - nnv) * (1 - nnv));
 	}
 	printf( "calculated vertex alphas in %5.3fs\n", timer.elapsed() );
-	// extract data for ray tracing: raw vertex and index data
-	aabb sceneBounds;
-	int toReserve = 0;
+	// extract data for ray tracing: raw vertex and index data; in parallel over blocks of triangles
+	const int blockSize = 65536, blockCount = (triCount + blockSize - 1) / blockSize;
+	vector<aabb> blockBounds( blockCount );
 	timer.reset();
-	for (auto& shape : shapes) toReserve += (int)shape.mesh.indices.size();
-	vertices.reserve( toReserve );
-	for (auto& shape : shapes) for (int f = 0; f < shape.mesh.indices.size(); f += 3)
-	{
-		const uint idx0 = shape.mesh.indices[f + 0].vertex_index;
-		const uint idx1 = shape.mesh.indices[f + 1].vertex_index;
-		const uint idx2 = shape.mesh.indices[f + 2].vertex_index;
-		const float3 v0 = make_float3( attrib.vertices[idx0 * 3 + 0], attrib.vertices[idx0 * 3 + 1], attrib.vertices[idx0 * 3 + 2] );
-		const float3 v1 = make_float3( attrib.vertices[idx1 * 3 + 0], attrib.vertices[idx1 * 3 + 1], attrib.vertices[idx1 * 3 + 2] );
-		const float3 v2 = make_float3( attrib.vertices[idx2 * 3 + 0], attrib.vertices[idx2 * 3 + 1], attrib.vertices[idx2 * 3 + 2] );
-		const float4 tv0 = make_float4( v0, 1 ) * transform;
-		const float4 tv1 = make_float4( v1, 1 ) * transform;
-		const float4 tv2 = make_float4( v2, 1 ) * transform;
-		vertices.push_back( tv0 );
-		vertices.push_back( tv1 );
-		vertices.push_back( tv2 );
-		sceneBounds.Grow( make_float3( tv0 ) );
-		sceneBounds.Grow( make_float3( tv1 ) );
-		sceneBounds.Grow( make_float3( tv2 ) );
-	}
-	printf( "created polygon soup for %i triangles in %5.3fs\n", (int)vertices.size() / 3, timer.elapsed() );
+	vertices.resize( triCount * 3 );
+	ParallelFor( 0, blockCount, [&]( int block ) {
+		for (int face = block * blockSize, last = min( triCount, face + blockSize ); face < last; face++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				const uint idx = indices[face * 3 + i].vertex_index;
+				const float3 v = make_float3( attrib.vertices[idx * 3 + 0], attrib.vertices[idx * 3 + 1], attrib.vertices[idx * 3 + 2] );
+				vertices[face * 3 + i] = make_float4( v, 1 ) * transform;
+				blockBounds[block].Grow( make_float3( vertices[face * 3 + i] ) );
+			}
+		}
+	} );
+	aabb sceneBounds;
+	for (const aabb& bounds : blockBounds) sceneBounds.Grow( bounds );
+	printf( "created polygon soup for %i triangles in %5.3fs\n", triCount, timer.elapsed() );
 	printf( "scene bounds: (%5.2f,%5.2f,%5.2f)-(%5.2f,%5.2f,%5.2f)\n",
 		sceneBounds.bmin3.x, sceneBounds.bmin3.y, sceneBounds.bmin3.z,
 		sceneBounds.bmax3.x, sceneBounds.bmax3.y, sceneBounds.bmax3.z );
 	// extract full model data and materials
 	timer.reset();
-	triangles.resize( vertices.size() / 3 );
-	for (int s = (int)shapes.size(), face = 0, i = 0; i < s; i++)
-	{
-		vector<tinyobj::index_t>& indices = shapes[i].mesh.indices;
-		for (int s = (int)shapes[i].mesh.indices.size(), f = 0; f < s; f += 3, face++)
+	triangles.resize( triCount );
+	ParallelFor( 0, blockCount, [&]( int block ) {
+		for (int face = block * blockSize, last = min( triCount, face + blockSize ); face < last; face++)
 		{
+			const int f = face * 3;
 			HostTri& tri = triangles[face];
 			tri.vertex0 = make_float3( vertices[face * 3 + 0] );
 			tri.vertex1 = make_float3( vertices[face * 3 + 1] );
@@ -290,7 +565,8 @@ void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* director
 				tri.B = normalize( cross( N, tri.T ) );
 			}
 			tri.Nx = N.x, tri.Ny = N.y, tri.Nz = N.z;
-			tri.material = shapes[i].mesh.material_ids[f / 3] + matIdxOffset;
+			const int objMaterial = shape.mesh.material_ids[face];
+			tri.material = objMaterial < 0 ? objMaterial + matIdxOffset : matIdx[objMaterial];
 		#if 0
 			const float a = (tri.vertex1 - tri.vertex0).length();
 			const float b = (tri.vertex2 - tri.vertex1).length();
@@ -316,47 +592,175 @@ void HostMesh::LoadGeometryFromOBJ( const string& fileName, const char* director
 				tri.LOD = 0.5f * log2f( Ta / Pa );
 			}
 		}
-	}
+	} );
 	printf( "verbose triangle data in %5.3fs\n", timer.elapsed() );
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  glTF accessors                                                             |
+//  |  Bulk readers: an accessor is read into a caller-allocated array of         |
+//  |  'components' floats or uints per element. Strides, (normalized) integer    |
+//  |  components and sparse accessors are handled; common layouts are copied     |
+//  |  or widened with SSE, the rest is converted per component.            LH2'20|
+//  +-----------------------------------------------------------------------------+
+static float ComponentToFloat( const uchar* p, const int type, const bool normalized )
+{
+	switch (type)
+	{
+	case TINYGLTF_COMPONENT_TYPE_BYTE: { const signed char v = *(const signed char*)p; return normalized ? max( v / 127.0f, -1.0f ) : v; }
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return normalized ? *p / 255.0f : *p;
+	case TINYGLTF_COMPONENT_TYPE_SHORT: { short v; memcpy( &v, p, 2 ); return normalized ? max( v / 32767.0f, -1.0f ) : v; }
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: { ushort v; memcpy( &v, p, 2 ); return normalized ? v / 65535.0f : v; }
+	case TINYGLTF_COMPONENT_TYPE_INT: { int v; memcpy( &v, p, 4 ); return (float)v; }
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: { uint v; memcpy( &v, p, 4 ); return (float)v; }
+	case TINYGLTF_COMPONENT_TYPE_FLOAT: { float v; memcpy( &v, p, 4 ); return v; }
+	case TINYGLTF_COMPONENT_TYPE_DOUBLE: { double v; memcpy( &v, p, 8 ); return (float)v; }
+	default: return 0;
+	}
+}
+
+static uint ComponentToUint( const uchar* p, const int type )
+{
+	switch (type)
+	{
+	case TINYGLTF_COMPONENT_TYPE_BYTE: return (uint)*(const signed char*)p;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return *p;
+	case TINYGLTF_COMPONENT_TYPE_SHORT: { short v; memcpy( &v, p, 2 ); return (uint)v; }
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: { ushort v; memcpy( &v, p, 2 ); return v; }
+	case TINYGLTF_COMPONENT_TYPE_INT: case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: { uint v; memcpy( &v, p, 4 ); return v; }
+	case TINYGLTF_COMPONENT_TYPE_FLOAT: { float v; memcpy( &v, p, 4 ); return (uint)v; }
+	default: return 0;
+	}
+}
+
+static void ConvertElements( const uchar* src, const int stride, const size_t count, const int components, const int type, const bool normalized, float* dst )
+{
+	const int size = GetComponentSizeInBytes( type ), elementSize = size * components;
+	if (type == TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		// plain floats: one copy if tightly packed, else one per element
+		if (stride == elementSize) memcpy( dst, src, count * elementSize );
+		else for (size_t i = 0; i < count; i++) memcpy( dst + i * components, src + i * stride, elementSize );
+	}
+	else if (components == 4 && size < 4)
+	{
+		// vec4 of (normalized) bytes or shorts, e.g. weights, tangents and colors: widen to four ints at once
+		const bool isSigned = type == TINYGLTF_COMPONENT_TYPE_BYTE || type == TINYGLTF_COMPONENT_TYPE_SHORT;
+		const float range = size == 1 ? (isSigned ? 127.0f : 255.0f) : (isSigned ? 32767.0f : 65535.0f);
+		const __m128 scale = _mm_set1_ps( normalized ? 1.0f / range : 1.0f ), lowest = _mm_set1_ps( normalized ? -1.0f : -1e34f );
+		for (size_t i = 0; i < count; i++, src += stride)
+		{
+			__m128i v;
+			if (size == 1)
+			{
+				int packed;
+				memcpy( &packed, src, 4 );
+				v = isSigned ? _mm_cvtepi8_epi32( _mm_cvtsi32_si128( packed ) ) : _mm_cvtepu8_epi32( _mm_cvtsi32_si128( packed ) );
+			}
+			else
+			{
+				const __m128i packed = _mm_loadl_epi64( (const __m128i*)src );
+				v = isSigned ? _mm_cvtepi16_epi32( packed ) : _mm_cvtepu16_epi32( packed );
+			}
+			_mm_storeu_ps( dst + i * 4, _mm_max_ps( _mm_mul_ps( _mm_cvtepi32_ps( v ), scale ), lowest ) );
+		}
+	}
+	else for (size_t i = 0; i < count; i++) for (int c = 0; c < components; c++)
+		dst[i * components + c] = ComponentToFloat( src + i * stride + c * size, type, normalized );
+}
+
+static void ConvertElements( const uchar* src, const int stride, const size_t count, const int components, const int type, uint* dst )
+{
+	const int size = GetComponentSizeInBytes( type ), elementSize = size * components;
+	if ((type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT || type == TINYGLTF_COMPONENT_TYPE_INT) && stride == elementSize)
+	{
+		memcpy( dst, src, count * elementSize );
+	}
+	else if (type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT && stride == elementSize)
+	{
+		// tightly packed ushorts, e.g. most index buffers: eight at a time
+		const size_t values = count * components, blocks = values / 8;
+		for (size_t i = 0; i < blocks; i++)
+		{
+			const __m128i packed = _mm_loadu_si128( (const __m128i*)(src + i * 16) );
+			_mm_storeu_si128( (__m128i*)(dst + i * 8), _mm_cvtepu16_epi32( packed ) );
+			_mm_storeu_si128( (__m128i*)(dst + i * 8 + 4), _mm_cvtepu16_epi32( _mm_srli_si128( packed, 8 ) ) );
+		}
+		for (size_t i = blocks * 8; i < values; i++) dst[i] = ComponentToUint( src + i * 2, type );
+	}
+	else for (size_t i = 0; i < count; i++) for (int c = 0; c < components; c++)
+		dst[i * components + c] = ComponentToUint( src + i * stride + c * size, type );
+}
+
+template <class T> static void ReadAccessor( const tinygltfModel& model, const Accessor& accessor, const int components, T* dst )
+{
+	const size_t count = accessor.count;
+	if (accessor.bufferView < 0) memset( dst, 0, count * components * sizeof( T ) ); else // sparse only: base values are zero
+	{
+		const BufferView& view = model.bufferViews[accessor.bufferView];
+		const int stride = accessor.ByteStride( view );
+		FATALERROR_IF( stride <= 0, "invalid accessor stride in gltf file" );
+		const uchar* src = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+		if constexpr (is_same<T, float>::value) ConvertElements( src, stride, count, components, accessor.componentType, accessor.normalized, dst );
+		else ConvertElements( src, stride, count, components, accessor.componentType, dst );
+	}
+	if (!accessor.sparse.isSparse) return;
+	// sparse accessor: replace the listed elements
+	const auto& sparse = accessor.sparse;
+	const BufferView& indexView = model.bufferViews[sparse.indices.bufferView];
+	const BufferView& valueView = model.bufferViews[sparse.values.bufferView];
+	const int indexSize = GetComponentSizeInBytes( sparse.indices.componentType );
+	vector<uint> indices( sparse.count );
+	vector<T> values( sparse.count * components );
+	ConvertElements( model.buffers[indexView.buffer].data.data() + indexView.byteOffset + sparse.indices.byteOffset, indexSize, sparse.count, 1, sparse.indices.componentType, indices.data() );
+	const uchar* valueSrc = model.buffers[valueView.buffer].data.data() + valueView.byteOffset + sparse.values.byteOffset;
+	const int valueStride = GetComponentSizeInBytes( accessor.componentType ) * components;
+	if constexpr (is_same<T, float>::value) ConvertElements( valueSrc, valueStride, sparse.count, components, accessor.componentType, accessor.normalized, values.data() );
+	else ConvertElements( valueSrc, valueStride, sparse.count, components, accessor.componentType, values.data() );
+	for (int i = 0; i < sparse.count; i++)
+	{
+		FATALERROR_IF( indices[i] >= count, "sparse accessor index out of range in gltf file" );
+		memcpy( dst + indices[i] * components, values.data() + i * components, components * sizeof( T ) );
+	}
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostMesh::ConvertFromGTLFMesh                                              |
-//  |  Convert a gltf mesh to a HostMesh.                                   LH2'19|
+//  |  Convert a gltf mesh to a HostMesh. The triangles keep the glTF material    |
+//  |  indices, and 'colorTextures' holds the color texture of each glTF          |
+//  |  material, so the scene is not accessed; see ResolveStagedMaterials.  LH2'20|
 //  +-----------------------------------------------------------------------------+
-void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<int>& matIdx, const int materialOverride )
+void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<HostTexture*>& colorTextures, const int materialOverride )
 {
 	const int targetCount = (int)gltfMesh.weights.size();
 	for (auto& prim : gltfMesh.primitives)
 	{
-		// load indices
-		const Accessor& accessor = gltfModel.accessors[prim.indices];
-		const BufferView& view = gltfModel.bufferViews[accessor.bufferView];
-		const Buffer& buffer = gltfModel.buffers[view.buffer];
-		const uchar* a /* brevity */ = buffer.data.data() + view.byteOffset + accessor.byteOffset;
-		const int byteStride = accessor.ByteStride( view );
-		const size_t count = accessor.count;
-		// allocate the index array in the pointer-to-base declared in the parent scope
 		vector<int> tmpIndices;
 		vector<float3> tmpNormals, tmpVertices;
 		vector<float2> tmpUvs, tmpUv2s /* texture layer 2 */;
 		vector<uint4> tmpJoints;
 		vector<float4> tmpWeights, tmpTs;
-		switch (accessor.componentType)
+		// load indices; non-indexed primitives use their vertices in order
+		if (prim.indices > -1)
 		{
-		case TINYGLTF_COMPONENT_TYPE_BYTE: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((char*)a) ); break;
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((uchar*)a) ); break;
-		case TINYGLTF_COMPONENT_TYPE_SHORT: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((short*)a) ); break;
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((ushort*)a) ); break;
-		case TINYGLTF_COMPONENT_TYPE_INT: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((int*)a) ); break;
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: for (int k = 0; k < count; k++, a += byteStride) tmpIndices.push_back( *((uint*)a) ); break;
-		default: break;
+			const Accessor& accessor = gltfModel.accessors[prim.indices];
+			FATALERROR_IF( accessor.type != TINYGLTF_TYPE_SCALAR, "expected scalar indices in gltf file" );
+			tmpIndices.resize( accessor.count );
+			ReadAccessor( gltfModel, accessor, 1, (uint*)tmpIndices.data() );
+		}
+		else
+		{
+			const auto position = prim.attributes.find( "POSITION" );
+			if (position == prim.attributes.end()) continue;
+			tmpIndices.resize( gltfModel.accessors[position->second].count );
+			for (int s = (int)tmpIndices.size(), i = 0; i < s; i++) tmpIndices[i] = i;
 		}
 		// turn into faces - re-arrange the indices so that it describes a simple list of triangles
 		if (prim.mode == TINYGLTF_MODE_TRIANGLE_FAN)
 		{
 			vector<int> fan = move( tmpIndices );
 			tmpIndices.clear();
+			tmpIndices.reserve( fan.size() > 2 ? (fan.size() - 2) * 3 : 0 );
 			for (size_t s = fan.size(), i = 2; i < s; i++)
 			{
 				tmpIndices.push_back( fan[0] );
@@ -368,6 +772,7 @@ void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltf
 		{
 			vector<int> strip = move( tmpIndices );
 			tmpIndices.clear();
+			tmpIndices.reserve( strip.size() > 2 ? (strip.size() - 2) * 3 : 0 );
 			for (size_t s = strip.size(), i = 2; i < s; i++)
 			{
 				tmpIndices.push_back( strip[i - 2] );
@@ -379,53 +784,32 @@ void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltf
 		// we now have a simple list of vertex indices, 3 per triangle (TINYGLTF_MODE_TRIANGLES)
 		for (const auto& attribute : prim.attributes)
 		{
-			const Accessor attribAccessor = gltfModel.accessors[attribute.second];
-			const BufferView& bufferView = gltfModel.bufferViews[attribAccessor.bufferView];
-			const Buffer& buffer = gltfModel.buffers[bufferView.buffer];
-			const uchar* a = buffer.data.data() + bufferView.byteOffset + attribAccessor.byteOffset;
-			const int byte_stride = attribAccessor.ByteStride( bufferView );
+			const Accessor& attribAccessor = gltfModel.accessors[attribute.second];
 			const size_t count = attribAccessor.count;
 			if (attribute.first == "POSITION")
 			{
-				float3 boundsMin = make_float3( attribAccessor.minValues[0], attribAccessor.minValues[1], attribAccessor.minValues[2] );
-				float3 boundsMax = make_float3( attribAccessor.maxValues[0], attribAccessor.maxValues[1], attribAccessor.maxValues[2] );
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC3)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride) tmpVertices.push_back( *((float3*)a) );
-					else FATALERROR( "double precision positions not supported in gltf file" );
-				else FATALERROR( "unsupported position definition in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC3, "unsupported position definition in gltf file" );
+				tmpVertices.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 3, (float*)tmpVertices.data() );
 			}
 			else if (attribute.first == "NORMAL")
 			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC3)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride) tmpNormals.push_back( *((float3*)a) );
-					else FATALERROR( "double precision normals not supported in gltf file" );
-				else FATALERROR( "expected vec3 normals in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC3, "expected vec3 normals in gltf file" );
+				tmpNormals.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 3, (float*)tmpNormals.data() );
 			}
 			else if (attribute.first == "TANGENT")
 			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC4)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride) tmpTs.push_back( *((float4*)a) );
-					else FATALERROR( "double precision tangents not supported in gltf file" );
-				else FATALERROR( "expected vec4 uvs in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC4, "expected vec4 tangents in gltf file" );
+				tmpTs.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 4, (float*)tmpTs.data() );
 			}
-			else if (attribute.first == "TEXCOORD_0")
+			else if (attribute.first == "TEXCOORD_0" || attribute.first == "TEXCOORD_1")
 			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC2)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride) tmpUvs.push_back( *((float2*)a) );
-					else FATALERROR( "double precision uvs not supported in gltf file" );
-				else FATALERROR( "expected vec2 uvs in gltf file" );
-			}
-			else if (attribute.first == "TEXCOORD_1")
-			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC2)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride) tmpUv2s.push_back( *((float2*)a) );
-					else FATALERROR( "double precision uvs not supported in gltf file" );
-				else FATALERROR( "expected vec2 uvs in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC2, "expected vec2 uvs in gltf file" );
+				vector<float2>& uvs = attribute.first == "TEXCOORD_0" ? tmpUvs : tmpUv2s;
+				uvs.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 2, (float*)uvs.data() );
 			}
 			else if (attribute.first == "COLOR_0")
 			{
@@ -433,30 +817,16 @@ void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltf
 			}
 			else if (attribute.first == "JOINTS_0")
 			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC4)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-						for (size_t i = 0; i < count; i++, a += byte_stride)
-							tmpJoints.push_back( make_uint4( *((ushort*)a), *((ushort*)(a + 2)), *((ushort*)(a + 4)), *((ushort*)(a + 6)) ) );
-					else if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-						for (size_t i = 0; i < count; i++, a += byte_stride)
-							tmpJoints.push_back( make_uint4( *((uchar*)a), *((uchar*)(a + 1)), *((uchar*)(a + 2)), *((uchar*)(a + 3)) ) );
-					else FATALERROR( "expected ushorts or uchars for joints in gltf file" );
-				else FATALERROR( "expected vec4s for joints in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC4, "expected vec4s for joints in gltf file" );
+				tmpJoints.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 4, (uint*)tmpJoints.data() );
 			}
 			else if (attribute.first == "WEIGHTS_0")
 			{
-				if (attribAccessor.type == TINYGLTF_TYPE_VEC4)
-					if (attribAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
-						for (size_t i = 0; i < count; i++, a += byte_stride)
-						{
-							float4 w4;
-							memcpy( &w4, a, sizeof( float4 ) );
-							float norm = 1.0f / (w4.x + w4.y + w4.z + w4.w);
-							w4 *= norm;
-							tmpWeights.push_back( w4 );
-						}
-					else FATALERROR( "double precision uvs not supported in gltf file" );
-				else FATALERROR( "expected vec4 weights in gltf file" );
+				FATALERROR_IF( attribAccessor.type != TINYGLTF_TYPE_VEC4, "expected vec4 weights in gltf file" );
+				tmpWeights.resize( count );
+				ReadAccessor( gltfModel, attribAccessor, 4, (float*)tmpWeights.data() );
+				for (float4& w4 : tmpWeights) w4 *= 1.0f / (w4.x + w4.y + w4.z + w4.w);
 			}
 			else if (attribute.first == "TEXCOORD_2")
 			{
@@ -481,33 +851,29 @@ void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltf
 		{
 			// store base pose
 			tmpPoses.push_back( Pose() );
-			for (int s = (int)tmpVertices.size(), i = 0; i < s; i++)
-			{
-				tmpPoses[0].positions.push_back( tmpVertices[i] );
-				tmpPoses[0].normals.push_back( tmpNormals[i] );
-				tmpPoses[0].tangents.push_back( make_float3( 0 ) /* TODO */ );
-			}
+			tmpPoses[0].positions = tmpVertices;
+			tmpPoses[0].normals = tmpNormals;
+			tmpPoses[0].tangents.assign( tmpVertices.size(), make_float3( 0 ) /* TODO */ );
 		}
 		for (int i = 0; i < targetCount; i++)
 		{
 			tmpPoses.push_back( Pose() );
 			for (const auto& target : prim.targets[i])
 			{
-				const Accessor accessor = gltfModel.accessors[target.second];
-				const BufferView& view = gltfModel.bufferViews[accessor.bufferView];
-				const float* a = (const float*)(gltfModel.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset);
-				for (int j = 0; j < accessor.count; j++)
-				{
-					float3 v = make_float3( a[j * 3], a[j * 3 + 1], a[j * 3 + 2] );
-					if (target.first == "POSITION") tmpPoses[i + 1].positions.push_back( v );
-					if (target.first == "NORMAL") tmpPoses[i + 1].normals.push_back( v );
-					if (target.first == "TANGENT") tmpPoses[i + 1].tangents.push_back( v );
-				}
+				// morph target displacements are vec3, tangents included; often sparse
+				vector<float3>* data = nullptr;
+				if (target.first == "POSITION") data = &tmpPoses[i + 1].positions;
+				if (target.first == "NORMAL") data = &tmpPoses[i + 1].normals;
+				if (target.first == "TANGENT") data = &tmpPoses[i + 1].tangents;
+				if (!data) continue;
+				const Accessor& accessor = gltfModel.accessors[target.second];
+				data->resize( accessor.count );
+				ReadAccessor( gltfModel, accessor, 3, (float*)data->data() );
 			}
 		}
 		// all data has been read; add triangles to the HostMesh
 		BuildFromIndexedData( tmpIndices, tmpVertices, tmpNormals, tmpUvs, tmpUv2s, tmpTs, tmpPoses,
-			tmpJoints, tmpWeights, materialOverride == -1 ? matIdx[prim.material] : materialOverride );
+			tmpJoints, tmpWeights, materialOverride == -1 ? prim.material : materialOverride, &colorTextures );
 	}
 }
 
@@ -515,171 +881,216 @@ void HostMesh::ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltf
 //  |  HostMesh::BuildFromIndexedData                                             |
 //  |  We use non-indexed triangles, so three subsequent vertices form a tri,     |
 //  |  to skip one indirection during intersection. glTF and obj store indexed    |
-//  |  data, which we now convert to the final representation.              LH2'19|
+//  |  data, which we now convert to the final representation.                    |
+//  |  Triangles are processed in parallel chunks. Per chunk, edges and uv        |
+//  |  deltas are gathered into SoA arrays, from which face normals and tangent   |
+//  |  frames are calculated four triangles at a time. Work that touches shared   |
+//  |  data (vertex alphas, material copies) is done afterwards.                  |
+//  |  With 'stagedTextures', 'materialIdx' is a staged material index and the    |
+//  |  color texture is taken from that list; material copies are then left to    |
+//  |  ResolveStagedMaterials.                                              LH2'20|
 //  +-----------------------------------------------------------------------------+
 void HostMesh::BuildFromIndexedData( const vector<int>& tmpIndices, const vector<float3>& tmpVertices,
 	const vector<float3>& tmpNormals, const vector<float2>& tmpUvs, const vector<float2>& tmpUv2s,
 	const vector<float4>& tmpTs, const vector<Pose>& tmpPoses,
-	const vector<uint4>& tmpJoints, const vector<float4>& tmpWeights, const int materialIdx )
+	const vector<uint4>& tmpJoints, const vector<float4>& tmpWeights, const int materialIdx,
+	const vector<HostTexture*>* stagedTextures )
 {
-	// calculate values for consistent normal interpolation
-	vector<float> tmpAlphas;
-	tmpAlphas.resize( tmpVertices.size(), 1.0f ); // we will have one alpha value per unique vertex
-	for (size_t s = tmpIndices.size(), i = 0; i < s; i += 3)
-	{
-		const uint v0idx = tmpIndices[i + 0], v1idx = tmpIndices[i + 1], v2idx = tmpIndices[i + 2];
-		const float3 vert0 = tmpVertices[v0idx], vert1 = tmpVertices[v1idx], vert2 = tmpVertices[v2idx];
-		float3 N = normalize( cross( vert1 - vert0, vert2 - vert0 ) );
-		float3 vN0, vN1, vN2;
-		if (tmpNormals.size() > 0)
+	const int triCount = (int)tmpIndices.size() / 3;
+	const bool hasNormals = tmpNormals.size() > 0, hasUvs = tmpUvs.size() > 0, hasUv2s = tmpUv2s.size() > 0, hasJoints = tmpJoints.size() > 0;
+	// texture used for the LOD value and for single-texel triangles
+	HostTexture* texture = 0;
+	if (stagedTextures) texture = materialIdx >= 0 && materialIdx < (int)stagedTextures->size() ? (*stagedTextures)[materialIdx] : 0;
+	else if (HostScene::materials[materialIdx]->color.textureID > -1) texture = HostScene::textures[HostScene::materials[materialIdx]->color.textureID];
+	const float texelCount = texture ? (float)texture->width * texture->height : 0;
+	// make room for the new data
+	const size_t firstTri = triangles.size(), firstVertex = vertices.size(), firstJoint = joints.size();
+	triangles.resize( firstTri + triCount );
+	vertices.resize( firstVertex + triCount * 3 );
+	if (hasJoints) joints.resize( firstJoint + triCount * 3 ), weights.resize( firstJoint + triCount * 3 );
+	if (poses.size() < tmpPoses.size()) poses.resize( tmpPoses.size() );
+	vector<size_t> firstPoseVertex( tmpPoses.size() );
+	for (size_t s = tmpPoses.size(), i = 0; i < s; i++)
+	{
+		firstPoseVertex[i] = poses[i].positions.size();
+		poses[i].positions.resize( firstPoseVertex[i] + triCount * 3 );
+		poses[i].normals.resize( firstPoseVertex[i] + triCount * 3 );
+		poses[i].tangents.resize( firstPoseVertex[i] + triCount * 3 );
+	}
+	// per corner: cosine between vertex normal and face normal, for the alpha values
+	vector<float> cornerDot( triCount * 3 );
+	const int chunkSize = 256, chunkCount = (triCount + chunkSize - 1) / chunkSize;
+	vector<vector<int>> singleTexel( chunkCount ); // triangles that use a single point on the texture
+	ParallelFor( 0, chunkCount, [&]( int chunk ) {
+		const int first = chunk * chunkSize, count = min( chunkSize, triCount - first ), padded = (count + 3) & ~3;
+		// SoA intermediates
+		alignas( 16 ) float e1[3][chunkSize], e2[3][chunkSize], uv01[2][chunkSize], uv02[2][chunkSize];
+		alignas( 16 ) float N[3][chunkSize], T[3][chunkSize], B[3][chunkSize], crossLength[chunkSize];
+		for (int i = 0; i < padded; i++)
 		{
-			vN0 = tmpNormals[v0idx], vN1 = tmpNormals[v1idx], vN2 = tmpNormals[v2idx];
-			if (dot( N, vN0 ) < 0 && dot( N, vN1 ) < 0 && dot( N, vN2 ) < 0) N *= -1.0f; // flip if not consistent with vertex normals
+			float3 d1 = make_float3( 0 ), d2 = make_float3( 0 );
+			float2 t1 = make_float2( 0 ), t2 = make_float2( 0 );
+			if (i < count)
+			{
+				const int* idx = tmpIndices.data() + (first + i) * 3;
+				const float3 v0 = tmpVertices[idx[0]];
+				d1 = tmpVertices[idx[1]] - v0, d2 = tmpVertices[idx[2]] - v0;
+				if (hasUvs) t1 = tmpUvs[idx[1]] - tmpUvs[idx[0]], t2 = tmpUvs[idx[2]] - tmpUvs[idx[0]];
+			}
+			e1[0][i] = d1.x, e1[1][i] = d1.y, e1[2][i] = d1.z, e2[0][i] = d2.x, e2[1][i] = d2.y, e2[2][i] = d2.z;
+			uv01[0][i] = t1.x, uv01[1][i] = t1.y, uv02[0][i] = t2.x, uv02[1][i] = t2.y;
 		}
-		else
+		// face normals and uv-based tangent frames, four triangles at a time
+		for (int i = 0; i < padded; i += 4)
 		{
-			// no normals supplied; copy face normal
-			vN0 = vN1 = vN2 = N;
-		}
-		// Note: we clamp at approx. 45 degree angles; beyond this the approach fails.
-		tmpAlphas[v0idx] = min( tmpAlphas[v0idx], dot( vN0, N ) );
-		tmpAlphas[v1idx] = min( tmpAlphas[v1idx], dot( vN1, N ) );
-		tmpAlphas[v2idx] = min( tmpAlphas[v2idx], dot( vN2, N ) );
-	}
-	for (size_t s = tmpAlphas.size(), i = 0; i < s; i++)
-	{
-		const float nnv = tmpAlphas[i]; // temporarily stored there
-		tmpAlphas[i] = acosf( nnv ) * (1 + 0.03632f * (1 - nnv) * (1 - nnv));
-	}
-	// prepare poses
-	if (tmpPoses.size() > 0) for (auto& pose : tmpPoses) poses.push_back( Pose() );
-	// build final mesh structures
-	const size_t newTriangleCount = tmpIndices.size() / 3;
-	size_t triIdx = triangles.size();
-	triangles.resize( triIdx + newTriangleCount );
-	for (size_t i = 0; i < newTriangleCount; i++, triIdx++)
-	{
-		HostTri& tri = triangles[triIdx];
-		tri.material = materialIdx;
-		const uint v0idx = tmpIndices[i * 3 + 0];
-		const uint v1idx = tmpIndices[i * 3 + 1];
-		const uint v2idx = tmpIndices[i * 3 + 2];
-		const float3 v0pos = tmpVertices[v0idx];
-		const float3 v1pos = tmpVertices[v1idx];
-		const float3 v2pos = tmpVertices[v2idx];
-		vertices.push_back( make_float4( v0pos, 1 ) );
-		vertices.push_back( make_float4( v1pos, 1 ) );
-		vertices.push_back( make_float4( v2pos, 1 ) );
-		const float3 N = normalize( cross( v1pos - v0pos, v2pos - v0pos ) );
-		tri.Nx = N.x, tri.Ny = N.y, tri.Nz = N.z;
-		tri.vertex0 = tmpVertices[v0idx];
-		tri.vertex1 = tmpVertices[v1idx];
-		tri.vertex2 = tmpVertices[v2idx];
-		tri.alpha = make_float3( tmpAlphas[v0idx], tmpAlphas[v1idx], tmpAlphas[v2idx] );
-		if (tmpNormals.size() > 0)
-			tri.vN0 = tmpNormals[v0idx],
-			tri.vN1 = tmpNormals[v1idx],
-			tri.vN2 = tmpNormals[v2idx];
-		else
-			tri.vN0 = tri.vN1 = tri.vN2 = N;
-		if (tmpUvs.size() > 0)
+			const __m128 ax = _mm_load_ps( e1[0] + i ), ay = _mm_load_ps( e1[1] + i ), az = _mm_load_ps( e1[2] + i );
+			const __m128 bx = _mm_load_ps( e2[0] + i ), by = _mm_load_ps( e2[1] + i ), bz = _mm_load_ps( e2[2] + i );
+			const __m128 nx = _mm_sub_ps( _mm_mul_ps( ay, bz ), _mm_mul_ps( az, by ) );
+			const __m128 ny = _mm_sub_ps( _mm_mul_ps( az, bx ), _mm_mul_ps( ax, bz ) );
+			const __m128 nz = _mm_sub_ps( _mm_mul_ps( ax, by ), _mm_mul_ps( ay, bx ) );
+			const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, nx ), _mm_mul_ps( ny, ny ) ), _mm_mul_ps( nz, nz ) ) );
+			const __m128 invLength = _mm_div_ps( _mm_set1_ps( 1 ), length );
+			_mm_store_ps( N[0] + i, _mm_mul_ps( nx, invLength ) );
+			_mm_store_ps( N[1] + i, _mm_mul_ps( ny, invLength ) );
+			_mm_store_ps( N[2] + i, _mm_mul_ps( nz, invLength ) );
+			_mm_store_ps( crossLength + i, length );
+			if (!hasUvs) continue;
+			// T = e1 * uv02.y - e2 * uv01.y, B = e2 * uv01.x - e1 * uv02.x
+			const __m128 s1 = _mm_load_ps( uv01[0] + i ), t1 = _mm_load_ps( uv01[1] + i );
+			const __m128 s2 = _mm_load_ps( uv02[0] + i ), t2 = _mm_load_ps( uv02[1] + i );
+			const __m128 tx = _mm_sub_ps( _mm_mul_ps( ax, t2 ), _mm_mul_ps( bx, t1 ) );
+			const __m128 ty = _mm_sub_ps( _mm_mul_ps( ay, t2 ), _mm_mul_ps( by, t1 ) );
+			const __m128 tz = _mm_sub_ps( _mm_mul_ps( az, t2 ), _mm_mul_ps( bz, t1 ) );
+			const __m128 qx = _mm_sub_ps( _mm_mul_ps( bx, s1 ), _mm_mul_ps( ax, s2 ) );
+			const __m128 qy = _mm_sub_ps( _mm_mul_ps( by, s1 ), _mm_mul_ps( ay, s2 ) );
+			const __m128 qz = _mm_sub_ps( _mm_mul_ps( bz, s1 ), _mm_mul_ps( az, s2 ) );
+			const __m128 invT = _mm_div_ps( _mm_set1_ps( 1 ), _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( tx, tx ), _mm_mul_ps( ty, ty ) ), _mm_mul_ps( tz, tz ) ) ) );
+			const __m128 invB = _mm_div_ps( _mm_set1_ps( 1 ), _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( qx, qx ), _mm_mul_ps( qy, qy ) ), _mm_mul_ps( qz, qz ) ) ) );
+			_mm_store_ps( T[0] + i, _mm_mul_ps( tx, invT ) ), _mm_store_ps( T[1] + i, _mm_mul_ps( ty, invT ) ), _mm_store_ps( T[2] + i, _mm_mul_ps( tz, invT ) );
+			_mm_store_ps( B[0] + i, _mm_mul_ps( qx, invB ) ), _mm_store_ps( B[1] + i, _mm_mul_ps( qy, invB ) ), _mm_store_ps( B[2] + i, _mm_mul_ps( qz, invB ) );
+		}
+		// assemble the triangles
+		for (int i = 0; i < count; i++)
 		{
-			tri.u0 = tmpUvs[v0idx].x, tri.v0 = tmpUvs[v0idx].y;
-			tri.u1 = tmpUvs[v1idx].x, tri.v1 = tmpUvs[v1idx].y;
-			tri.u2 = tmpUvs[v2idx].x, tri.v2 = tmpUvs[v2idx].y;
-			if (tri.u0 == tri.u1 && tri.u1 == tri.u2 && tri.v0 == tri.v1 && tri.v1 == tri.v2)
-			{
-				// this triangle uses only a single point on the texture; replace by single color material.
-				int textureID = HostScene::materials[materialIdx]->color.textureID;
-				if (textureID != -1)
+			const int triIdx = first + i;
+			HostTri& tri = triangles[firstTri + triIdx];
+			const uint v0idx = tmpIndices[triIdx * 3 + 0], v1idx = tmpIndices[triIdx * 3 + 1], v2idx = tmpIndices[triIdx * 3 + 2];
+			const float3 N3 = make_float3( N[0][i], N[1][i], N[2][i] );
+			tri.material = materialIdx;
+			tri.vertex0 = tmpVertices[v0idx], tri.vertex1 = tmpVertices[v1idx], tri.vertex2 = tmpVertices[v2idx];
+			float4* v = vertices.data() + firstVertex + triIdx * 3;
+			v[0] = make_float4( tri.vertex0, 1 ), v[1] = make_float4( tri.vertex1, 1 ), v[2] = make_float4( tri.vertex2, 1 );
+			tri.Nx = N3.x, tri.Ny = N3.y, tri.Nz = N3.z;
+			if (hasNormals) tri.vN0 = tmpNormals[v0idx], tri.vN1 = tmpNormals[v1idx], tri.vN2 = tmpNormals[v2idx];
+			else tri.vN0 = tri.vN1 = tri.vN2 = N3;
+			// alpha input; face normal flipped if not consistent with vertex normals
+			const float3 F = (dot( N3, tri.vN0 ) < 0 && dot( N3, tri.vN1 ) < 0 && dot( N3, tri.vN2 ) < 0) ? N3 * -1.0f : N3;
+			cornerDot[triIdx * 3 + 0] = dot( tri.vN0, F ), cornerDot[triIdx * 3 + 1] = dot( tri.vN1, F ), cornerDot[triIdx * 3 + 2] = dot( tri.vN2, F );
+			if (hasUvs)
+			{
+				tri.u0 = tmpUvs[v0idx].x, tri.v0 = tmpUvs[v0idx].y;
+				tri.u1 = tmpUvs[v1idx].x, tri.v1 = tmpUvs[v1idx].y;
+				tri.u2 = tmpUvs[v2idx].x, tri.v2 = tmpUvs[v2idx].y;
+				// a triangle that uses only a single point on the texture gets a single color material; see below
+				if (texture && tri.u0 == tri.u1 && tri.u1 == tri.u2 && tri.v0 == tri.v1 && tri.v1 == tri.v2) singleTexel[chunk].push_back( triIdx );
+				const float s1 = uv01[0][i], t1 = uv01[1][i], s2 = uv02[0][i], t2 = uv02[1][i];
+				if (s1 * s1 + t1 * t1 == 0 || s2 * s2 + t2 * t2 == 0)
 				{
-					HostTexture* texture = HostScene::textures[textureID];
-					uint u = (uint)(tri.u0 * texture->width) % texture->width;
-					uint v = (uint)(tri.v0 * texture->height) % texture->height;
-					uint texel = ((uint*)texture->idata)[u + v * texture->width] & 0xffffff;
-					tri.material = HostScene::FindOrCreateMaterialCopy( materialIdx, texel );
-					int w = 0;
+					// PBRT:
+					// https://github.com/mmp/pbrt-v3/blob/3f94503ae1777cd6d67a7788e06d67224a525ff4/src/shapes/triangle.cpp#L381
+					if (std::abs( N3.x ) > std::abs( N3.y ))
+						tri.T = make_float3( -N3.z, 0, N3.x ) / std::sqrt( N3.x * N3.x + N3.z * N3.z );
+					else
+						tri.T = make_float3( 0, N3.z, -N3.y ) / std::sqrt( N3.y * N3.y + N3.z * N3.z );
+					tri.B = normalize( cross( N3, tri.T ) );
 				}
+				else tri.T = make_float3( T[0][i], T[1][i], T[2][i] ), tri.B = make_float3( B[0][i], B[1][i], B[2][i] );
+				// catch bad tangents
+				if (isnan( tri.T.x + tri.T.y + tri.T.z + tri.B.x + tri.B.y + tri.B.z ))
+				{
+					tri.T = normalize( tri.vertex1 - tri.vertex0 );
+					tri.B = normalize( cross( N3, tri.T ) );
+				}
+				// texture LOD, see ray cones: Moller et al., Texture Level of Detail Strategies for Real-Time Ray Tracing, 2019
+				const float Ta = texelCount * fabs( s1 * t2 - s2 * t1 ), Pa = crossLength[i];
+				tri.LOD = Ta > 0 && Pa > 0 ? 0.5f * log2f( Ta / Pa ) : 0;
 			}
-			// calculate tangent vector based on uvs
-			float2 uv01 = make_float2( tri.u1 - tri.u0, tri.v1 - tri.v0 );
-			float2 uv02 = make_float2( tri.u2 - tri.u0, tri.v2 - tri.v0 );
-			if (dot( uv01, uv01 ) == 0 || dot( uv02, uv02 ) == 0)
+			else
 			{
-			#if 1
-				// PBRT:
-				// https://github.com/mmp/pbrt-v3/blob/3f94503ae1777cd6d67a7788e06d67224a525ff4/src/shapes/triangle.cpp#L381
-				if (std::abs( N.x ) > std::abs( N.y ))
-					tri.T = make_float3( -N.z, 0, N.x ) / std::sqrt( N.x * N.x + N.z * N.z );
-				else
-					tri.T = make_float3( 0, N.z, -N.y ) / std::sqrt( N.y * N.y + N.z * N.z );
-			#else
+				// no uv information; use edges to calculate tangent vectors
 				tri.T = normalize( tri.vertex1 - tri.vertex0 );
-			#endif
-				tri.B = normalize( cross( N, tri.T ) );
+				tri.B = normalize( cross( N3, tri.T ) );
 			}
-			else
+			// handle second set of uv coordinates, if available
+			if (hasUv2s)
 			{
-				tri.T = normalize( (tri.vertex1 - tri.vertex0) * uv02.y - (tri.vertex2 - tri.vertex0) * uv01.y );
-				tri.B = normalize( (tri.vertex2 - tri.vertex0) * uv01.x - (tri.vertex1 - tri.vertex0) * uv02.x );
+				tri.u1_0 = tmpUv2s[v0idx].x, tri.v1_0 = tmpUv2s[v0idx].y;
+				tri.u1_1 = tmpUv2s[v1idx].x, tri.v1_1 = tmpUv2s[v1idx].y;
+				tri.u1_2 = tmpUv2s[v2idx].x, tri.v1_2 = tmpUv2s[v2idx].y;
 			}
-			// catch bad tangents
-			if (isnan( tri.T.x + tri.T.y + tri.T.z + tri.B.x + tri.B.y + tri.B.z ))
+			// process joints / weights
+			if (hasJoints)
 			{
-				tri.T = normalize( tri.vertex1 - tri.vertex0 );
-				tri.B = normalize( cross( N, tri.T ) );
+				const size_t j = firstJoint + triIdx * 3;
+				joints[j + 0] = tmpJoints[v0idx], joints[j + 1] = tmpJoints[v1idx], joints[j + 2] = tmpJoints[v2idx];
+				weights[j + 0] = tmpWeights[v0idx], weights[j + 1] = tmpWeights[v1idx], weights[j + 2] = tmpWeights[v2idx];
 			}
-		}
-		else
-		{
-			// no uv information; use edges to calculate tangent vectors
-			tri.T = normalize( tri.vertex1 - tri.vertex0 );
-			tri.B = normalize( cross( N, tri.T ) );
-		}
-		// handle second and third set of uv coordinates, if available
-		if (tmpUv2s.size() > 0)
-		{
-			tri.u1_0 = tmpUv2s[v0idx].x, tri.v1_0 = tmpUv2s[v0idx].y;
-			tri.u1_1 = tmpUv2s[v1idx].x, tri.v1_1 = tmpUv2s[v1idx].y;
-			tri.u1_2 = tmpUv2s[v2idx].x, tri.v1_2 = tmpUv2s[v2idx].y;
-		}
-		// process joints / weights
-		if (tmpJoints.size() > 0)
-		{
-			joints.push_back( tmpJoints[v0idx] );
-			joints.push_back( tmpJoints[v1idx] );
-			joints.push_back( tmpJoints[v2idx] );
-			weights.push_back( tmpWeights[v0idx] );
-			weights.push_back( tmpWeights[v1idx] );
-			weights.push_back( tmpWeights[v2idx] );
-		}
-		// build poses
-		for (int s = (int)tmpPoses.size(), i = 0; i < s; i++)
-		{
-			auto& pose = tmpPoses[i];
-			poses[i].positions.push_back( pose.positions[v0idx] );
-			poses[i].positions.push_back( pose.positions[v1idx] );
-			poses[i].positions.push_back( pose.positions[v2idx] );
-			poses[i].normals.push_back( pose.normals[v0idx] );
-			poses[i].normals.push_back( pose.normals[v1idx] );
-			poses[i].normals.push_back( pose.normals[v2idx] );
-			if (pose.tangents.size() > 0)
-			{
-				poses[i].tangents.push_back( pose.tangents[v0idx] );
-				poses[i].tangents.push_back( pose.tangents[v1idx] );
-				poses[i].tangents.push_back( pose.tangents[v2idx] );
-			}
-			else
+			// build poses; missing normals or tangents (e.g. position-only targets) become zero or dummy vectors
+			for (int s = (int)tmpPoses.size(), p = 0; p < s; p++)
 			{
-				// have some dummies for now
-				poses[i].tangents.push_back( make_float3( 0, 1, 0 ) );
-				poses[i].tangents.push_back( make_float3( 0, 1, 0 ) );
-				poses[i].tangents.push_back( make_float3( 0, 1, 0 ) );
+				const Pose& pose = tmpPoses[p];
+				const size_t j = firstPoseVertex[p] + triIdx * 3;
+				const uint idx[3] = { v0idx, v1idx, v2idx };
+				for (int k = 0; k < 3; k++)
+				{
+					poses[p].positions[j + k] = pose.positions[idx[k]];
+					poses[p].normals[j + k] = pose.normals.size() > 0 ? pose.normals[idx[k]] : make_float3( 0 );
+					poses[p].tangents[j + k] = pose.tangents.size() > 0 ? pose.tangents[idx[k]] : make_float3( 0, 1, 0 );
+				}
 			}
 		}
+	} );
+	// calculate values for consistent normal interpolation: one alpha value per unique vertex
+	// Note: we clamp at approx. 45 degree angles; beyond this the approach fails.
+	vector<float> tmpAlphas( tmpVertices.size(), 1.0f );
+	for (int s = triCount * 3, i = 0; i < s; i++) tmpAlphas[tmpIndices[i]] = min( tmpAlphas[tmpIndices[i]], cornerDot[i] );
+	ParallelFor( 0, (int)(tmpAlphas.size() + 4095) / 4096, [&]( int block ) {
+		for (size_t i = block * 4096, last = min( tmpAlphas.size(), i + 4096 ); i < last; i++)
+		{
+			const float nnv = tmpAlphas[i]; // temporarily stored there
+			tmpAlphas[i] = acosf( nnv ) * (1 + 0.03632f * (1 - nnv) * (1 - nnv));
+		}
+	} );
+	ParallelFor( 0, chunkCount, [&]( int chunk ) {
+		for (int i = chunk * chunkSize, last = min( triCount, i + chunkSize ); i < last; i++)
+			triangles[firstTri + i].alpha = make_float3( tmpAlphas[tmpIndices[i * 3]], tmpAlphas[tmpIndices[i * 3 + 1]], tmpAlphas[tmpIndices[i * 3 + 2]] );
+	} );
+	// single-texel triangles: replace by single color material; creates materials, so not in parallel
+	for (const vector<int>& list : singleTexel) for (const int i : list)
+	{
+		HostTri& tri = triangles[firstTri + i];
+		const uint u = (uint)(tri.u0 * texture->width) % texture->width;
+		const uint v = (uint)(tri.v0 * texture->height) % texture->height;
+		const uint color = texture->Texel( u, v ) & 0xffffff;
+		if (stagedTextures) stagedCopies.push_back( make_uint2( (uint)(firstTri + i), color ) );
+		else tri.material = HostScene::FindOrCreateMaterialCopy( materialIdx, color );
 	}
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::ResolveStagedMaterials                                           |
+//  |  Replace the staged material indices of the triangles by the scene          |
+//  |  materials in 'matIdx', and create the single color materials recorded by   |
+//  |  BuildFromIndexedData. Completes a mesh converted by HostScene::            |
+//  |  LoadSceneData.                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostMesh::ResolveStagedMaterials( const vector<int>& matIdx )
+{
+	for (HostTri& tri : triangles) tri.material = matIdx[tri.material];
+	for (const uint2& copy : stagedCopies) triangles[copy.x].material = HostScene::FindOrCreateMaterialCopy( triangles[copy.x].material, copy.y );
+	vector<uint2>().swap( stagedCopies );
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostMesh::BuildMaterialList                                                |
 //  |  Update the list of materials used by this mesh. We will use this list to   |
@@ -703,72 +1114,295 @@ void HostMesh::BuildMaterialList()
 	}
 }
 
+// helper: FastHash64 of a large buffer, in parallel over blocks of 4MB
+static uint64_t HashBuffer( const void* data, const size_t bytes )
+{
+	const size_t blockSize = 4 << 20, blocks = (bytes + blockSize - 1) / blockSize;
+	if (blocks < 2) return FastHash64( data, bytes );
+	vector<uint64_t> hashes( blocks );
+	ParallelFor( 0, (int)blocks, [&]( int i ) {
+		hashes[i] = FastHash64( (const uchar*)data + i * blockSize, min( blockSize, bytes - i * blockSize ) );
+	} );
+	return FastHash64( hashes.data(), blocks * sizeof( uint64_t ), bytes );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::ContentHash / SameGeometry                                       |
+//  |  Hash and exact comparison of the geometry: vertices, full triangles        |
+//  |  (which include the material IDs) and skinning data. Used to merge          |
+//  |  identical meshes, see HostScene::FindOrAddMesh.                      LH2'20|
+//  +-----------------------------------------------------------------------------+
+uint64_t HostMesh::ContentHash() const
+{
+	const uint64_t hashes[4] = {
+		HashBuffer( vertices.data(), vertices.size() * sizeof( float4 ) ),
+		HashBuffer( triangles.data(), triangles.size() * sizeof( HostTri ) ),
+		HashBuffer( joints.data(), joints.size() * sizeof( uint4 ) ),
+		HashBuffer( weights.data(), weights.size() * sizeof( float4 ) )
+	};
+	return FastHash64( hashes, sizeof( hashes ) );
+}
+
+bool HostMesh::SameGeometry( const HostMesh& other ) const
+{
+	if (vertices.size() != other.vertices.size() || triangles.size() != other.triangles.size() ||
+		joints.size() != other.joints.size() || weights.size() != other.weights.size()) return false;
+	return memcmp( vertices.data(), other.vertices.data(), vertices.size() * sizeof( float4 ) ) == 0 &&
+		memcmp( triangles.data(), other.triangles.data(), triangles.size() * sizeof( HostTri ) ) == 0 &&
+		memcmp( joints.data(), other.joints.data(), joints.size() * sizeof( uint4 ) ) == 0 &&
+		memcmp( weights.data(), other.weights.data(), weights.size() * sizeof( float4 ) ) == 0;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::GetEmissiveTriangles                                             |
+//  |  Returns the indices of the triangles that use an emissive material. The    |
+//  |  list is cached, so instancing a mesh does not require a full scan. Call    |
+//  |  InvalidateEmissiveTriangles when a material of the mesh changes from or    |
+//  |  to emissive; appending triangles is detected automatically.          LH2'20|
+//  +-----------------------------------------------------------------------------+
+const vector<int>& HostMesh::GetEmissiveTriangles()
+{
+	const int triCount = (int)triangles.size();
+	if (emissiveScanned == triCount) return emissiveTris;
+	emissiveTris.clear();
+	for (int i = 0; i < triCount; i++) if (HostScene::materials[triangles[i].material]->IsEmissive()) emissiveTris.push_back( i );
+	emissiveScanned = triCount;
+	return emissiveTris;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::BuildMorphTargets                                                |
+//  |  Convert the dense morph target poses to sparse streams: per target, only   |
+//  |  the vertices it actually displaces are stored, with SoA deltas. Most       |
+//  |  targets (e.g. facial expressions) affect a small part of the mesh.   LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostMesh::BuildMorphTargets()
+{
+	const int vertexCount = (int)poses[0].positions.size(), targetCount = (int)poses.size() - 1;
+	auto displaced = [&]( const Pose& pose, const int v ) {
+		if ((int)pose.positions.size() > v && (pose.positions[v].x != 0 || pose.positions[v].y != 0 || pose.positions[v].z != 0)) return true;
+		return (int)pose.normals.size() > v && (pose.normals[v].x != 0 || pose.normals[v].y != 0 || pose.normals[v].z != 0);
+	};
+	// find the vertices that are displaced by at least one target
+	vector<int> slot( vertexCount, -1 );
+	morphVerts.clear();
+	for (int v = 0; v < vertexCount; v++) for (int j = 1; j <= targetCount; j++) if (displaced( poses[j], v ))
+	{
+		slot[v] = (int)morphVerts.size();
+		morphVerts.push_back( v );
+		break;
+	}
+	// store their base positions and normals
+	const int count = (int)morphVerts.size(), stride = (count + 7) & ~7;
+	morphBase.resize( stride * 6, 0 );
+	morphBlend.resize( stride * 6 );
+	for (int i = 0; i < count; i++)
+	{
+		const float3 p = poses[0].positions[morphVerts[i]], n = poses[0].normals[morphVerts[i]];
+		morphBase[i] = p.x, morphBase[i + stride] = p.y, morphBase[i + 2 * stride] = p.z;
+		morphBase[i + 3 * stride] = n.x, morphBase[i + 4 * stride] = n.y, morphBase[i + 5 * stride] = n.z;
+	}
+	// extract the sparse deltas, and release the dense ones
+	morphTargets.resize( targetCount );
+	for (int j = 1; j <= targetCount; j++)
+	{
+		MorphTarget& target = morphTargets[j - 1];
+		const Pose& pose = poses[j];
+		for (int v = 0; v < vertexCount; v++) if (displaced( pose, v ))
+		{
+			const float3 d = (int)pose.positions.size() > v ? pose.positions[v] : make_float3( 0 );
+			const float3 n = (int)pose.normals.size() > v ? pose.normals[v] : make_float3( 0 );
+			target.slot.push_back( slot[v] );
+			target.dx.push_back( d.x ), target.dy.push_back( d.y ), target.dz.push_back( d.z );
+			target.nx.push_back( n.x ), target.ny.push_back( n.y ), target.nz.push_back( n.z );
+		}
+		poses[j] = Pose();
+	}
+	// vertices that are not displaced keep their base normal
+	vertexNormals = poses[0].normals;
+}
+
+#if defined( __AVX2__ ) && ( defined( _MSC_VER ) || defined( __FMA__ ) )
+// use avx2 instruction
+#define FMADD256(a,b,c) _mm256_fmadd_ps( (a),(b),(c) )
+#else
+// avx fallback (negligible impact on performance)
+#define FMADD256(a,b,c) _mm256_add_ps( _mm256_mul_ps( (a), (b) ), (c) )
+#endif
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::BlendMorphTargets                                                |
+//  |  Blend the morph targets into the base pose, in morphBlend. Only vertices   |
+//  |  displaced by a morph target are processed, and targets with a zero weight  |
+//  |  are skipped.                                                         LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostMesh::BlendMorphTargets( const vector<float>& weights )
+{
+	assert( weights.size() == poses.size() - 1 /* first pose is base pose */ );
+	if (morphTargets.size() != weights.size()) BuildMorphTargets();
+	const int count = (int)morphVerts.size(), stride = (count + 7) & ~7;
+	// blend the morph targets into the base pose, in SoA layout
+	float* blend = morphBlend.data();
+	memcpy( blend, morphBase.data(), stride * 6 * sizeof( float ) );
+	for (int s = (int)weights.size(), j = 0; j < s; j++) if (weights[j] != 0)
+	{
+		const MorphTarget& target = morphTargets[j];
+		const float* delta[6] = { target.dx.data(), target.dy.data(), target.dz.data(), target.nx.data(), target.ny.data(), target.nz.data() };
+		const int n = (int)target.slot.size();
+		const float w = weights[j];
+		const __m256 w8 = _mm256_set1_ps( w );
+		int k = 0;
+		for (; k + 8 <= n; k += 8)
+		{
+			const int first = target.slot[k];
+			if (target.slot[k + 7] - first == 7)
+			{
+				// slots are ascending and unique, so these eight are consecutive
+				for (int c = 0; c < 6; c++)
+				{
+					float* dst = blend + c * stride + first;
+					_mm256_storeu_ps( dst, FMADD256( w8, _mm256_loadu_ps( delta[c] + k ), _mm256_loadu_ps( dst ) ) );
+				}
+			}
+			else
+			{
+				// scattered vertices: gather, blend, write back
+				const int* slot = &target.slot[k];
+#ifdef __AVX2__
+				const __m256i idx = _mm256_loadu_si256( (const __m256i*)slot );
+#endif
+				for (int c = 0; c < 6; c++)
+				{
+					float* dst = blend + c * stride;
+#ifdef __AVX2__
+					const __m256 current = _mm256_i32gather_ps( dst, idx, 4 );
+#else
+					const __m256 current = _mm256_setr_ps( dst[slot[0]], dst[slot[1]], dst[slot[2]], dst[slot[3]], dst[slot[4]], dst[slot[5]], dst[slot[6]], dst[slot[7]] );
+#endif
+					ALIGN( 32 ) float result[8];
+					_mm256_store_ps( result, FMADD256( w8, _mm256_loadu_ps( delta[c] + k ), current ) );
+					for (int l = 0; l < 8; l++) dst[target.slot[k + l]] = result[l];
+				}
+			}
+		}
+		for (; k < n; k++) for (int c = 0; c < 6; c++) blend[c * stride + target.slot[k]] += w * delta[c][k];
+	}
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostMesh::SetPose                                                          |
 //  |  Update the geometry data in this mesh using the weights from the node,     |
-//  |  and update all dependent data.                                       LH2'19|
+//  |  and update all dependent data.                                       LH2'20|
 //  +-----------------------------------------------------------------------------+
 void HostMesh::SetPose( const vector<float>& weights )
 {
-	assert( weights.size() == poses.size() - 1 /* first pose is base pose */ );
-	const int weightCount = (int)weights.size();
-	// adjust intersection geometry data
-	for (int s = (int)vertices.size(), i = 0; i < s; i++)
+	BlendMorphTargets( weights );
+	const int count = (int)morphVerts.size(), stride = (count + 7) & ~7;
+	const float* blend = morphBlend.data();
+	// store the displaced vertices and their normals
+	for (int i = 0; i < count; i++)
 	{
-		vertices[i] = make_float4( poses[0].positions[i], 1 );
-		for (int j = 1; j <= weightCount; j++) vertices[i] += weights[j - 1] * make_float4( poses[j].positions[i], 0 );
+		const int v = morphVerts[i];
+		const float3 N = normalize( make_float3( blend[i + 3 * stride], blend[i + 4 * stride], blend[i + 5 * stride] ) );
+		vertices[v] = make_float4( blend[i], blend[i + stride], blend[i + 2 * stride], 1 );
+		vertexNormals[v] = N;
+		HostTri& tri = triangles[v / 3];
+		if (v % 3 == 0) tri.vN0 = N; else if (v % 3 == 1) tri.vN1 = N; else tri.vN2 = N;
 	}
-	// adjust full triangles
-	for (int s = (int)triangles.size(), i = 0; i < s; i++)
+	// adjust the full triangles that contain a displaced vertex
+	for (int last = -1, i = 0; i < count; i++)
 	{
-		triangles[i].vertex0 = make_float3( vertices[i * 3 + 0] );
-		triangles[i].vertex1 = make_float3( vertices[i * 3 + 1] );
-		triangles[i].vertex2 = make_float3( vertices[i * 3 + 2] );
-		triangles[i].vN0 = poses[0].normals[i * 3 + 0];
-		triangles[i].vN1 = poses[0].normals[i * 3 + 1];
-		triangles[i].vN2 = poses[0].normals[i * 3 + 2];
-		for (int j = 1; j <= weightCount; j++)
-			triangles[i].vN0 += poses[j].normals[i * 3 + 0],
-			triangles[i].vN1 += poses[j].normals[i * 3 + 1],
-			triangles[i].vN2 += poses[j].normals[i * 3 + 2];
-		triangles[i].vN0 = normalize( triangles[i].vN0 );
-		triangles[i].vN1 = normalize( triangles[i].vN1 );
-		triangles[i].vN2 = normalize( triangles[i].vN2 );
+		const int t = morphVerts[i] / 3;
+		if (t == last) continue;
+		HostTri& tri = triangles[last = t];
+		tri.vertex0 = make_float3( vertices[t * 3 + 0] );
+		tri.vertex1 = make_float3( vertices[t * 3 + 1] );
+		tri.vertex2 = make_float3( vertices[t * 3 + 2] );
+		const float3 N = normalize( cross( tri.vertex1 - tri.vertex0, tri.vertex2 - tri.vertex0 ) );
+		tri.Nx = N.x, tri.Ny = N.y, tri.Nz = N.z;
 	}
 	// mark as dirty; changing vector contents doesn't trigger this
+	poseStreams |= POSITIONS | NORMALS;
 	MarkAsDirty();
 }
 
 //  +-----------------------------------------------------------------------------+
-//  |  HostMesh::SetPose                                                          |
-//  |  Update the geometry data in this mesh using a skin.                        |
-//  |  Called from RenderSystem::UpdateSceneGraph, for skinned mesh nodes.  LH2'19|
+//  |  HostMesh::MorphBindPose                                                    |
+//  |  For meshes that are skinned and morphed: blend the morph targets into the  |
+//  |  bind pose of 'target', which is this mesh or one of its pose copies. The   |
+//  |  skin is applied to the result, see SetPose( skin ).                  LH2'20|
 //  +-----------------------------------------------------------------------------+
-void HostMesh::SetPose( const HostSkin* skin )
+void HostMesh::MorphBindPose( const vector<float>& weights, HostMesh* target )
 {
-	// ensure that we have a backup of the original vertex positions
-	if (original.size() == 0)
+	StoreBindPose();
+	BlendMorphTargets( weights );
+	const int count = (int)morphVerts.size(), stride = (count + 7) & ~7;
+	const float* blend = morphBlend.data();
+	for (int i = 0; i < count; i++)
 	{
-		for (auto& vert : vertices) original.push_back( vert );
-		for (auto& tri : triangles)
-		{
-			origNormal.push_back( tri.vN0 );
-			origNormal.push_back( tri.vN1 );
-			origNormal.push_back( tri.vN2 );
-		}
-		vertexNormals.resize( vertices.size() );
+		const int v = morphVerts[i];
+		target->original[v] = make_float4( blend[i], blend[i + stride], blend[i + 2 * stride], 1 );
+		target->origNormal[v] = normalize( make_float3( blend[i + 3 * stride], blend[i + 4 * stride], blend[i + 5 * stride] ) );
 	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::StoreBindPose                                                    |
+//  |  Keep a copy of the original vertex positions and normals for skinning.     |
+//  |  Does nothing if the copy already exists.                             LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostMesh::StoreBindPose()
+{
+	if (original.size() > 0) return;
+	for (auto& vert : vertices) original.push_back( vert );
+	for (auto& tri : triangles)
+	{
+		origNormal.push_back( tri.vN0 );
+		origNormal.push_back( tri.vN1 );
+		origNormal.push_back( tri.vN2 );
+	}
+	vertexNormals.resize( vertices.size() );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::CreatePoseCopy                                                   |
+//  |  Create a mesh that holds an additional skinned pose of this mesh. It only  |
+//  |  stores the posed geometry; skinning data is read from this mesh, see       |
+//  |  SetPose. Copies of morphed meshes keep their own bind pose, which holds    |
+//  |  the morph weights of the pose, see MorphBindPose.                    LH2'20|
+//  +-----------------------------------------------------------------------------+
+HostMesh* HostMesh::CreatePoseCopy() const
+{
+	HostMesh* copy = new HostMesh();
+	copy->name = name;
+	copy->vertices = vertices;
+	if (poses.size() > 1) copy->original = original, copy->origNormal = origNormal;
+	copy->vertexNormals.resize( vertices.size() );
+	copy->triangles = triangles;
+	copy->materialList = materialList;
+	copy->isAnimated = true;
+	copy->excludeFromNavmesh = excludeFromNavmesh;
+	return copy;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostMesh::SetPose                                                          |
+//  |  Update the geometry data in this mesh using a skin.                        |
+//  |  Called from RenderSystem::UpdateSceneGraph, for skinned mesh nodes.        |
+//  |  If a source mesh is specified, the bind pose and joint weights are taken   |
+//  |  from that mesh; this is used for pose copies, see CreatePoseCopy. A pose   |
+//  |  copy with its own (morphed) bind pose uses that instead.             LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostMesh::SetPose( const HostSkin* skin, HostMesh* source )
+{
+	// skin data and bind pose come from the source mesh; by default, that is this mesh
+	HostMesh* src = source ? source : this;
+	src->StoreBindPose();
+	const HostMesh* bind = original.size() > 0 ? this : src;
+	if (vertexNormals.size() != vertices.size()) vertexNormals.resize( vertices.size() );
 #if 1
 	// code optimized for INFOMOV by Alysha Bogaers and Naraenda Prasetya
 
-#if defined( __AVX2__ ) && ( defined( _MSC_VER ) || defined( __FMA__ ) )
-	// use avx2 instruction
-#define FMADD256(a,b,c) _mm256_fmadd_ps( (a),(b),(c) )
-#else
-	// avx fallback (negligible impact on performance)
-#define FMADD256(a,b,c) _mm256_add_ps( _mm256_mul_ps( (a), (b) ), (c) )
-#endif
-
 #ifdef _MSC_VER
 #define USE_PARALLEL_SETPOSE // TODO: Find Linux replacement for PPL
 #endif
@@ -792,9 +1426,9 @@ void HostMesh::SetPose( const HostSkin* skin )
 			//       + w4.z * skin->jointMat[j4.z]
 			//       + w4.w * skin->jointMat[j4.w];
 			// the 4 joint indices
-			uint4 j4 = joints[v];
+			uint4 j4 = src->joints[v];
 			// the 4 weights of each joint
-			__m128 w4 = _mm_load_ps( (const float*)&weights[v] );
+			__m128 w4 = _mm_load_ps( (const float*)&src->weights[v] );
 			// create scalars for matrix scaling, use same shuffle value to help with uOP cache
 			__m256 w4x = _mm256_broadcastss_ps( w4 ); // w4.x component shuffled to all elements
 			w4 = _mm_shuffle_ps( w4, w4, 0b111001 );
@@ -819,8 +1453,8 @@ void HostMesh::SetPose( const HostSkin* skin )
 			__m256 skinM2 = _mm256_permute2f128_ps( skinM_L, skinM_L, 0x00 );
 			__m256 skinM3 = _mm256_permute2f128_ps( skinM_L, skinM_L, 0x11 );
 			// load vertices and normal
-			__m128 vtxOrig = _mm_load_ps( &original[v].x );
-			__m128 normOrig = _mm_maskload_ps( &origNormal[v].x, _mm_set_epi32( 0, -1, -1, -1 ) );
+			__m128 vtxOrig = _mm_load_ps( &bind->original[v].x );
+			__m128 normOrig = _mm_maskload_ps( &bind->origNormal[v].x, _mm_set_epi32( 0, -1, -1, -1 ) );
 			// combine vectors to use AVX2 instead of SSE
 			__m256 combined = _mm256_set_m128( normOrig, vtxOrig );
 			// multiply vertex with skin matrix, multiply normal with skin matrix
@@ -883,14 +1517,14 @@ void HostMesh::SetPose( const HostSkin* skin )
 	// transform original into vertex vector using skin matrices
 	for (int s = (int)vertices.size(), i = 0; i < s; i++)
 	{
-		uint4 j4 = joints[i];
-		float4 w4 = weights[i];
+		uint4 j4 = src->joints[i];
+		float4 w4 = src->weights[i];
 		mat4 skinMatrix = w4.x * skin->jointMat[j4.x];
 		skinMatrix += w4.y * skin->jointMat[j4.y];
 		skinMatrix += w4.z * skin->jointMat[j4.z];
 		skinMatrix += w4.w * skin->jointMat[j4.w];
-		vertices[i] = skinMatrix * original[i];
-		vertexNormals[i] = normalize( make_float3( make_float4( origNormal[i], 0 ) * skinMatrix ) );
+		vertices[i] = skinMatrix * bind->original[i];
+		vertexNormals[i] = normalize( make_float3( make_float4( bind->origNormal[i], 0 ) * skinMatrix ) );
 	}
 	// adjust full triangles
 	for (int s = (int)triangles.size(), i = 0; i < s; i++)
@@ -908,6 +1542,7 @@ void HostMesh::SetPose( const HostSkin* skin )
 	}
 #endif
 	// mark as dirty; changing vector contents doesn't trigger this
+	poseStreams |= POSITIONS | NORMALS;
 	MarkAsDirty();
 }
 
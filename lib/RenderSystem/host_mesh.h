@@ -32,6 +32,7 @@ public:
 	vector<mat4> inverseBindMatrices;
 	vector<mat4> jointMat;
 	vector<int> joints; // node indices of the joints
+	bool skipPose = false; // set by the animation LOD system, see HostScene::UpdateAnimations
 };
 
 //  +-----------------------------------------------------------------------------+
@@ -41,29 +42,51 @@ public:
 class HostMesh
 {
 public:
+	enum
+	{
+		POSITIONS = 1,							// dynamic vertex streams, see poseStreams
+		NORMALS = 2
+	};
 	struct Pose
 	{
 		vector<float3> positions;
 		vector<float3> normals;
 		vector<float3> tangents;
 	};
+	struct MorphTarget
+	{
+		vector<int> slot;						// position in morphVerts of each vertex displaced by this target
+		vector<float> dx, dy, dz;				// position deltas, SoA
+		vector<float> nx, ny, nz;				// normal deltas, SoA
+	};
 	// constructor / destructor
 	HostMesh() = default;
 	HostMesh( const int triCount );
 	HostMesh( const char* name, const char* dir, const float scale = 1.0f, const bool flatShaded = false );
-	HostMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<int>& matIdx, const int materialOverride = -1 );
+	HostMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<HostTexture*>& colorTextures, const int materialOverride = -1 );
 	~HostMesh();
 	// methods
 	void LoadGeometry( const char* file, const char* dir, const float scale = 1.0f, const bool flatShaded = false );
 	void LoadGeometryFromOBJ( const string& fileName, const char* directory, const mat4& transform, const bool flatShaded = false );
-	void ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<int>& matIdx, const int materialOverride );
+	void ConvertFromGTLFMesh( const tinygltfMesh& gltfMesh, const tinygltfModel& gltfModel, const vector<HostTexture*>& colorTextures, const int materialOverride );
 	void BuildFromIndexedData( const vector<int>& tmpIndices, const vector<float3>& tmpVertices,
 		const vector<float3>& tmpNormals, const vector<float2>& tmpUvs, const vector<float2>& tmpUv2s,
 		const vector<float4>& tmpTs, const vector<Pose>& tmpPoses,
-		const vector<uint4>& tmpJoints, const vector<float4>& tmpWeights, const int materialIdx );
+		const vector<uint4>& tmpJoints, const vector<float4>& tmpWeights, const int materialIdx,
+		const vector<HostTexture*>* stagedTextures = 0 );
+	void ResolveStagedMaterials( const vector<int>& matIdx );
 	void BuildMaterialList();
+	void BuildMorphTargets();
+	const vector<int>& GetEmissiveTriangles();
+	void InvalidateEmissiveTriangles() { emissiveScanned = -1; }
+	void BlendMorphTargets( const vector<float>& weights );
 	void SetPose( const vector<float>& weights );
-	void SetPose( const HostSkin* skin );
+	void SetPose( const HostSkin* skin, HostMesh* source = 0 );
+	void MorphBindPose( const vector<float>& weights, HostMesh* target );
+	void StoreBindPose();
+	HostMesh* CreatePoseCopy() const;
+	uint64_t ContentHash() const;
+	bool SameGeometry( const HostMesh& other ) const;
 	// data members
 	string name = "unnamed";					// name for the mesh						
 	int ID = -1;								// unique ID for the mesh: position in mesh array
@@ -73,12 +96,22 @@ public:
 	vector<float3> origNormal;					// skinning: base pose normals
 	vector<HostTri> triangles;					// full triangles
 	vector<int> materialList;					// list of materials used by the mesh; used to efficiently track light changes
+	vector<uint2> stagedCopies;					// staged glTF mesh: triangles that read a single texel, and that texel
 	vector<uint4> joints;						// skinning: joints
 	vector<float4> weights;						// skinning: joint weights
-	vector<Pose> poses;							// morph target data
+	vector<Pose> poses;							// morph target data; after BuildMorphTargets only poses[0] holds data
+	vector<int> morphVerts;						// vertices displaced by at least one morph target, ascending
+	vector<MorphTarget> morphTargets;			// sparse morph target deltas, built from poses
+	vector<float> morphBase;					// base positions and normals of morphVerts, SoA, padded to 8
+	vector<float> morphBlend;					// SetPose scratch space, same layout as morphBase
 	bool isAnimated;							// true when this mesh has animation data
+	uint poseStreams = 0;						// vertex streams modified by SetPose since the last sync with the core
 	bool excludeFromNavmesh = false;			// prevents mesh from influencing navmesh generation (e.g. curtains)
 	TRACKCHANGES;								// add Changed(), MarkAsDirty() methods, see system.h
+private:
+	vector<int> emissiveTris;					// indices of triangles with an emissive material
+	int emissiveScanned = -1;					// triangle count at the time emissiveTris was built; -1: invalid
+public:
 	// Note: design decision:
 	// Vertices and indices can be deduced from the list of HostTris, obviously. However, efficient intersection
 	// (e.g. in OptiX) requires only vertices and connectivity data. Shading on the other hand requires the full
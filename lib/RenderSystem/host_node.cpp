@@ -33,9 +33,9 @@ static HostTri TransformedHostTri( HostTri* tri, mat4 T )
 //  |  HostNode::HostNode                                                         |
 //  |  Constructors.                                                        LH2'19|
 //  +-----------------------------------------------------------------------------+
-HostNode::HostNode( const tinygltfNode& gltfNode, const int nodeBase, const int meshBase, const int skinBase )
+HostNode::HostNode( const tinygltfNode& gltfNode, const int nodeBase, const vector<int>& meshIdx, const int skinBase )
 {
-	ConvertFromGLTFNode( gltfNode, nodeBase, meshBase, skinBase );
+	ConvertFromGLTFNode( gltfNode, nodeBase, meshIdx, skinBase );
 }
 
 HostNode::HostNode( const int meshIdx, const mat4& transform )
@@ -53,35 +53,21 @@ HostNode::HostNode( const int meshIdx, const mat4& transform )
 //  +-----------------------------------------------------------------------------+
 HostNode::~HostNode()
 {
-	if ((meshID > -1) && hasLights)
-	{
-		// this node is an instance and has emissive materials;
-		// remove the relevant area lights.
-		HostMesh* mesh = HostScene::meshPool[meshID];
-		for (auto materialIdx : mesh->materialList)
-		{
-			HostMaterial* material = HostScene::materials[materialIdx];
-			if (material->IsEmissive())
-			{
-				// mesh contains an emissive material; remove related area lights
-				vector<HostTriLight*>& lightList = HostScene::triLights;
-				for (int s = (int)lightList.size(), i = 0; i < s; i++)
-					if (lightList[i]->instIdx == ID) lightList.erase( lightList.begin() + i-- );
-			}
-		}
-	}
+	// remove the area lights of this instance; O(1) per light
+	for (int handle : lightHandles) HostScene::RemoveTriLight( handle );
+	HostScene::ReleaseSkinnedPose( poseEntry );
 }
 
 //  +-----------------------------------------------------------------------------+
 //  |  HostNode::ConvertFromGLTFNode                                              |
 //  |  Create a node from a GLTF node.                                      LH2'19|
 //  +-----------------------------------------------------------------------------+
-void HostNode::ConvertFromGLTFNode( const tinygltfNode& gltfNode, const int nodeBase, const int meshBase, const int skinBase )
+void HostNode::ConvertFromGLTFNode( const tinygltfNode& gltfNode, const int nodeBase, const vector<int>& meshIdx, const int skinBase )
 {
 	// copy node name
 	name = gltfNode.name;
 	// set mesh / skin ID
-	meshID = gltfNode.mesh == -1 ? -1 : (gltfNode.mesh + meshBase);
+	meshID = gltfNode.mesh == -1 ? -1 : meshIdx[gltfNode.mesh];
 	skinID = gltfNode.skin == -1 ? -1 : (gltfNode.skin + skinBase);
 	// if the mesh has morph targets, the node should have weights for them
 	if (meshID != -1)
@@ -164,12 +150,16 @@ bool HostNode::Update( mat4& T, vector<int>& instances, int& posInInstanceArray
 	// update animations
 	if (meshID > -1)
 	{
+		bool blendDeferred = false;
 		if (morphed)
 		{
-			HostScene::meshPool[meshID]->SetPose( weights );
+			// blending is deferred, so meshes can be processed in parallel; skinned meshes blend into
+			// the bind pose of their posed mesh instead, see HostScene::AcquireSkinnedPose
+			if (skinID == -1) HostScene::morphedNodes.push_back( ID ), blendDeferred = true;
 			morphed = false;
 		}
-		if (thisWasModified && hasLights) UpdateLights();
+		// lights of deferred nodes are updated after blending, see HostScene::UpdateMorphTargets
+		if (thisWasModified && hasLights && !blendDeferred) UpdateLights();
 		if (instanceID != posInInstanceArray)
 		{
 			instancesChanged = true;
@@ -178,7 +168,7 @@ bool HostNode::Update( mat4& T, vector<int>& instances, int& posInInstanceArray
 			else
 				instances.push_back( ID );
 		}
-		if (skinID > -1)
+		if (skinID > -1 && !HostScene::skins[skinID]->skipPose)
 		{
 			HostSkin* skin = HostScene::skins[skinID];
 			mat4 meshTransform = combinedTransform;
@@ -188,7 +178,9 @@ bool HostNode::Update( mat4& T, vector<int>& instances, int& posInInstanceArray
 				HostNode* jointNode = HostScene::nodePool[skin->joints[j]];
 				skin->jointMat[j] = meshTransformInverted * jointNode->combinedTransform * skin->inverseBindMatrices[j];
 			}
-			HostScene::meshPool[meshID]->SetPose( skin );
+			// get posed geometry for this instance; instances in the same pose share it
+			const int posedMesh = HostScene::AcquireSkinnedPose( meshID, skin, weights, poseEntry );
+			if (posedMesh != poseMeshID) poseMeshID = posedMesh, instancesChanged = true;
 		}
 		posInInstanceArray++;
 	}
@@ -205,29 +197,22 @@ void HostNode::PrepareLights()
 	if (meshID > -1)
 	{
 		HostMesh* mesh = HostScene::meshPool[meshID];
-		for (int s = (int)mesh->triangles.size(), i = 0; i < s; i++)
+		for (int i : mesh->GetEmissiveTriangles())
 		{
 			HostTri* tri = &mesh->triangles[i];
-			HostMaterial* mat = HostScene::materials[tri->material];
-			if (mat->IsEmissive())
-			{
-				tri->UpdateArea();
-				HostTri transformedTri = TransformedHostTri( tri, localTransform );
-				HostTriLight* light = new HostTriLight( &transformedTri, i, ID );
-				tri->ltriIdx = (int)HostScene::triLights.size(); // TODO: can't duplicate a light due to this.
-				HostScene::triLights.push_back( light );
-				hasLights = true;
-				// Note: TODO: 
-				// 1. if a mesh is deleted it should scan the list of area lights
-				//    to delete those that no longer exist.
-				// 2. if a material is changed from emissive to non-emissive,
-				//    meshes using the material should remove their light emitting
-				//    triangles from the list of area lights.
-				// 3. if a material is changed from non-emissive to emissive,
-				//    meshes using the material should update the area lights list.
-				// Item 1 can be done efficiently. Items 2 and 3 require a list
-				// of materials per mesh to be efficient.
-			}
+			tri->UpdateArea();
+			HostTri transformedTri = TransformedHostTri( tri, localTransform );
+			HostTriLight* light = new HostTriLight( &transformedTri, i, ID );
+			light->meshIdx = meshID;
+			lightHandles.push_back( HostScene::AddTriLight( light ) );
+			// Note: mesh triangles are shared between instances, so tri->ltriIdx (used for
+			// MIS) refers to the light of the most recently added instance of the mesh.
+			tri->ltriIdx = (int)HostScene::triLights.size() - 1;
+			hasLights = true;
+			// Note: TODO:
+			// If a material is changed from emissive to non-emissive or vice versa, meshes
+			// using the material should call InvalidateEmissiveTriangles, after which the
+			// instances should rebuild their lights.
 		}
 	}
 }
@@ -241,17 +226,26 @@ void HostNode::UpdateLights()
 {
 	if (!hasLights) return;
 	HostMesh* mesh = HostScene::meshPool[meshID];
-	for (int s = (int)mesh->triangles.size(), i = 0; i < s; i++)
+	for (int handle : lightHandles)
 	{
-		HostTri* tri = &mesh->triangles[i];
-		if (tri->ltriIdx > -1)
-		{
-			// triangle is light emitting; update it
+		// update the light in place; this keeps its handle and position
+		HostTriLight* light = HostScene::GetTriLight( handle );
+		HostTri* tri = &mesh->triangles[light->triIdx];
 		tri->UpdateArea();
 		HostTri transformedTri = TransformedHostTri( tri, combinedTransform );
-			*HostScene::triLights[tri->ltriIdx] = HostTriLight( &transformedTri, i, ID );
-		}
+		light->Set( &transformedTri, light->triIdx, ID );
+		HostScene::MarkTriLightDirty( handle );
 	}
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostNode::UpdateLightInstance                                              |
+//  |  Lights are created by the constructor, i.e. before HostScene assigned an   |
+//  |  ID to the node. This fixes the instance index stored with them.      LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostNode::UpdateLightInstance()
+{
+	for (int handle : lightHandles) HostScene::GetTriLight( handle )->instIdx = ID;
+}
+
 // EOF
\ No newline at end of file
@@ -31,14 +31,15 @@ public:
 	// constructor / destructor
 	HostNode() = default;
 	HostNode( const int meshIdx, const mat4& transform );
-	HostNode( const tinygltfNode& gltfNode, const int nodeBase, const int meshBase, const int skinBase );
+	HostNode( const tinygltfNode& gltfNode, const int nodeBase, const vector<int>& meshIdx, const int skinBase );
 	~HostNode();
 	// methods
-	void ConvertFromGLTFNode( const tinygltfNode& gltfNode, const int nodeBase, const int meshBase, const int skinBase );
+	void ConvertFromGLTFNode( const tinygltfNode& gltfNode, const int nodeBase, const vector<int>& meshIdx, const int skinBase );
 	bool Update( mat4& T, vector<int>& instances, int& instanceIdx );	// recursively update the transform of this node and its children
 	void UpdateTransformFromTRS();		// process T, R, S data to localTransform
 	void PrepareLights();				// detects emissive triangles and creates light triangles for them
 	void UpdateLights();				// when the transform changes, this fixes the light triangles
+	void UpdateLightInstance();			// propagate the node ID to the light triangles of this node
 	// data members
 	string name;						// node name as specified in the GLTF file
 	mat4 combinedTransform;				// transform combined with ancestor transforms
@@ -56,6 +57,11 @@ public:
 	bool transformed = false;			// local transform of node should be updated
 	bool treeChanged = false;			// this node or one of its children got updated
 	vector<int> childIdx;				// child nodes of this node
+	int parentIdx = -1;					// parent node; -1 for root nodes, see HostScene::RemoveNode
+	vector<int> lightHandles;			// handles of the light triangles of this instance, see HostScene::AddTriLight
+	int poseMeshID = -1;				// skinned nodes: mesh holding the posed geometry of this instance
+	int poseEntry = -1;					// skinned nodes: pose cache entry, see HostScene::AcquireSkinnedPose
+	int RenderMeshID() const { return poseMeshID > -1 ? poseMeshID : meshID; }	// mesh the cores use for this instance
 	TRACKCHANGES;
 protected:
 	friend class RenderSystem;
@@ -19,6 +19,27 @@
 void PBRTInit();
 void ParsePBRTScene( std::string filename );
 
+// helper: delete a converted texture that did not make it into the scene
+static void DeleteStagedTexture( HostTexture* texture )
+{
+	if (!texture) return;
+	FREE64( texture->idata ); FREE64( texture->fdata ); FREE64( texture->hdata ); FREE64( texture->bdata );
+	delete texture;
+}
+
+// a glTF scene on its way into the scene: loaded by LoadSceneData, added by CommitSceneData
+struct HostScene::StagedScene
+{
+	string file, dir;						// as passed to AddScene
+	mat4 transform;
+	tinygltf::Model model;
+	vector<HostTexture*> textures;			// per glTF texture; converted, but without an ID
+	vector<uint64_t> textureHashes;			// ContentHash of each converted texture
+	vector<HostMesh*> meshes;				// per glTF mesh; converted, but with glTF material indices
+	thread loader;							// background thread, see AddSceneAsync
+	atomic<bool> ready{ false };			// LoadSceneData completed
+};
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostScene::HostScene                                                       |
 //  |  Constructor.                                                         LH2'19|
@@ -37,6 +58,14 @@ HostScene::~HostScene()
 	for (auto mesh : meshPool) delete mesh;
 	for (auto material : materials) delete material;
 	for (auto texture : textures) delete texture;
+	// finish pending asynchronous loads
+	for (auto staged : stagedScenes) if (staged)
+	{
+		staged->loader.join();
+		for (auto texture : staged->textures) DeleteStagedTexture( texture );
+		for (auto mesh : staged->meshes) delete mesh;
+		delete staged;
+	}
 	delete sky;
 	delete camera;
 }
@@ -185,6 +214,24 @@ int HostScene::AddMesh( HostMesh* mesh )
 	return mesh->ID;
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::FindOrAddMesh                                                   |
+//  |  Add a mesh, unless a mesh with the same geometry is already in the scene;  |
+//  |  in that case, the ID of that mesh is returned, and the caller still owns   |
+//  |  'mesh'. Meshes with morph targets are posed in place, so these are never   |
+//  |  shared.                                                              LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::FindOrAddMesh( HostMesh* mesh )
+{
+	if (mesh->poses.size() > 1 || mesh->morphTargets.size() > 0) return AddMesh( mesh );
+	const uint64_t hash = mesh->ContentHash();
+	auto existing = meshLookup.find( hash );
+	if (existing != meshLookup.end() && meshPool[existing->second]->SameGeometry( *mesh )) return existing->second;
+	const int meshID = AddMesh( mesh );
+	meshLookup[hash] = meshID;
+	return meshID;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostScene::AddMesh                                                         |
 //  |  Create a mesh specified by a file name and data dir, apply a scale, add    |
@@ -203,7 +250,9 @@ int HostScene::AddMesh( const char* objFile, const float scale, const bool flatS
 int HostScene::AddMesh( const char* objFile, const char* dir, const float scale, const bool flatShaded )
 {
 	HostMesh* newMesh = new HostMesh( objFile, dir, scale, flatShaded );
-	return AddMesh( newMesh );
+	const int meshID = FindOrAddMesh( newMesh );
+	if (meshPool[meshID] != newMesh) delete newMesh;
+	return meshID;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -267,20 +316,87 @@ int HostScene::AddScene( const char* sceneFile, const mat4& transform )
 	delete tmp;
 	return retVal;
 }
+// helper: tinygltf image loader that only stores the encoded image; LoadSceneData decodes the images in parallel.
+static bool DeferImageDecode( tinygltf::Image* image, const int, string*, string*, int, int, const uchar* bytes, int size, void* )
+{
+	image->image.assign( bytes, bytes + size ); // width remains -1 until decoded
+	return true;
+}
+
 int HostScene::AddScene( const char* sceneFile, const char* dir, const mat4& transform )
 {
-	// offsets: if we loaded an object before this one, indices should not start at 0.
-	// based on https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/base/VulkanglTFModel.hpp
-	const int meshBase = (int)meshPool.size();
-	const int skinBase = (int)skins.size();
-	const int retVal = (int)nodePool.size();
-	const int nodeBase = (int)nodePool.size() + 1;
+	StagedScene staged;
+	staged.file = sceneFile, staged.dir = dir, staged.transform = transform;
+	LoadSceneData( staged, true );
+	return CommitSceneData( staged );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::AddSceneAsync                                                   |
+//  |  Start loading a glTF scene on a background thread. Pass the returned       |
+//  |  handle to CommitScene to add the scene in one step, e.g. once SceneLoaded  |
+//  |  reports that this will not block.                                    LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::AddSceneAsync( const char* sceneFile, const char* dir, const mat4& transform )
+{
+	StagedScene* staged = new StagedScene();
+	staged->file = sceneFile, staged->dir = dir, staged->transform = transform;
+	staged->loader = thread( [staged]() { LoadSceneData( *staged, false ); staged->ready = true; } );
+	for (int s = (int)stagedScenes.size(), i = 0; i < s; i++) if (!stagedScenes[i])
+	{
+		// reuse the handle of a committed scene
+		stagedScenes[i] = staged;
+		return i;
+	}
+	stagedScenes.push_back( staged );
+	return (int)stagedScenes.size() - 1;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::SceneLoaded                                                     |
+//  |  Check if an asynchronously loaded scene is ready to be committed.    LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool HostScene::SceneLoaded( const int handle )
+{
+	FATALERROR_IF( handle < 0 || handle >= (int)stagedScenes.size() || !stagedScenes[handle], "invalid scene handle: %i", handle );
+	return stagedScenes[handle]->ready;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::CommitScene                                                     |
+//  |  Add an asynchronously loaded scene; waits for the background thread if     |
+//  |  it did not finish yet. Returns the same node ID as AddScene.         LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::CommitScene( const int handle )
+{
+	FATALERROR_IF( handle < 0 || handle >= (int)stagedScenes.size() || !stagedScenes[handle], "invalid scene handle: %i", handle );
+	StagedScene* staged = stagedScenes[handle];
+	stagedScenes[handle] = 0;
+	staged->loader.join();
+	const int nodeId = CommitSceneData( *staged );
+	delete staged;
+	return nodeId;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::LoadSceneData                                                   |
+//  |  First half of AddScene: parse a glTF file, decode its images and convert   |
+//  |  its textures, including the MIP maps, and its meshes. Mesh triangles refer |
+//  |  to the glTF materials until CommitSceneData. The scene is not modified, so |
+//  |  this may run on a background thread. With 'skipExisting', textures that    |
+//  |  are already in the scene are skipped; this reads the scene, so it is only  |
+//  |  used when loading synchronously.                                     LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::LoadSceneData( StagedScene& staged, const bool skipExisting )
+{
+	const char* sceneFile = staged.file.c_str(), * dir = staged.dir.c_str();
 	// load gltf file
 	string cleanFileName = string( dir ) + (dir[strlen( dir ) - 1] == '/' ? "" : "/") + string( sceneFile );
-	tinygltf::Model gltfModel;
+	tinygltf::Model& gltfModel = staged.model;
 	tinygltf::TinyGLTF loader;
 	string err, warn;
 	bool ret = false;
+	loader.SetImageLoader( DeferImageDecode, 0 );
 	if (cleanFileName.size() > 4)
 	{
 		string extension4 = cleanFileName.substr( cleanFileName.size() - 5, 5 );
@@ -293,37 +409,103 @@ int HostScene::AddScene( const char* sceneFile, const char* dir, const mat4& tra
 	if (!warn.empty()) printf( "Warn: %s\n", warn.c_str() );
 	if (!err.empty()) printf( "Err: %s\n", err.c_str() );
 	FATALERROR_IF( !ret, "could not load glTF file:\n%s", cleanFileName.c_str() );
-	// convert textures
+	// decode images in parallel
+	vector<int> decoded( gltfModel.images.size(), 1 );
+	ParallelFor( 0, (int)gltfModel.images.size(), [&]( int i ) {
+		tinygltf::Image& image = gltfModel.images[i];
+		if (image.width != -1 || image.image.size() == 0) return;
+		vector<uchar> encoded;
+		encoded.swap( image.image );
+		string imageErr, imageWarn;
+		decoded[i] = tinygltf::LoadImageData( &image, i, &imageErr, &imageWarn, 0, 0, encoded.data(), (int)encoded.size(), 0 ) ? 1 : 0;
+	} );
+	for (size_t s = decoded.size(), i = 0; i < s; i++)
+		FATALERROR_IF( !decoded[i], "could not decode image %i in glTF file:\n%s", (int)i, cleanFileName.c_str() );
+	// convert textures; pixel conversion and MIP construction run in parallel
+	vector<char> isColor( gltfModel.textures.size(), 0 ); // color textures are sRGB
+	vector<int> baseColor( gltfModel.materials.size(), -1 );
+	for (size_t s = gltfModel.materials.size(), i = 0; i < s; i++)
+	{
+		const tinygltf::Material& material = gltfModel.materials[i];
+		auto base = material.values.find( "baseColorTexture" );
+		auto emissive = material.additionalValues.find( "emissiveTexture" );
+		if (base != material.values.end() && base->second.TextureIndex() >= 0) isColor[baseColor[i] = base->second.TextureIndex()] = 1;
+		if (emissive != material.additionalValues.end() && emissive->second.TextureIndex() >= 0) isColor[emissive->second.TextureIndex()] = 1;
+	}
+	staged.textures.resize( gltfModel.textures.size(), 0 );
+	staged.textureHashes.resize( gltfModel.textures.size(), 0 );
+	ParallelFor( 0, (int)gltfModel.textures.size(), [&]( int i ) {
+		char t[1024];
+		sprintf_s( t, "%s-%s-%03i", dir, sceneFile, i );
+		if (skipExisting && FindTextureID( t ) != -1) return;
+		const tinygltf::Image& image = gltfModel.images[gltfModel.textures[i].source];
+		HostTexture* texture = new HostTexture();
+		texture->name = t;
+		texture->width = image.width;
+		texture->height = image.height;
+		texture->MIPlevels = HostTexture::MIPlevelsNeeded( image.width, image.height );
+		texture->idata = (uchar4*)MALLOC64( texture->PixelsNeeded( image.width, image.height, texture->MIPlevels ) * sizeof( uint ) );
+		texture->flags |= HostTexture::LDR;
+		memcpy( texture->idata, image.image.data(), image.component * image.width * image.height );
+		texture->ConstructMIPmaps( isColor[i] != 0 );
+		staged.textures[i] = texture;
+		staged.textureHashes[i] = texture->ContentHash();
+	} );
+	// the decoded images are no longer needed
+	for (tinygltf::Image& image : gltfModel.images) vector<uchar>().swap( image.image );
+	// convert meshes; the color texture of each material provides the texture LOD and single-texel colors
+	vector<HostTexture*> colorTextures( gltfModel.materials.size(), 0 );
+	for (size_t s = baseColor.size(), i = 0; i < s; i++) if (baseColor[i] > -1)
+	{
+		char t[1024];
+		sprintf_s( t, "%s-%s-%03i", dir, sceneFile, baseColor[i] );
+		HostTexture* texture = staged.textures[baseColor[i]];
+		colorTextures[i] = texture ? texture : textures[FindTextureID( t )]; // not staged: already in the scene
+	}
+	for (const tinygltf::Mesh& gltfMesh : gltfModel.meshes)
+		staged.meshes.push_back( new HostMesh( gltfMesh, gltfModel, colorTextures, gltfModel.materials.size() == 0 ? 0 : -1 ) );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::CommitSceneData                                                 |
+//  |  Second half of AddScene: add the converted textures and meshes to the      |
+//  |  scene, and convert the materials, nodes, animations and skins. Only the    |
+//  |  material IDs of the meshes are resolved here. An extra node holds the      |
+//  |  transform for the glTF scene; its ID is returned.                    LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::CommitSceneData( StagedScene& staged )
+{
+	const char* sceneFile = staged.file.c_str(), * dir = staged.dir.c_str();
+	tinygltf::Model& gltfModel = staged.model;
+	const mat4& transform = staged.transform;
+	// offsets: if we loaded an object before this one, indices should not start at 0.
+	// based on https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/base/VulkanglTFModel.hpp
+	const int skinBase = (int)skins.size();
+	const int retVal = (int)nodePool.size();
+	const int nodeBase = (int)nodePool.size() + 1;
+	// add textures; IDs are assigned in order, existing textures are reused
 	vector<int> texIdx;
 	for (size_t s = gltfModel.textures.size(), i = 0; i < s; i++)
 	{
 		char t[1024];
 		sprintf_s( t, "%s-%s-%03i", dir, sceneFile, (int)i );
+		HostTexture* texture = staged.textures[i];
 		int textureID = FindTextureID( t );
 		if (textureID != -1)
 		{
 			// push id of existing texture
+			DeleteStagedTexture( texture );
 			texIdx.push_back( textureID );
 		}
 		else
 		{
-			// create new texture
-			tinygltf::Texture& gltfTexture = gltfModel.textures[i];
-			HostTexture* texture = new HostTexture();
-			const tinygltf::Image& image = gltfModel.images[gltfTexture.source];
-			const size_t size = image.component * image.width * image.height;
-			texture->name = t;
-			texture->width = image.width;
-			texture->height = image.height;
-			texture->idata = (uchar4*)MALLOC64( texture->PixelsNeeded( image.width, image.height, MIPLEVELCOUNT ) * sizeof( uint ) );
-			texture->ID = (uint)textures.size();
-			texture->flags |= HostTexture::LDR;
-			memcpy( texture->idata, image.image.data(), size );
-			texture->ConstructMIPmaps();
-			textures.push_back( texture );
-			texIdx.push_back( texture->ID );
+			// add the new texture, or reuse a texture with the same texels
+			textureID = FindOrAddTexture( texture, staged.textureHashes[i] );
+			if (textures[textureID] != texture) DeleteStagedTexture( texture );
+			texIdx.push_back( textureID );
 		}
 	}
+	staged.textures.clear();
 	// convert materials
 	vector<int> matIdx;
 	for (size_t s = gltfModel.materials.size(), i = 0; i < s; i++)
@@ -341,23 +523,26 @@ int HostScene::AddScene( const char* sceneFile, const char* dir, const mat4& tra
 			// create new material
 			tinygltf::Material& gltfMaterial = gltfModel.materials[i];
 			HostMaterial* material = new HostMaterial();
-			material->ID = (int)materials.size();
 			material->origin = t;
 			material->ConvertFrom( gltfMaterial, gltfModel, texIdx );
 			material->flags |= HostMaterial::FROM_MTL;
-			materials.push_back( material );
-			matIdx.push_back( material->ID );
+			matID = FindOrAddMaterial( material );
+			if (materials[matID] != material) delete material;
+			matIdx.push_back( matID );
 			// materialList.push_back( material->ID ); // can't do that, need something smarter.
 		}
 	}
-	// convert meshes
-	for (size_t s = gltfModel.meshes.size(), i = 0; i < s; i++)
+	// add meshes; meshes that are already in the scene are reused
+	if (matIdx.size() == 0) matIdx.push_back( 0 ); // no materials; the meshes use the default material
+	vector<int> meshIdx;
+	for (HostMesh* newMesh : staged.meshes)
 	{
-		tinygltf::Mesh& gltfMesh = gltfModel.meshes[i];
-		HostMesh* newMesh = new HostMesh( gltfMesh, gltfModel, matIdx, gltfModel.materials.size() == 0 ? 0 : -1 );
-		newMesh->ID = (int)i + meshBase;
-		meshPool.push_back( newMesh );
+		newMesh->ResolveStagedMaterials( matIdx );
+		const int meshID = FindOrAddMesh( newMesh );
+		if (meshPool[meshID] != newMesh) delete newMesh;
+		meshIdx.push_back( meshID );
 	}
+	staged.meshes.clear();
 	// push an extra node that holds a transform for the gltf scene
 	HostNode* newNode = new HostNode();
 	newNode->localTransform = transform;
@@ -367,8 +552,9 @@ int HostScene::AddScene( const char* sceneFile, const char* dir, const mat4& tra
 	for (size_t s = gltfModel.nodes.size(), i = 0; i < s; i++)
 	{
 		tinygltf::Node& gltfNode = gltfModel.nodes[i];
-		HostNode* newNode = new HostNode( gltfNode, nodeBase, meshBase, skinBase );
+		HostNode* newNode = new HostNode( gltfNode, nodeBase, meshIdx, skinBase );
 		newNode->ID = (int)nodePool.size();
+		newNode->UpdateLightInstance();
 		nodePool.push_back( newNode );
 	}
 	// convert animations and skins
@@ -386,6 +572,8 @@ int HostScene::AddScene( const char* sceneFile, const char* dir, const mat4& tra
 	tinygltf::Scene& glftScene = gltfModel.scenes[0];
 	// add the root nodes to the scene transform node
 	for (size_t i = 0; i < glftScene.nodes.size(); i++) nodePool[nodeBase - 1]->childIdx.push_back( glftScene.nodes[i] + nodeBase );
+	// link the children of the new nodes to their parent
+	for (int s = (int)nodePool.size(), i = nodeBase - 1; i < s; i++) for (int child : nodePool[i]->childIdx) nodePool[child]->parentIdx = i;
 	// add the root transform to the scene
 	rootNodes.push_back( nodeBase - 1 );
 	// return index of first created node
@@ -466,6 +654,7 @@ int HostScene::AddInstance( HostNode* newNode )
 			newNode->ID = i;
 			rootNodes.push_back( i );
 			nodeListHoles--; // plugged one hole.
+			newNode->UpdateLightInstance();
 			return i;
 		}
 	}
@@ -475,6 +664,7 @@ int HostScene::AddInstance( HostNode* newNode )
 	newNode->ID = (int)nodePool.size();
 	nodePool.push_back( newNode );
 	rootNodes.push_back( newNode->ID );
+	newNode->UpdateLightInstance();
 	return newNode->ID;
 }
 
@@ -488,12 +678,28 @@ int HostScene::AddInstance( const int meshId, const mat4& transform )
 	return AddInstance( newNode );
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::AddChildNode                                                    |
+//  |  Add a node below an existing node, e.g. one of the shapes of an object     |
+//  |  instance. The child inherits the combined transform of the parent.   LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::AddChildNode( const int parentId, HostNode* newNode )
+{
+	newNode->ID = (int)nodePool.size();
+	nodePool.push_back( newNode );
+	nodePool[parentId]->childIdx.push_back( newNode->ID );
+	newNode->parentIdx = parentId;
+	newNode->UpdateLightInstance();
+	return newNode->ID;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostScene::RemoveNode                                                      |
 //  |  Remove a node from the scene.                                              |
-//  |  This also removes the node from the rootNodes vector. Note that will only  |
-//  |  work correctly if the node is not part of a hierarchy. This assumption is  |
-//  |  valid for nodes that have been created using AddInstance.                  |
+//  |  This also removes the node from the rootNodes vector, or from the child    |
+//  |  list of its parent, so a node that later reuses the slot is not removed    |
+//  |  with the parent. Child nodes, e.g. those added using AddChildNode, are     |
+//  |  removed as well.                                                           |
 //  |  See the notes at the top of host_scene.h for the relation between host     |
 //  |  nodes and core instances.                                            LH2'19|
 //  +-----------------------------------------------------------------------------+
@@ -506,11 +712,27 @@ void HostScene::RemoveNode( const int nodeId )
 		rootNodes.pop_back();
 		break;
 	}
-	// delete the instance
-	HostNode* node = nodePool[nodeId];
-	nodePool[nodeId] = 0; // safe; we only access the nodes vector indirectly.
-	delete node;
-	nodeListHoles++; // HostScene::AddInstance will fill up holes first.
+	// or from the child list of its parent
+	const HostNode* removed = nodePool[nodeId];
+	if (removed && removed->parentIdx > -1 && nodePool[removed->parentIdx])
+	{
+		vector<int>& siblings = nodePool[removed->parentIdx]->childIdx;
+		auto child = find( siblings.begin(), siblings.end(), nodeId );
+		if (child != siblings.end()) siblings.erase( child );
+	}
+	// delete the instance and the nodes below it
+	vector<int> stack( 1, nodeId );
+	while (stack.size() > 0)
+	{
+		const int id = stack.back();
+		stack.pop_back();
+		HostNode* node = nodePool[id];
+		if (!node) continue; // already removed
+		nodePool[id] = 0; // safe; we only access the nodes vector indirectly.
+		for (int child : node->childIdx) stack.push_back( child );
+		delete node;
+		nodeListHoles++; // HostScene::AddInstance will fill up holes first.
+	}
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -537,8 +759,48 @@ int HostScene::FindOrCreateTexture( const string& origin, const uint modFlags )
 		texture->refCount++;
 		return texture->ID;
 	}
-	// nothing found, create a new texture
-	return CreateTexture( origin, modFlags );
+	// the file may have been merged with a texture that has the same texels
+	auto alias = textureAliases.find( make_pair( origin, modFlags ) );
+	if (alias != textureAliases.end())
+	{
+		textures[alias->second]->refCount++;
+		return alias->second;
+	}
+	// nothing found, load the texture; if its texels are already in the scene, that texture is used
+	HostTexture* newTexture = new HostTexture( origin.c_str(), modFlags );
+	const int textureID = FindOrAddTexture( newTexture, newTexture->ContentHash() );
+	if (textures[textureID] != newTexture)
+	{
+		textureAliases[make_pair( origin, modFlags )] = textureID;
+		textures[textureID]->refCount++;
+		DeleteStagedTexture( newTexture );
+	}
+	return textureID;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::FindOrAddTexture                                                |
+//  |  Add a texture, unless a texture with the same texels is already in the     |
+//  |  scene; in that case, the ID of that texture is returned, and the caller    |
+//  |  still owns 'texture'. 'hash' is the ContentHash of the texture as loaded,  |
+//  |  i.e. before compression or streaming; the lookup is keyed on it, so a      |
+//  |  texture that was compressed, streamed or released is still found. A        |
+//  |  texture whose texels were edited leaves the lookup.                  LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::FindOrAddTexture( HostTexture* texture, const uint64_t hash )
+{
+	auto existing = textureLookup.find( hash );
+	if (existing != textureLookup.end())
+	{
+		HostTexture* candidate = textures[existing->second];
+		if (candidate->texelsEdited) textureLookup.erase( existing ); // no longer holds the texels of the key
+		else if (candidate->Released() || candidate->bdata || candidate->residentLevel > 0) return existing->second; // same content, other representation
+		else if (candidate->SameTexels( *texture )) return existing->second;
+	}
+	texture->ID = (uint)textures.size();
+	textures.push_back( texture );
+	textureLookup[hash] = texture->ID;
+	return texture->ID;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -594,6 +856,36 @@ int HostScene::FindOrCreateMaterialCopy( const int matID, const uint color )
 	return newID;
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::FindOrAddMaterial                                               |
+//  |  Add a material, unless a material with the same properties is already in   |
+//  |  the scene; in that case, the ID of that material is returned, and the      |
+//  |  caller still owns 'material'. A material that was edited after it was      |
+//  |  added fails the comparison; the new material then takes over its key.      |
+//  |  The name and origin of a merged material become aliases, see               |
+//  |  FindMaterialID.                                                      LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::FindOrAddMaterial( HostMaterial* material )
+{
+	if (material->ID >= 0 && material->ID < (int)materials.size() && materials[material->ID] == material) return material->ID;
+	const uint64_t hash = material->ContentHash();
+	auto existing = materialLookup.find( hash );
+	if (existing != materialLookup.end())
+	{
+		HostMaterial* candidate = materials[existing->second];
+		if (candidate->SameParameters( *material ))
+		{
+			candidate->refCount++;
+			materialNameAliases.insert( make_pair( material->name, existing->second ) );
+			materialOriginAliases.insert( make_pair( material->origin, existing->second ) );
+			return existing->second;
+		}
+	}
+	const int matID = material->ID = AddMaterial( material );
+	materialLookup[hash] = matID;
+	return matID;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostScene::FindMaterialID                                                  |
 //  |  Find the ID of a material with the specified name.                   LH2'19|
@@ -601,7 +893,9 @@ int HostScene::FindOrCreateMaterialCopy( const int matID, const uint color )
 int HostScene::FindMaterialID( const char* name )
 {
 	for (auto material : materials) if (material->name.compare( name ) == 0) return material->ID;
-	return -1;
+	// the material may have been merged with a material that has the same properties
+	auto alias = materialNameAliases.find( name );
+	return alias == materialNameAliases.end() ? -1 : alias->second;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -611,7 +905,8 @@ int HostScene::FindMaterialID( const char* name )
 int HostScene::FindMaterialIDByOrigin( const char* name )
 {
 	for (auto material : materials) if (material->origin.compare( name ) == 0) return material->ID;
-	return -1;
+	auto alias = materialOriginAliases.find( name );
+	return alias == materialOriginAliases.end() ? -1 : alias->second;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -677,6 +972,238 @@ void HostScene::UpdateAnimation( const int animId, const float dt )
 	animations[animId]->Update( dt );
 }
 
+// helper: select the animation LOD tier for a set of nodes, based on the distance of their
+// bounding sphere to the camera and on its visibility. Node positions are from the last frame.
+static const AnimationLOD& SelectAnimationLOD( const vector<int>& nodes, const float3& camPos, const float4* planes )
+{
+	const vector<AnimationLOD>& tiers = HostScene::animationLOD;
+	if (nodes.size() == 0) return tiers[0];
+	float3 bmin = make_float3( 1e34f ), bmax = make_float3( -1e34f );
+	for (int nodeIdx : nodes)
+	{
+		const float3 P = HostScene::nodePool[nodeIdx]->combinedTransform.GetTranslation();
+		bmin = fminf( bmin, P ), bmax = fmaxf( bmax, P );
+	}
+	// joints are inside the mesh; enlarge the sphere a bit to cover the skin
+	const float3 center = (bmin + bmax) * 0.5f;
+	const float radius = length( bmax - bmin ) * 0.75f;
+	for (int i = 0; i < 5; i++) if (dot( make_float3( planes[i] ), center ) + planes[i].w < -radius) return HostScene::offscreenAnimationLOD;
+	const float distance = max( 0.0f, length( center - camPos ) - radius );
+	for (const AnimationLOD& tier : tiers) if (distance <= tier.distance) return tier;
+	return tiers.back();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::UpdateAnimations                                                |
+//  |  Update all animations in a single batch. If animation LOD tiers have been  |
+//  |  specified, each animation is updated at the rate of its tier, based on     |
+//  |  the distance and visibility of the nodes it affects. Skipped time is       |
+//  |  accumulated, so reduced-rate animations stay in sync. Skinned meshes are   |
+//  |  posed at the rate of the tier of their joints, or not at all. Updates are  |
+//  |  staggered over frames, so a crowd does not update all at once.       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::UpdateAnimations( const float dt )
+{
+	if (animations.size() == 0) return;
+	if (animationLOD.size() == 0 || !camera)
+	{
+		for (HostSkin* skin : skins) skin->skipPose = false;
+		HostAnimation::Update( animations, dt );
+		return;
+	}
+	// frustum planes (normals pointing inwards) from the view pyramid
+	const ViewPyramid view = camera->GetView();
+	const float3 p4 = view.p2 + view.p3 - view.p1, C = (view.p2 + view.p3) * 0.5f;
+	const float3 corner[5] = { view.p1, view.p2, p4, view.p3, view.p1 };
+	float4 planes[5];
+	for (int i = 0; i < 4; i++)
+	{
+		float3 N = normalize( cross( corner[i] - view.pos, corner[i + 1] - view.pos ) );
+		if (dot( N, C - view.pos ) < 0) N *= -1.0f;
+		planes[i] = make_float4( N, -dot( N, view.pos ) );
+	}
+	const float3 forward = normalize( C - view.pos );
+	planes[4] = make_float4( forward, -dot( forward, view.pos ) );
+	// select the animations that are due this frame
+	static vector<HostAnimation*> due;
+	static vector<float> dueTime;
+	due.clear(), dueTime.clear();
+	animationFrame++;
+	for (int s = (int)animations.size(), i = 0; i < s; i++)
+	{
+		HostAnimation* anim = animations[i];
+		const AnimationLOD& lod = SelectAnimationLOD( anim->targetNodes, view.pos, planes );
+		anim->lodTime += dt;
+		if (lod.interval == 0 || (animationFrame + i) % lod.interval != 0) continue;
+		due.push_back( anim ), dueTime.push_back( anim->lodTime ), anim->lodTime = 0;
+	}
+	if (due.size() > 0) HostAnimation::Update( due, dueTime );
+	// decide which skins will be posed in the next scene graph update
+	for (int s = (int)skins.size(), i = 0; i < s; i++)
+	{
+		const AnimationLOD& lod = SelectAnimationLOD( skins[i]->joints, view.pos, planes );
+		skins[i]->skipPose = !lod.skinning || lod.interval == 0 || (animationFrame + i) % lod.interval != 0;
+	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::BakeAnimations                                                  |
+//  |  Resample and quantize all animations; see HostAnimation::Bake.       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::BakeAnimations( const float rate )
+{
+	for (HostAnimation* anim : animations) anim->Bake( rate );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::AcquireSkinnedPose                                              |
+//  |  Get a mesh with the geometry of a skinned mesh, posed using the current    |
+//  |  joint matrices of the skin. Instances with the same pose (within           |
+//  |  poseQuantization) share one posed mesh, so skinning cost and memory scale  |
+//  |  with the number of distinct poses rather than the number of instances.     |
+//  |  The first pose of a mesh uses the mesh itself; additional poses use pose   |
+//  |  copies, which are recycled once no node uses them anymore.                 |
+//  |  Morph target 'weights' of skinned meshes are part of the pose: they are    |
+//  |  blended into the bind pose of the posed mesh before skinning.              |
+//  |  'poseEntry' is the cache entry of the calling node; -1 initially.    LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::AcquireSkinnedPose( const int meshId, const HostSkin* skin, const vector<float>& weights, int& poseEntry )
+{
+	// pose key: mesh ID, quantized joint matrices and quantized morph weights
+	static vector<int> q;
+	const int jointCount = (int)skin->jointMat.size();
+	const bool morphed = weights.size() > 0 && weights.size() + 1 == meshPool[meshId]->poses.size();
+	const int weightCount = morphed ? (int)weights.size() : 0;
+	q.resize( 1 + jointCount * 12 + weightCount );
+	q[0] = meshId;
+	const float scale = 1.0f / poseQuantization;
+	for (int j = 0; j < jointCount; j++) for (int i = 0; i < 12; i++)
+		q[1 + j * 12 + i] = (int)floorf( skin->jointMat[j].cell[i] * scale + 0.5f );
+	for (int i = 0; i < weightCount; i++) q[1 + jointCount * 12 + i] = (int)floorf( weights[i] * scale + 0.5f );
+	const uint64_t key = calccrc64( (uchar*)q.data(), (int)q.size() * sizeof( int ) );
+	// existing pose
+	auto hit = poseLookup.find( key );
+	if (hit != poseLookup.end() && poseCache[hit->second].baseMesh == meshId)
+	{
+		const int entry = hit->second;
+		if (entry != poseEntry)
+		{
+			if (poseEntry > -1) poseCache[poseEntry].users--;
+			poseCache[entry].users++, poseEntry = entry;
+		}
+		return poseCache[entry].mesh;
+	}
+	// new pose: re-skin our own entry if no one else uses it, otherwise use an unused entry of this mesh
+	int entry = -1;
+	if (poseEntry > -1 && poseCache[poseEntry].users == 1) entry = poseEntry; else
+	{
+		if (poseEntry > -1) poseCache[poseEntry].users--;
+		bool meshHasPoses = false;
+		for (int s = (int)poseCache.size(), i = 0; i < s && entry == -1; i++) if (poseCache[i].baseMesh == meshId)
+		{
+			meshHasPoses = true;
+			if (poseCache[i].users == 0) entry = i;
+		}
+		if (entry == -1)
+		{
+			// the first pose of a mesh is stored in the mesh itself
+			meshPool[meshId]->StoreBindPose();
+			const int mesh = meshHasPoses ? AddMesh( meshPool[meshId]->CreatePoseCopy() ) : meshId;
+			entry = (int)poseCache.size();
+			poseCache.push_back( { meshId, mesh, 0, 0 } );
+		}
+		poseCache[entry].users++, poseEntry = entry;
+	}
+	// store the new key and skin
+	SkinnedPose& pose = poseCache[entry];
+	auto previous = poseLookup.find( pose.key );
+	if (previous != poseLookup.end() && previous->second == entry) poseLookup.erase( previous );
+	pose.key = key;
+	poseLookup[key] = entry;
+	HostMesh* mesh = meshPool[pose.mesh];
+	if (morphed) meshPool[meshId]->MorphBindPose( weights, mesh );
+	mesh->SetPose( skin, pose.mesh == meshId ? 0 : meshPool[meshId] );
+	return pose.mesh;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::ReleaseSkinnedPose                                              |
+//  |  Called when a node that uses a skinned pose is deleted.              LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::ReleaseSkinnedPose( const int poseEntry )
+{
+	if (poseEntry > -1 && poseEntry < (int)poseCache.size()) poseCache[poseEntry].users--;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::UpdateMorphTargets                                              |
+//  |  Apply the morph target weights collected by HostNode::Update. Several      |
+//  |  nodes may share a mesh; like before, the last node wins. Distinct meshes   |
+//  |  are processed in parallel. The light triangles of the nodes are updated    |
+//  |  afterwards, so they follow the blended geometry.                     LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::UpdateMorphTargets()
+{
+	vector<int> nodes;
+	vector<bool> seen( meshPool.size(), false );
+	for (int i = (int)morphedNodes.size() - 1; i >= 0; i--)
+	{
+		HostNode* node = nodePool[morphedNodes[i]];
+		if (!seen[node->meshID]) seen[node->meshID] = true, nodes.push_back( node->ID );
+	}
+	ParallelFor( 0, (int)nodes.size(), [&]( int i ) {
+		HostNode* node = nodePool[nodes[i]];
+		meshPool[node->meshID]->SetPose( node->weights );
+	} );
+	for (int nodeIdx : morphedNodes) nodePool[nodeIdx]->UpdateLights(); // no-op without lights
+	morphedNodes.clear();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::PreloadTextures                                                 |
+//  |  Load a list of texture files (with their modFlags) in parallel. Textures   |
+//  |  that do not exist yet are created in the order of the list, so texture IDs |
+//  |  are the same as when the textures are created one by one. A subsequent     |
+//  |  FindOrCreateTexture for these files will find the preloaded texture. A     |
+//  |  file with the same texels as an existing texture is not added; it becomes  |
+//  |  an alias of that texture.                                                  |
+//  |  Note: relative paths are resolved against the current directory.     LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::PreloadTextures( const vector<pair<string, uint>>& files )
+{
+	vector<HostTexture*> newTextures;
+	auto known = [&]( const pair<string, uint>& file ) {
+		if (textureAliases.find( file ) != textureAliases.end()) return true;
+		for (auto texture : textures) if (texture->Equals( file.first, file.second )) return true;
+		for (auto texture : newTextures) if (texture->Equals( file.first, file.second )) return true;
+		return false;
+	};
+	for (const auto& file : files)
+	{
+		if (known( file )) continue;
+		HostTexture* texture = new HostTexture();
+		texture->origin = file.first;
+		texture->mods = file.second;
+		texture->refCount = 0; // FindOrCreateTexture will claim it
+		newTextures.push_back( texture );
+	}
+	vector<uint64_t> hashes( newTextures.size() );
+	ParallelFor( 0, (int)newTextures.size(), [&]( int i ) {
+		HostTexture* texture = newTextures[i];
+		texture->Load( texture->origin.c_str(), texture->mods );
+		hashes[i] = texture->ContentHash();
+	} );
+	// add in the order of the list; a file with the same texels as an earlier texture becomes an alias
+	for (size_t s = newTextures.size(), i = 0; i < s; i++)
+	{
+		HostTexture* texture = newTextures[i];
+		const int textureID = FindOrAddTexture( texture, hashes[i] );
+		if (textures[textureID] == texture) continue;
+		textureAliases[make_pair( texture->origin, texture->mods )] = textureID;
+		DeleteStagedTexture( texture );
+	}
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostScene::CreateTexture                                                   |
 //  |  Return a texture. Create it anew, even if a texture with the same origin   |
@@ -764,4 +1291,64 @@ int HostScene::AddDirectionalLight( const float3 direction, const float3 radianc
 	return light->ID;
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::AddTriLight                                                     |
+//  |  Add a light triangle to the scene. The triLights vector is kept dense, so  |
+//  |  it can be passed to the cores as-is; a light may thus move when another    |
+//  |  light is removed. The returned handle however remains valid until the      |
+//  |  light is removed.                                                    LH2'20|
+//  +-----------------------------------------------------------------------------+
+int HostScene::AddTriLight( HostTriLight* light )
+{
+	if (freeTriLightHandles.size() > 0)
+	{
+		// recycle a handle released by RemoveTriLight
+		light->handle = freeTriLightHandles.back();
+		freeTriLightHandles.pop_back();
+		triLightSlots[light->handle] = (int)triLights.size();
+	}
+	else
+	{
+		light->handle = (int)triLightSlots.size();
+		triLightSlots.push_back( (int)triLights.size() );
+	}
+	triLights.push_back( light );
+	triLightListChanged = true;
+	return light->handle;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostScene::RemoveTriLight                                                  |
+//  |  Remove a light triangle in O(1): the last light in the list takes its      |
+//  |  place. Mesh triangles store the index of their light for MIS; these are    |
+//  |  patched for the light that is removed and for the one that moved.    LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostScene::RemoveTriLight( const int handle )
+{
+	const int idx = triLightSlots[handle], last = (int)triLights.size() - 1;
+	HostTriLight* light = triLights[idx];
+	if (light->meshIdx > -1)
+	{
+		HostTri& tri = meshPool[light->meshIdx]->triangles[light->triIdx];
+		if (tri.ltriIdx == idx) tri.ltriIdx = -1;
+	}
+	if (idx != last)
+	{
+		// move the last light into the vacated slot
+		HostTriLight* moved = triLights[last];
+		triLights[idx] = moved;
+		triLightSlots[moved->handle] = idx;
+		if (moved->meshIdx > -1)
+		{
+			HostTri& tri = meshPool[moved->meshIdx]->triangles[moved->triIdx];
+			if (tri.ltriIdx == last) tri.ltriIdx = idx;
+		}
+	}
+	triLights.pop_back();
+	triLightListChanged = true;
+	triLightSlots[handle] = -1;
+	freeTriLightHandles.push_back( handle );
+	delete light;
+}
+
 // EOF
\ No newline at end of file
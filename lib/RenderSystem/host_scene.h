@@ -68,8 +68,11 @@ public:
 	static int FindOrCreateTexture( const string& origin, const uint modFlags = 0 );
 	static int FindTextureID( const char* name );
 	static int CreateTexture( const string& origin, const uint modFlags = 0 );
+	static void PreloadTextures( const vector<pair<string, uint>>& files );
+	static int FindOrAddTexture( HostTexture* texture, const uint64_t hash );
 	static int FindOrCreateMaterial( const string& name );
 	static int FindOrCreateMaterialCopy( const int matID, const uint color );
+	static int FindOrAddMaterial( HostMaterial* material );
 	static int FindMaterialID( const char* name );
 	static int FindMaterialIDByOrigin( const char* name );
 	static int FindNextMaterialID( const char* name, const int matID );
@@ -78,24 +81,39 @@ public:
 	static const mat4& GetNodeTransform( const int nodeId );
 	static void ResetAnimation( const int animId );
 	static void UpdateAnimation( const int animId, const float dt );
+	static void UpdateAnimations( const float dt );
+	static void BakeAnimations( const float rate = 30 );
+	static void UpdateMorphTargets();
 	static int AnimationCount() { return (int)animations.size(); }
 	// scene construction / maintenance
 	static int AddMesh( HostMesh* mesh );
+	static int FindOrAddMesh( HostMesh* mesh );
 	static int AddMesh( const char* objFile, const char* dir, const float scale = 1.0f, const bool flatShaded = false );
 	static int AddMesh( const char* objFile, const float scale = 1.0f, const bool flatShaded = false );
 	static int AddScene( const char* sceneFile, const mat4& transform = mat4::Identity() );
 	static int AddScene( const char* sceneFile, const char* dir, const mat4& transform );
+	static int AddSceneAsync( const char* sceneFile, const char* dir, const mat4& transform );
+	static bool SceneLoaded( const int handle );
+	static int CommitScene( const int handle );
 	static int AddMesh( const int triCount );
 	static void AddTriToMesh( const int meshId, const float3& v0, const float3& v1, const float3& v2, const int matId );
 	static int AddQuad( const float3 N, const float3 pos, const float width, const float height, const int matId, const int meshID = -1 );
 	static int AddInstance( HostNode* node );
 	static int AddInstance( const int meshId, const mat4& transform );
+	static int AddChildNode( const int parentId, HostNode* node );
 	static void RemoveNode( const int instId );
 	static int AddMaterial( HostMaterial* material );
 	static int AddMaterial( const float3 color, const char* name = 0 );
 	static int AddPointLight( const float3 pos, const float3 radiance, bool enabled = true );
 	static int AddSpotLight( const float3 pos, const float3 direction, const float inner, const float outer, const float3 radiance, bool enabled = true );
 	static int AddDirectionalLight( const float3 direction, const float3 radiance, bool enabled = true );
+	static int AddTriLight( HostTriLight* light );
+	static void RemoveTriLight( const int handle );
+	static HostTriLight* GetTriLight( const int handle ) { return triLights[triLightSlots[handle]]; }
+	static void MarkTriLightDirty( const int handle ) { dirtyTriLights.push_back( handle ); }	// call after editing a tri light
+	static int GetTriLightIndex( const int handle ) { return triLightSlots[handle]; }
+	static int AcquireSkinnedPose( const int meshId, const HostSkin* skin, const vector<float>& weights, int& poseEntry );
+	static void ReleaseSkinnedPose( const int poseEntry );
 	// data members
 	static inline vector<int> rootNodes;
 	static inline vector<HostNode*> nodePool;
@@ -104,14 +122,42 @@ public:
 	static inline vector<HostAnimation*> animations;
 	static inline vector<HostMaterial*> materials;
 	static inline vector<HostTexture*> textures;
-	static inline vector<HostTriLight*> triLights;
+	static inline vector<int> morphedNodes;			// nodes with modified morph target weights, see UpdateMorphTargets
+	static inline vector<HostTriLight*> triLights;	// dense; addressed by the cores by position, see AddTriLight
+	static inline vector<int> dirtyTriLights;		// handles of tri lights modified since the last light sync, see MarkTriLightDirty
+	static inline bool triLightListChanged = false;	// tri lights were added or removed since the last light sync
 	static inline vector<HostPointLight*> pointLights;
 	static inline vector<HostSpotLight*> spotLights;
 	static inline vector<HostDirectionalLight*> directionalLights;
 	static inline HostSkyDome* sky;
 	static inline Camera* camera;
+	static inline vector<AnimationLOD> animationLOD;	// LOD tiers, by increasing distance; empty: no animation LOD
+	static inline AnimationLOD offscreenAnimationLOD = { 0, 0, false };	// used for animations outside the view frustum
+	static inline float poseQuantization = 1.0f / 1024;	// joint matrix precision for sharing skinned poses between instances
 private:
+	struct StagedScene;
+	static void LoadSceneData( StagedScene& staged, const bool skipExisting );
+	static int CommitSceneData( StagedScene& staged );
+	static inline vector<StagedScene*> stagedScenes;	// asynchronous scene loads, by handle; see AddSceneAsync
+	static inline std::map<uint64_t, int> textureLookup;	// content hash as loaded => texture ID, see FindOrAddTexture
+	static inline std::map<uint64_t, int> materialLookup;	// content hash as loaded => material ID, see FindOrAddMaterial
+	static inline std::map<uint64_t, int> meshLookup;		// content hash => mesh ID, see FindOrAddMesh
+	static inline std::map<pair<string, uint>, int> textureAliases;	// origin and modFlags of merged textures => ID
+	static inline std::map<string, int> materialNameAliases;		// names of merged materials => ID
+	static inline std::map<string, int> materialOriginAliases;		// origins of merged materials => ID
 	static inline int nodeListHoles;	// zero if no instance deletions occurred; adding instances will be faster.
+	static inline vector<int> triLightSlots;		// tri light handle => position in triLights; -1 for unused handles
+	static inline vector<int> freeTriLightHandles;	// recycled tri light handles
+	static inline uint animationFrame = 0;			// frame counter for staggering reduced-rate animation updates
+	struct SkinnedPose
+	{
+		int baseMesh;								// the skinned mesh
+		int mesh;									// mesh holding the posed geometry: baseMesh or a pose copy of it
+		int users;									// number of nodes using this pose
+		uint64_t key;								// hash of baseMesh, the quantized joint matrices and morph weights
+	};
+	static inline vector<SkinnedPose> poseCache;	// skinned poses, see AcquireSkinnedPose
+	static inline std::map<uint64_t, int> poseLookup;	// pose key => position in poseCache
 };
 
 } // namespace lighthouse2
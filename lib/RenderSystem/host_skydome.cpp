@@ -17,23 +17,29 @@
 
 #include <fstream>
 
-#define SKYCDF(x,y) cdf[RadicalInverse8bit( y ) + x * (IBLHEIGHT + 1)] // columns stored sequentially for better cache coherence
-#define COLCDF(x) columncdf[RadicalInverse9bit( x )]
-
-static int RadicalInverse8bit( const int v )
-{
-	int x = ((v & 0xaa) >> 1) | ((v & 0x55) << 1);
-	x = ((x & 0xcc) >> 2) | ((x & 0x33) << 2);
-	x = ((x & 0xf0) >> 4) | ((x & 0x0f) << 4);
-	return x + (1 - (v >> 8)); // so 256 = 0
-}
-
-static int RadicalInverse9bit( const int v )
+// Vose's alias method: table entries for 'n' non-negative weights; all zero weights give a uniform table
+static void BuildAliasTable( const float* weights, const int n, SkyAliasEntry* table )
 {
-	int x = ((v & 0xaa) >> 1) | ((v & 0x55) << 1);
-	x = ((x & 0xcc) >> 2) | ((x & 0x33) << 2);
-	x = ((x & 0xf0) >> 4) | ((x & 0x0f) << 4);
-	return ((x << 1) | ((v >> 8) & 1)) + (1 - (v >> 9)); // so 512 = 0
+	double total = 0;
+	for (int i = 0; i < n; i++) total += weights[i];
+	vector<float> scaled( n );
+	vector<int> small, large;
+	small.reserve( n ), large.reserve( n );
+	for (int i = 0; i < n; i++)
+	{
+		scaled[i] = total > 0 ? (float)(weights[i] * n / total) : 1.0f;
+		table[i].threshold = 1, table[i].alias = i, table[i].pdf = scaled[i], table[i].dummy = 0;
+		if (scaled[i] < 1) small.push_back( i ); else large.push_back( i );
+	}
+	while (small.size() > 0 && large.size() > 0)
+	{
+		const int lo = small.back(), hi = large.back();
+		small.pop_back();
+		table[lo].threshold = scaled[lo], table[lo].alias = hi;
+		scaled[hi] = (scaled[hi] + scaled[lo]) - 1;
+		if (scaled[hi] < 1) large.pop_back(), small.push_back( hi );
+	}
+	// entries left in either list have a probability of (about) 1 due to rounding; they keep their threshold of 1
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -50,9 +56,9 @@ HostSkyDome::HostSkyDome()
 //  +-----------------------------------------------------------------------------+
 HostSkyDome::~HostSkyDome()
 {
-	FREE64( pdf );
-	FREE64( cdf );
-	FREE64( columncdf );
+	FREE64( samplingTable );
+	FREE64( pixels );
+	FREE64( halfPixels );
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -64,7 +70,9 @@ void HostSkyDome::Load( const char* filename, const float3 scale )
 	Timer timer;
 	timer.reset();
 	FREE64( pixels ); // just in case we're reloading
-	pixels = 0;
+	FREE64( halfPixels );
+	FREE64( samplingTable );
+	pixels = 0, halfPixels = 0, samplingTable = 0;
 	// Append ".bin" to the filename:
 #ifndef PATH_MAX
 #define PATH_MAX _MAX_PATH
@@ -87,19 +95,29 @@ void HostSkyDome::Load( const char* filename, const float3 scale )
 	for (int x = 2000; x < 2200; x++) for (int y = 900; y < 1100; y++) pixels[x + y * 5120] = make_float3( 0, 10, 0 );
 	for (int x = 4000; x < 4200; x++) for (int y = 900; y < 1100; y++) pixels[x + y * 5120] = make_float3( 0, 0, 10 );
 #else
-		// attempt to load skydome from binary file
-	std::ifstream f( bin_name, std::ios::binary );
-		if (f)
+	// attempt to load skydome from binary file; mapped, so half precision data is converted straight from the file
+	if (FileExists( bin_name ))
+	{
+		MappedFile cache( bin_name );
+		if (cache.size >= 2 * sizeof( int ))
 		{
-			printf( "loading cached hdr data... " );
-			f.read( (char*)&width, sizeof( width ) );
-			f.read( (char*)&height, sizeof( height ) );
-			// TODO: Mmap
-			pixels = (float3*)MALLOC64( width * height * sizeof( float3 ) );
-			f.read( (char*)pixels, sizeof( float3 ) * width * height );
+			int w, h;
+			memcpy( &w, cache.data, sizeof( int ) ), memcpy( &h, cache.data + sizeof( int ), sizeof( int ) );
+			if (w > 0 && h > 0 && cache.size == 2 * sizeof( int ) + (size_t)w * h * sizeof( float3 ))
+			{
+				printf( "loading cached hdr data... " );
+				width = w, height = h;
+				const float3* src = (const float3*)(cache.data + 2 * sizeof( int ));
+				if (halfPrecision) ConvertToHalf( src, scale ); else
+				{
+					pixels = (float3*)MALLOC64( width * height * sizeof( float3 ) );
+					memcpy( pixels, src, width * height * sizeof( float3 ) );
+				}
+			}
 		}
+	}
 #endif
-	if (!pixels)
+	if (!pixels && !halfPixels)
 	{
 		// load skydome from original .hdr file
 		printf( "loading original hdr data... " );
@@ -132,58 +150,113 @@ void HostSkyDome::Load( const char* filename, const float3 scale )
 				FATALERROR( "Reading a skydome with %dbpp is not implemented!", bpp );
 		}
 		FreeImage_Unload( dib );
-		// save skydome to binary file, .hdr is slow to load
-		std::ofstream f( bin_name, std::ios::binary );
-		f.write( (char*)&width, sizeof( width ) );
-		f.write( (char*)&height, sizeof( height ) );
-		f.write( (char*)pixels, sizeof( float3 ) * width * height );
+		// save skydome to binary file, .hdr is slow to load; written under a temporary name and then
+		// renamed, so an interrupted write never leaves a truncated cache file behind
+		char tmp_name[PATH_MAX + 8];
+		snprintf( tmp_name, sizeof( tmp_name ), "%s.tmp", bin_name );
+		FILE* f;
+#ifdef _MSC_VER
+		fopen_s( &f, tmp_name, "wb" );
+#else
+		f = fopen( tmp_name, "wb" );
+#endif
+		if (f)
+		{
+			bool written = fwrite( &width, sizeof( width ), 1, f ) == 1;
+			written &= fwrite( &height, sizeof( height ), 1, f ) == 1;
+			written &= fwrite( pixels, sizeof( float3 ), (size_t)width * height, f ) == (size_t)width * height;
+			written &= fclose( f ) == 0;
+			if (!written || !RenameFile( tmp_name, bin_name )) remove( tmp_name );
+		}
 	}
 	// Texture is saved to .bin without preprocessing, to allow changing
 	// the scale in the scene description without worrying about this cache
-	if ( scale.x != 1.f || scale.y != 1.f || scale.z != 1.f )
+	if (pixels && (scale.x != 1.f || scale.y != 1.f || scale.z != 1.f))
 		for ( int p = 0; p < width * height; ++p )
 			pixels[p] *= scale;
-#ifdef IBL
-	// convert to pdf
-	// see: https://www.scribd.com/document/134001376/Importance-Sampling-with-Infinite-Area-Light-Source
-	// summarized in: http://cgg.mff.cuni.cz/~jaroslav/teaching/2011-pg3/ibl-writeup.pdf
-	printf( "calculating sky pdf... " );
-	// TODO: Free if not null!
-	// (Better: Refactor "Load" function into RAII)
-	pdf = (float*)MALLOC64( IBLWIDTH * IBLHEIGHT * sizeof( float ) );
-	cdf = (float*)MALLOC64( IBLWIDTH * (IBLHEIGHT + 1) * sizeof( float ) );
-	columncdf = (float*)MALLOC64( (IBLWIDTH + 1) * sizeof( float ) );
-	float stepTheta = (2.0f * PI) / IBLWIDTH;			// theta: -PI...PI
-	float stepPhi = PI / IBLHEIGHT;						// phi:     0...PI
-	for (int p = 0; p < IBLHEIGHT; p++) // loop over rows
-	{
-		float scale = sinf( (float)p * (PI / IBLHEIGHT) );
-		for (int t = 0; t < IBLWIDTH; t++) // loop over columns
-		{
-			// register scaled value
-			int u = max( 0, min( width - 1, (t * width) / IBLWIDTH ) );
-			int v = max( 0, min( height - 1, (p * height) / IBLHEIGHT ) );
-			float3 texel = pixels[u + v * width];
-			// eq. 55, http://www.igorsklyar.com/system/documents/papers/4/fiscourse.comp.pdf
-			float luminance = texel.x * 0.2126f + texel.y * 0.7152f + texel.z * 0.0722f;
-			pdf[t + p * IBLWIDTH] = luminance * scale;
-		}
-	}
-	// calculate cdf
-	float sum = 0;
-	COLCDF( 0 ) = 0;
-	for (int x = 0; x < IBLWIDTH; x++)
+	// store as half precision; halves the memory used by large environment maps
+	if (pixels && halfPrecision)
 	{
-		float columnSum = 0;
-		SKYCDF( x, 0 ) = 0;
-		for (int y = 0; y < IBLHEIGHT; y++) columnSum += pdf[x + y * IBLWIDTH], SKYCDF( x, y + 1 ) = columnSum;
-		sum += columnSum;
-		COLCDF( x + 1 ) = sum;
+		ConvertToHalf( pixels, make_float3( 1 ) );
+		FREE64( pixels );
+		pixels = 0;
 	}
-#endif
+	// the importance sampling table is built when a core asks for it, see GetSamplingTable
 	// done
 	dirty = true;
 	printf( "sky ready in %5.3fs.\n", timer.elapsed() );
 }
 
+//  +-----------------------------------------------------------------------------+
+//  |  HostSkyDome::ConvertToHalf                                                 |
+//  |  Store scaled float3 pixels as RGBA16F, in parallel over blocks of rows.    |
+//  |                                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostSkyDome::ConvertToHalf( const float3* src, const float3 scale )
+{
+	halfPixels = (ushort*)MALLOC64( width * height * 4 * sizeof( ushort ) );
+	const int rowsPerBlock = 64, blocks = (height + rowsPerBlock - 1) / rowsPerBlock;
+	ParallelFor( 0, blocks, [&]( int block ) {
+		vector<float4> row( width );
+		for (int y = block * rowsPerBlock, last = min( height, y + rowsPerBlock ); y < last; y++)
+		{
+			for (int x = 0; x < width; x++) row[x] = make_float4( src[x + y * width] * scale, 1 );
+			FloatToHalf( (float*)row.data(), halfPixels + y * width * 4, width * 4 );
+		}
+	} );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostSkyDome::GetSamplingTable                                              |
+//  |  Importance sampling table for the sky, see SkyAliasEntry. Built on first   |
+//  |  use, so scenes rendered by cores without IBL do not pay for it.      LH2'20|
+//  +-----------------------------------------------------------------------------+
+const SkyAliasEntry* HostSkyDome::GetSamplingTable()
+{
+	if (!samplingTable && (pixels || halfPixels)) BuildSamplingTable();
+	return samplingTable;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostSkyDome::BuildSamplingTable                                            |
+//  |  Each cell of the IBLWIDTH x IBLHEIGHT grid is weighted by the average      |
+//  |  luminance of the pixels it covers, times the sine of the polar angle.      |
+//  |  Rows are processed in parallel; the row sums then yield the marginal       |
+//  |  table, and each row its conditional table.                                 |
+//  |  See: https://www.scribd.com/document/134001376/Importance-Sampling-with-   |
+//  |  Infinite-Area-Light-Source, and Vose, A linear algorithm for generating    |
+//  |  random numbers with a given distribution, 1991.                      LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostSkyDome::BuildSamplingTable()
+{
+	Timer timer;
+	vector<float> cells( IBLWIDTH * IBLHEIGHT ), rowSum( IBLHEIGHT );
+	samplingTable = (SkyAliasEntry*)MALLOC64( (IBLHEIGHT + IBLWIDTH * IBLHEIGHT) * sizeof( SkyAliasEntry ) );
+	ParallelFor( 0, IBLHEIGHT, [&]( int p ) {
+		// source rows and columns covered by this row of cells; at least one
+		const int v0 = (p * height) / IBLHEIGHT, v1 = max( v0 + 1, ((p + 1) * height) / IBLHEIGHT );
+		vector<float4> row( width );
+		float* cell = cells.data() + p * IBLWIDTH;
+		for (int t = 0; t < IBLWIDTH; t++) cell[t] = 0;
+		for (int v = v0; v < v1; v++)
+		{
+			if (halfPixels) HalfToFloat( halfPixels + v * width * 4, (float*)row.data(), width * 4 );
+			else for (int x = 0; x < width; x++) row[x] = make_float4( pixels[x + v * width], 1 );
+			for (int t = 0; t < IBLWIDTH; t++)
+			{
+				const int u0 = (t * width) / IBLWIDTH, u1 = max( u0 + 1, ((t + 1) * width) / IBLWIDTH );
+				// eq. 55, http://www.igorsklyar.com/system/documents/papers/4/fiscourse.comp.pdf
+				for (int u = u0; u < u1; u++) cell[t] += max( 0.0f, row[u].x * 0.2126f + row[u].y * 0.7152f + row[u].z * 0.0722f ) / ((u1 - u0) * (v1 - v0));
+			}
+		}
+		const float scale = sinf( (p + 0.5f) * (PI / IBLHEIGHT) );
+		float sum = 0;
+		for (int t = 0; t < IBLWIDTH; t++) cell[t] *= scale, sum += cell[t];
+		rowSum[p] = sum;
+		BuildAliasTable( cell, IBLWIDTH, samplingTable + IBLHEIGHT + p * IBLWIDTH );
+	} );
+	BuildAliasTable( rowSum.data(), IBLHEIGHT, samplingTable );
+	printf( "sky sampling table ready in %5.3fs.\n", timer.elapsed() );
+}
+
 // EOF
\ No newline at end of file
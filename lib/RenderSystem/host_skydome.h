@@ -30,14 +30,19 @@ public:
 	HostSkyDome();
 	~HostSkyDome();
 	void Load( const char* filename, const float3 scale = {1.f, 1.f, 1.f} );
+	const SkyAliasEntry* GetSamplingTable();
+private:
+	void ConvertToHalf( const float3* src, const float3 scale );
+	void BuildSamplingTable();
+public:
 	// public data members
 	float3* pixels = nullptr;			// HDR texture data for sky dome
+	ushort* halfPixels = nullptr;		// the same data as RGBA16F, replacing 'pixels' if halfPrecision is set
 	int width = 0;						// width of the sky texture
 	int height = 0;						// height of the sky texture
-	float* cdf = nullptr;				// cdf for importance sampling
-	float* pdf = nullptr;				// pdf for importance sampling
-	float* columncdf = nullptr;			// column cdf for importance sampling
+	SkyAliasEntry* samplingTable = nullptr;	// importance sampling table; built on first use, see GetSamplingTable
 	mat4 worldToLight;					// for PBRT scenes; transform for skydome
+	static inline bool halfPrecision = true;	// keep the sky pixels as RGBA16F after loading
 	TRACKCHANGES;						// add Changed(), MarkAsDirty() methods, see system.h
 };
 
@@ -0,0 +1,365 @@
+/* host_streaming.cpp - Copyright 2019/2021 Utrecht University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	   http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "rendersystem.h"
+#include <filesystem>
+
+// helper: the texel buffer of a texture, whatever its storage
+static const void* Texels( const HostTexture* texture )
+{
+	if (texture->bdata) return texture->bdata;
+	if (texture->hdata) return texture->hdata;
+	if (texture->fdata) return texture->fdata;
+	return texture->idata;
+}
+
+// helper: free the texels of a texture object that is about to be deleted
+static void FreeTexels( HostTexture* texture )
+{
+	FREE64( texture->idata ); FREE64( texture->fdata ); FREE64( texture->hdata ); FREE64( texture->bdata );
+	texture->idata = 0, texture->fdata = 0, texture->hdata = 0, texture->bdata = 0;
+}
+
+// helper: can the finest resident level of a texture be dropped
+static bool Droppable( const HostTexture* texture )
+{
+	if (!texture->idata && !texture->hdata && !texture->bdata) return false; // HDR without MIP chain
+	return texture->MIPlevels > 1 && max( texture->width, texture->height ) > TextureStreamer::tailSize;
+}
+
+// helper: approximate memory freed by dropping all levels above the tail
+static size_t Reclaimable( const HostTexture* texture )
+{
+	if (!Droppable( texture )) return 0;
+	uint levels = 0;
+	for (uint size = max( texture->width, texture->height ); size > TextureStreamer::tailSize && levels < texture->MIPlevels - 1; size >>= 1) levels++;
+	const size_t bytes = texture->TexelBytes();
+	return bytes - (bytes >> (2 * levels));
+}
+
+// helper: add the textures referenced by a material to a list
+static void AddMaterialTextures( const HostMaterial* m, vector<int>& IDs )
+{
+	const int maps[] = {
+		m->color.textureID, m->detailColor.textureID, m->normals.textureID, m->detailNormals.textureID, m->absorption.textureID,
+		m->metallic.textureID, m->subsurface.textureID, m->specular.textureID, m->roughness.textureID, m->specularTint.textureID,
+		m->anisotropic.textureID, m->sheen.textureID, m->sheenTint.textureID, m->clearcoat.textureID, m->clearcoatGloss.textureID,
+		m->transmission.textureID, m->eta.textureID, m->reflection.textureID, m->refraction.textureID, m->ior.textureID,
+		m->urough.textureID, m->vrough.textureID, m->Ks.textureID, m->eta_rgb.textureID, m->sigma.textureID, m->specTrans.textureID,
+		m->diffTrans.textureID, m->scatterDistance.textureID, m->flatness.textureID, m->Kr.textureID, m->opacity.textureID
+	};
+	for (const int ID : maps) if (ID > -1 && find( IDs.begin(), IDs.end(), ID ) == IDs.end()) IDs.push_back( ID );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Update                                                    |
+//  |  Adopt the results of background jobs, gather camera feedback and bring     |
+//  |  the texel memory within 'budget' bytes. Returns true if the dimensions of  |
+//  |  any texture changed; the cores take these from the materials.        LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool TextureStreamer::Update( const size_t budget )
+{
+	vector<HostTexture*>& textures = HostScene::textures;
+	const int textureCount = (int)textures.size();
+	state.resize( textureCount );
+	frame++;
+	bool resized = false;
+	// adopt the results of finished background jobs
+	vector<Job> finished;
+	{
+		lock_guard<mutex> guard( lock );
+		finished.swap( done );
+	}
+	for (Job& job : finished)
+	{
+		Residency& r = state[job.textureID];
+		HostTexture* texture = textures[job.textureID];
+		r.pending = false, r.incoming = 0;
+		if (job.spill)
+		{
+			r.spilled = job.succeeded, r.key = job.key, r.spilledData = Texels( texture );
+			continue;
+		}
+		if (!job.succeeded) r.spilled = false; // cache file is gone; keep what we have
+		else if (job.texture->residentLevel < texture->residentLevel)
+		{
+			texture->AdoptTexels( job.texture );
+			r.spilledData = Texels( texture );
+			resized = true;
+		}
+		FreeTexels( job.texture );
+		delete job.texture;
+	}
+	// texels that were replaced since they were spilled, e.g. by Compress, need a new spill
+	for (int i = 0; i < textureCount; i++) if (state[i].spilled && !state[i].pending && state[i].spilledData != Texels( textures[i] )) state[i].spilled = false;
+	Feedback();
+	residentBytes = 0;
+	size_t projected = 0, reclaimable = 0;
+	for (int i = 0; i < textureCount; i++)
+	{
+		const size_t bytes = textures[i]->TexelBytes();
+		residentBytes += bytes, projected += bytes + state[i].incoming;
+		if (state[i].lastUsed != frame && !state[i].pending) reclaimable += Reclaimable( textures[i] );
+	}
+	// restore missing levels of textures that are in use, largest deficit first, as far as the budget allows
+	vector<int> loads;
+	for (int i = 0; i < textureCount; i++)
+	{
+		const Residency& r = state[i];
+		if (r.lastUsed == frame && r.spilled && !r.pending && r.wanted < textures[i]->residentLevel) loads.push_back( i );
+	}
+	sort( loads.begin(), loads.end(), [&]( const int a, const int b ) {
+		return textures[a]->residentLevel - state[a].wanted > textures[b]->residentLevel - state[b].wanted;
+	} );
+	for (const int i : loads)
+	{
+		HostTexture* texture = textures[i];
+		const size_t bytes = texture->TexelBytes();
+		for (uint level = state[i].wanted; level < texture->residentLevel; level++)
+		{
+			// each finer level roughly quadruples the size of the chain
+			const size_t extra = bytes * (((size_t)1 << (2 * (texture->residentLevel - level))) - 1);
+			if (projected + extra > budget + reclaimable) continue;
+			state[i].incoming = extra, projected += extra;
+			Submit( { i, false, level, nullptr, state[i].key, false } );
+			break;
+		}
+	}
+	// over budget: drop the finest level of the least recently used texture; textures in use keep the levels they need.
+	// spills in flight count as dropped already, so one update does not queue a spill for every droppable texture.
+	size_t expected = residentBytes;
+	while (expected > budget)
+	{
+		int victim = -1;
+		size_t victimBytes = 0;
+		for (int i = 0; i < textureCount; i++)
+		{
+			const Residency& r = state[i];
+			HostTexture* texture = textures[i];
+			if (r.pending || !Droppable( texture )) continue;
+			if (r.lastUsed == frame && texture->residentLevel >= r.wanted) continue;
+			if (!r.spilled && texture->residentLevel > 0) continue; // partial chain; cannot be restored
+			const size_t bytes = texture->TexelBytes();
+			if (victim == -1 || r.lastUsed < state[victim].lastUsed || (r.lastUsed == state[victim].lastUsed && bytes > victimBytes))
+				victim = i, victimBytes = bytes;
+		}
+		if (victim == -1) break; // everything in memory is needed, or being spilled; the budget is too small
+		Residency& r = state[victim];
+		HostTexture* texture = textures[victim];
+		if (!r.spilled)
+		{
+			// write the full chain to the cache first; the level is dropped in a later update, saving about 3/4
+			Submit( { victim, true, 0, texture, 0, false } );
+			expected -= min( expected, victimBytes - (victimBytes >> 2) );
+			continue;
+		}
+		texture->DropLevels( 1 );
+		residentBytes -= victimBytes - texture->TexelBytes();
+		expected -= min( expected, victimBytes - texture->TexelBytes() );
+		r.spilledData = Texels( texture );
+		resized = true;
+	}
+	return resized;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Request                                                   |
+//  |  Request a MIP level of a texture for the next update, in addition to the   |
+//  |  camera feedback; e.g. from sampler feedback of a core. Level 0 is the full |
+//  |  resolution of the texture.                                           LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::Request( const int textureID, const uint level )
+{
+	if (textureID < 0) return;
+	requests.push_back( (uint)textureID );
+	requests.push_back( level );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Feedback                                                  |
+//  |  Determine the finest MIP level needed for each texture. For each visible   |
+//  |  instance, the level is the one at which a texel covers about a pixel at    |
+//  |  the nearest point of its bounding sphere, based on the texture coordinate  |
+//  |  density of the mesh. Textures of instances outside the view frustum are    |
+//  |  not marked as used.                                                  LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::Feedback()
+{
+	for (Residency& r : state) r.wanted = 255;
+	for (size_t s = requests.size(), i = 0; i + 1 < s; i += 2) if (requests[i] < state.size())
+	{
+		Residency& r = state[requests[i]];
+		r.wanted = min( r.wanted, requests[i + 1] ), r.lastUsed = frame;
+	}
+	requests.clear();
+	if (!HostScene::camera) return;
+	// gathered mesh data is stale if materials or textures were added
+	if (HostScene::materials.size() != knownMaterials || HostScene::textures.size() != knownTextures) meshInfo.clear();
+	knownMaterials = HostScene::materials.size(), knownTextures = HostScene::textures.size();
+	meshInfo.resize( HostScene::meshPool.size() );
+	// frustum planes (normals pointing inwards) from the view pyramid
+	const ViewPyramid view = HostScene::camera->GetView();
+	const float3 p4 = view.p2 + view.p3 - view.p1, C = (view.p2 + view.p3) * 0.5f;
+	const float3 corner[5] = { view.p1, view.p2, p4, view.p3, view.p1 };
+	float4 planes[5];
+	for (int i = 0; i < 4; i++)
+	{
+		float3 N = normalize( cross( corner[i] - view.pos, corner[i + 1] - view.pos ) );
+		if (dot( N, C - view.pos ) < 0) N *= -1.0f;
+		planes[i] = make_float4( N, -dot( N, view.pos ) );
+	}
+	const float3 forward = normalize( C - view.pos );
+	planes[4] = make_float4( forward, -dot( forward, view.pos ) );
+	// visit the instances
+	for (HostNode* node : HostScene::nodePool) if (node && node->meshID > -1)
+	{
+		UpdateMeshInfo( node->meshID );
+		const MeshInfo& info = meshInfo[node->meshID];
+		if (info.textures.size() == 0) continue;
+		const mat4& T = node->combinedTransform;
+		const float scale = max( length( make_float3( T.cell[0], T.cell[4], T.cell[8] ) ), max( length( make_float3( T.cell[1], T.cell[5], T.cell[9] ) ), length( make_float3( T.cell[2], T.cell[6], T.cell[10] ) ) ) );
+		const float3 center = make_float3( T * make_float4( info.center, 1 ) );
+		const float radius = info.radius * scale;
+		bool visible = true;
+		for (int i = 0; i < 5 && visible; i++) visible = dot( make_float3( planes[i] ), center ) + planes[i].w >= -radius;
+		if (!visible) continue;
+		// texture coordinate units covered by a pixel
+		const float distance = max( 1e-4f, length( center - view.pos ) - radius );
+		const float footprint = distance * view.spreadAngle * info.uvDensity / max( 1e-10f, scale );
+		for (const int ID : info.textures) if (ID < (int)state.size())
+		{
+			const HostTexture* texture = HostScene::textures[ID];
+			const float texels = footprint * (float)(max( texture->width, texture->height ) << texture->residentLevel);
+			const float level = log2f( max( 1.0f, texels ) ) + lodBias;
+			Residency& r = state[ID];
+			r.wanted = min( r.wanted, (uint)max( 0.0f, level ) ), r.lastUsed = frame;
+		}
+	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::UpdateMeshInfo                                            |
+//  |  Gather the bounds, texture coordinate density and textures of a mesh.      |
+//  |  The density is the square root of the ratio of the total uv area and the   |
+//  |  total surface area of the triangles.                                 LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::UpdateMeshInfo( const int meshID )
+{
+	const HostMesh* mesh = HostScene::meshPool[meshID];
+	MeshInfo& info = meshInfo[meshID];
+	const int triCount = (int)mesh->triangles.size();
+	if (info.triCount == triCount) return;
+	info.triCount = triCount, info.textures.clear();
+	if (triCount == 0) return;
+	float3 bmin = make_float3( 1e34f ), bmax = make_float3( -1e34f );
+	float area = 0, uvArea = 0;
+	vector<bool> seen( HostScene::materials.size(), false );
+	for (const HostTri& tri : mesh->triangles)
+	{
+		bmin = fminf( bmin, fminf( tri.vertex0, fminf( tri.vertex1, tri.vertex2 ) ) );
+		bmax = fmaxf( bmax, fmaxf( tri.vertex0, fmaxf( tri.vertex1, tri.vertex2 ) ) );
+		area += length( cross( tri.vertex1 - tri.vertex0, tri.vertex2 - tri.vertex0 ) );
+		uvArea += fabs( (tri.u1 - tri.u0) * (tri.v2 - tri.v0) - (tri.u2 - tri.u0) * (tri.v1 - tri.v0) );
+		if (tri.material >= (uint)seen.size() || seen[tri.material]) continue;
+		seen[tri.material] = true;
+		AddMaterialTextures( HostScene::materials[tri.material], info.textures );
+	}
+	info.center = (bmin + bmax) * 0.5f, info.radius = length( bmax - bmin ) * 0.5f;
+	info.uvDensity = area > 0 ? sqrtf( uvArea / area ) : 0;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Submit                                                    |
+//  |  Queue a job for the background thread, which is started on first use.      |
+//  |                                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::Submit( const Job& job )
+{
+	state[job.textureID].pending = true;
+	lock_guard<mutex> guard( lock );
+	if (!worker.joinable()) worker = thread( &TextureStreamer::Worker, this );
+	todo.push_back( job );
+	wake.notify_one();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Worker                                                    |
+//  |  Background thread: write full MIP chains to the cache, and load them back, |
+//  |  decoding only the requested levels. Results are adopted by Update. The     |
+//  |  scene texture of a pending job is not modified by the streamer.      LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::Worker()
+{
+	while (1)
+	{
+		Job job;
+		{
+			unique_lock<mutex> guard( lock );
+			wake.wait( guard, [this]() { return stopping || todo.size() > 0; } );
+			if (stopping) return;
+			job = todo.front();
+			todo.pop_front();
+		}
+		if (job.spill)
+		{
+			// file names are content hashes, so an existing file holds these texels
+			job.key = job.texture->ContentHash();
+			const string file = CacheFile( job.key );
+			if (!FileExists( file.c_str() )) job.texture->SaveToCache( file.c_str(), job.key );
+			job.succeeded = FileExists( file.c_str() );
+		}
+		else
+		{
+			HostTexture* loaded = new HostTexture();
+			job.succeeded = loaded->LoadFromCache( CacheFile( job.key ).c_str(), job.key, job.level );
+			job.texture = loaded;
+		}
+		lock_guard<mutex> guard( lock );
+		done.push_back( job );
+	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::CacheFile                                                 |
+//  |  Name of the cache file for the texels with the specified hash. Also used   |
+//  |  for textures released after upload, see HostTexture::Release.        LH2'20|
+//  +-----------------------------------------------------------------------------+
+string TextureStreamer::CacheFile( const uint64_t key )
+{
+	char name[64];
+	snprintf( name, sizeof( name ), "lh2tex_%016llx.bin", (unsigned long long)key );
+	const filesystem::path folder = cacheFolder.empty() ? filesystem::temp_directory_path() : filesystem::path( cacheFolder );
+	return (folder / name).string();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer::Shutdown                                                  |
+//  |  Stop the background thread and discard unfinished jobs.              LH2'20|
+//  +-----------------------------------------------------------------------------+
+void TextureStreamer::Shutdown()
+{
+	{
+		lock_guard<mutex> guard( lock );
+		stopping = true;
+	}
+	wake.notify_all();
+	if (worker.joinable()) worker.join();
+	for (Job& job : done) if (!job.spill) FreeTexels( job.texture ), delete job.texture;
+	for (Residency& r : state) r.pending = false, r.incoming = 0;
+	todo.clear(), done.clear();
+	stopping = false;
+}
+
+// EOF
@@ -0,0 +1,105 @@
+/* host_streaming.h - Copyright 2019/2021 Utrecht University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+	   http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace lighthouse2
+{
+
+//  +-----------------------------------------------------------------------------+
+//  |  TextureStreamer                                                            |
+//  |  Keeps the texels of the scene within a memory budget. Each texture holds   |
+//  |  a partial MIP chain, starting at HostTexture::residentLevel:               |
+//  |  - Every update, the camera determines the finest level each texture needs  |
+//  |    (distance, texel density of the meshes that use it); applications may    |
+//  |    add requests, e.g. based on sampler feedback.                            |
+//  |  - Over budget, fine levels are dropped, least recently used first.         |
+//  |  - Dropped levels are restored by a background thread, from a cache file    |
+//  |    to which the full chain was written before the first eviction.           |
+//  |  Changed texture dimensions are picked up by the regular texture sync.      |
+//  |                                                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+class TextureStreamer
+{
+public:
+	// constructor / destructor
+	TextureStreamer() = default;
+	~TextureStreamer() { Shutdown(); }
+	// methods
+	bool Update( const size_t budget );
+	void Request( const int textureID, const uint level );
+	bool Pending( const int textureID ) const { return textureID < (int)state.size() && state[textureID].pending; }
+	size_t ResidentBytes() const { return residentBytes; }
+	void Shutdown();
+	static string CacheFile( const uint64_t key );
+	// settings
+	static inline uint tailSize = 64;			// levels of this size and smaller are never evicted
+	static inline float lodBias = 0;			// added to the estimated MIP level; positive values save memory
+	static inline string cacheFolder;			// folder for the evicted texels; empty: system temp folder
+private:
+	struct Residency
+	{
+		uint wanted = 0;						// finest level needed this frame
+		uint lastUsed = 0;						// frame in which the texture was last needed
+		bool pending = false;					// a background job is operating on the texture
+		bool spilled = false;					// the full chain is in the cache file
+		const void* spilledData = nullptr;		// texel pointer at the time of the spill; a change invalidates it
+		uint64_t key = 0;						// content hash of the full chain
+		size_t incoming = 0;					// bytes that a pending load will add
+	};
+	struct MeshInfo
+	{
+		int triCount = -1;						// triangle count when this was gathered; -1: not gathered yet
+		float3 center;							// bounding sphere, object space
+		float radius;
+		float uvDensity;						// texture coordinate units per world unit
+		vector<int> textures;					// textures used by the materials of the mesh
+	};
+	struct Job
+	{
+		int textureID;
+		bool spill;								// write the full chain to the cache file; otherwise: load it
+		uint level;								// load: finest level to keep
+		HostTexture* texture;					// spill: the scene texture; load: the loaded texels
+		uint64_t key;
+		bool succeeded;
+	};
+	void Feedback();
+	void UpdateMeshInfo( const int meshID );
+	void Worker();
+	void Submit( const Job& job );
+	// data members
+	vector<Residency> state;					// per texture
+	vector<MeshInfo> meshInfo;					// per mesh
+	size_t knownMaterials = 0, knownTextures = 0;	// scene contents when meshInfo was gathered
+	vector<uint> requests;						// pairs of texture ID and level, from Request
+	uint frame = 0;								// update counter, for LRU eviction
+	size_t residentBytes = 0;					// texel bytes in memory after the last update
+	// background thread
+	thread worker;
+	mutex lock;
+	condition_variable wake;
+	deque<Job> todo;
+	vector<Job> done;
+	bool stopping = false;
+};
+
+} // namespace lighthouse2
+
+// EOF
@@ -14,11 +14,7 @@
 */
 
 #include "rendersystem.h"
-
-// Local hack:
-#ifndef _MSC_VER
-#define strcat_s strcat
-#endif
+#include <zlib.h>
 
 //  +-----------------------------------------------------------------------------+
 //  |  HostTexture::HostTexture                                                   |
@@ -46,37 +42,99 @@ CoreTexDesc HostTexture::ConvertToCoreTexDesc() const
 	gpuTex.width = width;
 	gpuTex.height = height;
 	gpuTex.flags = flags;
-	assert( (fdata != 0) | (idata != 0) );
-	if (fdata)
+	assert( Released() || (fdata != 0) | (idata != 0) | (hdata != 0) | (bdata != 0) );
+	gpuTex.bdata = (uchar*)TexelData(); // null for released textures, which keep their layout
+	if (Released()) gpuTex.storage = releasedStorage;
+	else if (bdata) gpuTex.storage = blockFormat;
+	else if (hdata) gpuTex.storage = TexelStorage::ARGB64;
+	else if (fdata) gpuTex.storage = TexelStorage::ARGB128;
+	else if (flags & NORMALMAP) gpuTex.storage = TexelStorage::NRM32;
+	/* else gpuTex.storage = TexelStorage::ARGB32; default */
+	if (gpuTex.storage == TexelStorage::ARGB128)
 	{
-		gpuTex.fdata = fdata;
-		gpuTex.storage = TexelStorage::ARGB128;
 		gpuTex.pixelCount = PixelsNeeded( width, height, 1 );
 		gpuTex.MIPlevels = 1;
 		assert( (flags & NORMALMAP) == 0 );
 	}
 	else
 	{
-		gpuTex.idata = idata;
-		if (flags & NORMALMAP) gpuTex.storage = TexelStorage::NRM32;
-		/* else gpuTex.storage = TexelStorage::ARGB32; default */
-		gpuTex.pixelCount = PixelsNeeded( width, height, MIPLEVELCOUNT );
-		gpuTex.MIPlevels = MIPLEVELCOUNT;
+		gpuTex.pixelCount = PixelsNeeded( width, height, MIPlevels );
+		gpuTex.MIPlevels = MIPlevels;
 	}
 	return gpuTex;
 }
 
+// texel conversion helpers
+namespace {
+
+// lookup tables for converting texel bytes to float and back
+struct TexelTables
+{
+	enum { CURVESTEPS = 4096 };
+	float toLinear[256];		// sRGB byte to linear float
+	float toFloat[256];			// byte to float
+	uchar toLinearByte[256];	// sRGB byte to linear byte
+	uchar toSRGB[65536];		// linear float, 16 bit fixed point, to sRGB byte
+	float curve[CURVESTEPS + 2];	// sRGB to linear on [0..1], for linear interpolation
+	TexelTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			toLinear[i] = HostTexture::InverseGammaCorrect( i / 255.0f ), toFloat[i] = i / 255.0f;
+			toLinearByte[i] = (uchar)clamp( toLinear[i] * 255.0f, 0.0f, 255.0f );
+		}
+		for (int i = 0; i < 65536; i++)
+		{
+			const float v = i / 65535.0f, e = v <= 0.0031308f ? v * 12.92f : 1.055f * powf( v, 1 / 2.4f ) - 0.055f;
+			toSRGB[i] = (uchar)min( 255.0f, e * 255 + 0.5f );
+		}
+		for (int i = 0; i <= CURVESTEPS; i++) curve[i] = HostTexture::InverseGammaCorrect( (float)i / CURVESTEPS );
+		curve[CURVESTEPS + 1] = curve[CURVESTEPS];
+	}
+	static const TexelTables& Get() { static TexelTables tables; return tables; }
+};
+
+// FreeImage 32-bit scanline (usually BGRA) to RGBA, four texels at a time; SSSE3, so it also runs on AVX-only CPUs
+void ConvertRowRGBA8( const uchar* src, uchar4* dst, const uint count )
+{
+	const __m128i order = _mm_setr_epi8(
+		FI_RGBA_RED, FI_RGBA_GREEN, FI_RGBA_BLUE, FI_RGBA_ALPHA, FI_RGBA_RED + 4, FI_RGBA_GREEN + 4, FI_RGBA_BLUE + 4, FI_RGBA_ALPHA + 4,
+		FI_RGBA_RED + 8, FI_RGBA_GREEN + 8, FI_RGBA_BLUE + 8, FI_RGBA_ALPHA + 8, FI_RGBA_RED + 12, FI_RGBA_GREEN + 12, FI_RGBA_BLUE + 12, FI_RGBA_ALPHA + 12 );
+	uint x = 0;
+	for (; x + 4 <= count; x += 4)
+		_mm_storeu_si128( (__m128i*)(dst + x), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(src + x * 4) ), order ) );
+	for (; x < count; x++)
+	{
+		const uchar* pixel = src + x * 4;
+		dst[x] = make_uchar4( pixel[FI_RGBA_RED], pixel[FI_RGBA_GREEN], pixel[FI_RGBA_BLUE], pixel[FI_RGBA_ALPHA] );
+	}
+}
+
+// FreeImage 96-bit RGB float scanline to RGBA, alpha set to 1
+void ConvertRowRGBF( const float* src, float4* dst, const uint count )
+{
+	if (count == 0) return;
+	const __m128 one = _mm_set1_ps( 1.0f );
+	// a four-float load at the last texel would read past the scanline
+	for (uint x = 0; x < count - 1; x++) _mm_storeu_ps( (float*)(dst + x), _mm_blend_ps( _mm_loadu_ps( src + x * 3 ), one, 8 ) );
+	const float* last = src + (count - 1) * 3;
+	dst[count - 1] = make_float4( last[0], last[1], last[2], 1.0f );
+}
+
+} // namespace
+
 //  +-----------------------------------------------------------------------------+
 //  |  HostTexture::sRGBtoLinear                                                  |
-//  |  Convert sRGB data to linear color space.                             LH2'19|
+//  |  Convert sRGB data to linear color space. Table-driven; alpha (when the     |
+//  |  stride allows for it) is left alone.                                 LH2'20|
 //  +-----------------------------------------------------------------------------+
 void HostTexture::sRGBtoLinear( uchar* pixels, const uint size, const uint stride )
 {
+	const uchar* lut = TexelTables::Get().toLinearByte;
 	for (uint j = 0; j < size; j++)
 	{
-		pixels[j * stride + 0] = (pixels[j * stride + 0] * pixels[j * stride + 0]) >> 8;
-		pixels[j * stride + 1] = (pixels[j * stride + 1] * pixels[j * stride + 1]) >> 8;
-		pixels[j * stride + 2] = (pixels[j * stride + 2] * pixels[j * stride + 2]) >> 8;
+		uchar* p = pixels + j * stride;
+		p[0] = lut[p[0]], p[1] = lut[p[1]], p[2] = lut[p[2]];
 	}
 }
 
@@ -96,6 +154,19 @@ float4 HostTexture::InverseGammaCorrect( const float4& color )
 		InverseGammaCorrect( color.y ),
 		InverseGammaCorrect( color.z ), color.w );
 }
+void HostTexture::InverseGammaCorrect( float4* pixels, const uint count )
+{
+	// interpolated table on [0..1]; exact (and slow) outside, e.g. for HDR highlights
+	const TexelTables& T = TexelTables::Get();
+	const auto convert = [&T]( const float v ) {
+		if (!(v >= 0 && v <= 1)) return InverseGammaCorrect( v );
+		const float f = v * TexelTables::CURVESTEPS;
+		const int i = (int)f;
+		return T.curve[i] + (T.curve[i + 1] - T.curve[i]) * (f - i);
+	};
+	for (uint i = 0; i < count; i++)
+		pixels[i] = make_float4( convert( pixels[i].x ), convert( pixels[i].y ), convert( pixels[i].z ), pixels[i].w );
+}
 
 //  +-----------------------------------------------------------------------------+
 //  |  HostTexture::Equals                                                        |
@@ -117,37 +188,424 @@ bool HostTexture::Equals( const string& o, const uint m )
 int HostTexture::PixelsNeeded( const int width, const int height, const int MIPlevels /* >= 1; includes base layer */ ) const
 {
 	int w = width, h = height, needed = 0;
-	for (int i = 0; i < MIPlevels; i++) needed += w * h, w >>= 1, h >>= 1;
+	for (int i = 0; i < MIPlevels; i++) needed += w * h, w = max( 1, w >> 1 ), h = max( 1, h >> 1 );
 	return needed;
 }
 
 //  +-----------------------------------------------------------------------------+
-//  |  HostTexture::ConstructMIPmaps                                              |
-//  |  Generate MIP levels for a loaded texture.                            LH2'19|
+//  |  HostTexture::BlockBytesNeeded                                              |
+//  |  As PixelsNeeded, for block compressed data, in bytes.                LH2'20|
 //  +-----------------------------------------------------------------------------+
-void HostTexture::ConstructMIPmaps()
+size_t HostTexture::BlockBytesNeeded( const uint width, const uint height, const uint MIPlevels, const TexelStorage format )
 {
-	uint* src = (uint*)idata;
-	uint* dst = src + width * height;
-	int pw = width, w = width >> 1, ph = height, h = height >> 1;
-	for (int i = 1; i < MIPLEVELCOUNT; i++)
+	size_t needed = 0;
+	for (uint i = 0, w = width, h = height; i < MIPlevels; i++) needed += BCLevelBytes( w, h, format ), w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+	return needed;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::MIPlevelsNeeded                                               |
+//  |  Number of levels in a full MIP chain, down to 1x1.                   LH2'20|
+//  +-----------------------------------------------------------------------------+
+uint HostTexture::MIPlevelsNeeded( const uint width, const uint height )
+{
+	uint levels = 1;
+	for (uint size = max( width, height ); size > 1; size >>= 1) levels++;
+	return levels;
+}
+
+// MIP construction helpers
+namespace {
+
+// filter taps for one axis: for each destination texel, 'taps' source indices and weights
+struct MIPTaps
+{
+	int taps = 0;
+	vector<int> index;			// source texel per tap; clamped to the edge
+	vector<float> weight;		// zero for unused taps
+	vector<int> boxFirst, boxLast;	// source texels covered by the destination texel; for alpha
+};
+
+float Sinc( const float x ) { return fabsf( x ) < 1e-5f ? 1 : sinf( PI * x ) / (PI * x); }
+float BesselI0( const float x )
+{
+	float sum = 1, term = 1;
+	for (int k = 1; k < 16; k++) term *= (x * x) / (4.0f * k * k), sum += term;
+	return sum;
+}
+float MIPKernel( const int filter, const float x )
+{
+	if (filter == HostTexture::MIP_LANCZOS) return fabsf( x ) < 3 ? Sinc( x ) * Sinc( x / 3 ) : 0;
+	// Kaiser window, radius 3, alpha 4
+	const float r = x / 3;
+	return fabsf( r ) < 1 ? Sinc( x ) * BesselI0( 4 * sqrtf( 1 - r * r ) ) / BesselI0( 4 ) : 0;
+}
+
+void BuildMIPTaps( MIPTaps& t, const int srcSize, const int dstSize, const int filter )
+{
+	const float scale = (float)srcSize / dstSize;
+	const float radius = filter == HostTexture::MIP_BOX ? 0 : 3 * scale;
+	t.taps = filter == HostTexture::MIP_BOX ? (int)ceilf( scale ) + 1 : (int)ceilf( 2 * radius ) + 1;
+	t.index.assign( dstSize * t.taps, 0 );
+	t.weight.assign( dstSize * t.taps, 0 );
+	t.boxFirst.resize( dstSize ), t.boxLast.resize( dstSize );
+	for (int i = 0; i < dstSize; i++)
 	{
-		// reduce
-		for (int y = 0; y < h; y++) for (int x = 0; x < w; x++)
+		// footprint of the destination texel in the source level
+		const float a = i * scale, b = (i + 1) * scale, center = (a + b) * 0.5f;
+		t.boxFirst[i] = (int)a, t.boxLast[i] = min( srcSize - 1, (int)ceilf( b ) - 1 );
+		const int first = filter == HostTexture::MIP_BOX ? t.boxFirst[i] : (int)floorf( center - radius );
+		float sum = 0;
+		for (int j = 0; j < t.taps; j++)
+		{
+			const int s = first + j;
+			float w;
+			if (filter == HostTexture::MIP_BOX) w = max( 0.0f, min( b, s + 1.0f ) - max( a, (float)s ) );
+			else w = MIPKernel( filter, (s + 0.5f - center) / scale );
+			t.index[i * t.taps + j] = clamp( s, 0, srcSize - 1 );
+			t.weight[i * t.taps + j] = w, sum += w;
+		}
+		for (int j = 0; j < t.taps; j++) t.weight[i * t.taps + j] /= sum;
+	}
+}
+
+// fast path: 2x2 box filter for even sizes, in gamma space, four destination texels at a time
+void ReduceBox2x2( const uint* src, const int pw, uint* dst, const int w, const int h )
+{
+	const __m128i alphaMask = _mm_set1_epi32( 0xff000000 ), zero = _mm_setzero_si128();
+	for (int y = 0; y < h; y++)
+	{
+		const uint* row0 = src + y * 2 * pw, * row1 = row0 + pw;
+		uint* out = dst + y * w;
+		int x = 0;
+		for (; x + 4 <= w; x += 4)
+		{
+			const __m128 a0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(row0 + x * 2) ) );
+			const __m128 a1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(row0 + x * 2 + 4) ) );
+			const __m128 b0 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(row1 + x * 2) ) );
+			const __m128 b1 = _mm_castsi128_ps( _mm_loadu_si128( (const __m128i*)(row1 + x * 2 + 4) ) );
+			// separate even and odd source texels; lane i then holds the texels of destination texel i
+			const __m128i e0 = _mm_castps_si128( _mm_shuffle_ps( a0, a1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+			const __m128i o0 = _mm_castps_si128( _mm_shuffle_ps( a0, a1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+			const __m128i e1 = _mm_castps_si128( _mm_shuffle_ps( b0, b1, _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+			const __m128i o1 = _mm_castps_si128( _mm_shuffle_ps( b0, b1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+			// sum color channels in 16 bit, divide by 4
+			__m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( e0, zero ), _mm_unpacklo_epi8( o0, zero ) );
+			__m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( e0, zero ), _mm_unpackhi_epi8( o0, zero ) );
+			lo = _mm_add_epi16( lo, _mm_add_epi16( _mm_unpacklo_epi8( e1, zero ), _mm_unpacklo_epi8( o1, zero ) ) );
+			hi = _mm_add_epi16( hi, _mm_add_epi16( _mm_unpackhi_epi8( e1, zero ), _mm_unpackhi_epi8( o1, zero ) ) );
+			const __m128i color = _mm_packus_epi16( _mm_srli_epi16( lo, 2 ), _mm_srli_epi16( hi, 2 ) );
+			// alpha is the minimum of the four texels
+			const __m128i alpha = _mm_min_epu8( _mm_min_epu8( e0, o0 ), _mm_min_epu8( e1, o1 ) );
+			_mm_storeu_si128( (__m128i*)(out + x), _mm_or_si128( _mm_andnot_si128( alphaMask, color ), _mm_and_si128( alphaMask, alpha ) ) );
+		}
+		for (; x < w; x++)
 		{
-			const uint src0 = src[x * 2 + (y * 2) * pw];
-			const uint src1 = src[x * 2 + 1 + (y * 2) * pw];
-			const uint src2 = src[x * 2 + (y * 2 + 1) * pw];
-			const uint src3 = src[x * 2 + 1 + (y * 2 + 1) * pw];
+			const uint src0 = row0[x * 2], src1 = row0[x * 2 + 1], src2 = row1[x * 2], src3 = row1[x * 2 + 1];
 			const uint a = min( min( (src0 >> 24) & 255, (src1 >> 24) & 255 ), min( (src2 >> 24) & 255, (src3 >> 24) & 255 ) );
 			const uint r = ((src0 >> 16) & 255) + ((src1 >> 16) & 255) + ((src2 >> 16) & 255) + ((src3 >> 16) & 255);
 			const uint g = ((src0 >> 8) & 255) + ((src1 >> 8) & 255) + ((src2 >> 8) & 255) + ((src3 >> 8) & 255);
 			const uint b = (src0 & 255) + (src1 & 255) + (src2 & 255) + (src3 & 255);
-			dst[x + y * w] = (a << 24) + ((r >> 2) << 16) + ((g >> 2) << 8) + (b >> 2);
+			out[x] = (a << 24) + ((r >> 2) << 16) + ((g >> 2) << 8) + (b >> 2);
+		}
+	}
+}
+
+// general path: separable resampling in float, for any size ratio and filter, optionally in linear space
+void Resample( const uint* src, const int pw, const int ph, uint* dst, const int w, const int h, const int filter, const bool sRGB )
+{
+	const TexelTables& T = TexelTables::Get();
+	const float* decode = sRGB ? T.toLinear : T.toFloat;
+	MIPTaps tx, ty;
+	BuildMIPTaps( tx, pw, w, filter );
+	BuildMIPTaps( ty, ph, h, filter );
+	vector<float> acc( w * 4 );
+	for (int y = 0; y < h; y++)
+	{
+		memset( acc.data(), 0, w * 4 * sizeof( float ) );
+		for (int j = 0; j < ty.taps; j++)
+		{
+			const float wy = ty.weight[y * ty.taps + j];
+			if (wy == 0) continue;
+			const uint* row = src + ty.index[y * ty.taps + j] * pw;
+			const __m128 wy4 = _mm_set1_ps( wy );
+			for (int x = 0; x < w; x++)
+			{
+				__m128 sum = _mm_setzero_ps();
+				const int* idx = &tx.index[x * tx.taps];
+				const float* wx = &tx.weight[x * tx.taps];
+				for (int i = 0; i < tx.taps; i++)
+				{
+					const uint p = row[idx[i]];
+					const __m128 texel = _mm_set_ps( T.toFloat[p >> 24], decode[(p >> 16) & 255], decode[(p >> 8) & 255], decode[p & 255] );
+					sum = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( wx[i] ), texel ), sum );
+				}
+				_mm_storeu_ps( &acc[x * 4], _mm_add_ps( _mm_mul_ps( wy4, sum ), _mm_loadu_ps( &acc[x * 4] ) ) );
+			}
+		}
+		// encode; alpha is the minimum over the box footprint, as in the 2x2 filter
+		const __m128 zero4 = _mm_setzero_ps(), one4 = _mm_set1_ps( 1 );
+		for (int x = 0; x < w; x++)
+		{
+			float c[4];
+			_mm_storeu_ps( c, _mm_min_ps( one4, _mm_max_ps( zero4, _mm_loadu_ps( &acc[x * 4] ) ) ) );
+			uint a = 255;
+			for (int v = ty.boxFirst[y]; v <= ty.boxLast[y]; v++) for (int u = tx.boxFirst[x]; u <= tx.boxLast[x]; u++)
+				a = min( a, src[u + v * pw] >> 24 );
+			uint b, g, r;
+			if (sRGB) b = T.toSRGB[(int)(c[0] * 65535 + 0.5f)], g = T.toSRGB[(int)(c[1] * 65535 + 0.5f)], r = T.toSRGB[(int)(c[2] * 65535 + 0.5f)];
+			else b = (uint)(c[0] * 255 + 0.5f), g = (uint)(c[1] * 255 + 0.5f), r = (uint)(c[2] * 255 + 0.5f);
+			dst[x + y * w] = (a << 24) + (r << 16) + (g << 8) + b;
+		}
+	}
+}
+
+// resample a HDR level; as Resample, in full precision and without the alpha rule
+void ResampleHDR( const float4* src, const int pw, const int ph, float4* dst, const int w, const int h, const int filter )
+{
+	MIPTaps tx, ty;
+	BuildMIPTaps( tx, pw, w, filter );
+	BuildMIPTaps( ty, ph, h, filter );
+	const __m128 zero4 = _mm_setzero_ps();
+	for (int y = 0; y < h; y++)
+	{
+		__m128* out = (__m128*)(dst + y * w);
+		for (int x = 0; x < w; x++) out[x] = zero4;
+		for (int j = 0; j < ty.taps; j++)
+		{
+			const float wy = ty.weight[y * ty.taps + j];
+			if (wy == 0) continue;
+			const float4* row = src + ty.index[y * ty.taps + j] * pw;
+			const __m128 wy4 = _mm_set1_ps( wy );
+			for (int x = 0; x < w; x++)
+			{
+				__m128 sum = zero4;
+				const int* idx = &tx.index[x * tx.taps];
+				const float* wx = &tx.weight[x * tx.taps];
+				for (int i = 0; i < tx.taps; i++) sum = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( wx[i] ), _mm_loadu_ps( (const float*)(row + idx[i]) ) ), sum );
+				out[x] = _mm_add_ps( _mm_mul_ps( wy4, sum ), out[x] );
+			}
+		}
+		// the Kaiser and Lanczos filters ring; no negative radiance
+		for (int x = 0; x < w; x++) out[x] = _mm_max_ps( zero4, out[x] );
+	}
+}
+
+} // namespace
+
+// block compression helpers; the decoder is in common_bcn.h
+namespace {
+
+// principal axis of a set of points, by power iteration on the covariance matrix
+template <int N> void PrincipalAxis( const float p[16][4], float mean[4], float axis[4] )
+{
+	for (int c = 0; c < N; c++) { mean[c] = 0; for (int i = 0; i < 16; i++) mean[c] += p[i][c] * (1.0f / 16); }
+	float cov[N][N] = {};
+	for (int i = 0; i < 16; i++) for (int a = 0; a < N; a++) for (int b = 0; b < N; b++) cov[a][b] += (p[i][a] - mean[a]) * (p[i][b] - mean[b]);
+	for (int c = 0; c < N; c++) axis[c] = 1;
+	for (int iter = 0; iter < 8; iter++)
+	{
+		float next[N] = {}, len = 0;
+		for (int a = 0; a < N; a++) for (int b = 0; b < N; b++) next[a] += cov[a][b] * axis[b];
+		for (int c = 0; c < N; c++) len = max( len, fabsf( next[c] ) );
+		if (len < 1e-6f) break; // flat block; keep the previous axis
+		for (int c = 0; c < N; c++) axis[c] = next[c] / len;
+	}
+}
+
+// endpoints: the extremes of the block along its principal axis
+template <int N> void FitLine( const float p[16][4], float lo[4], float hi[4] )
+{
+	float mean[4], axis[4];
+	PrincipalAxis<N>( p, mean, axis );
+	float tmin = 1e30f, tmax = -1e30f, len2 = 0;
+	for (int c = 0; c < N; c++) len2 += axis[c] * axis[c];
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0;
+		for (int c = 0; c < N; c++) t += (p[i][c] - mean[c]) * axis[c];
+		tmin = min( tmin, t / len2 ), tmax = max( tmax, t / len2 );
+	}
+	for (int c = 0; c < N; c++) lo[c] = clamp( mean[c] + axis[c] * tmin, 0.0f, 255.0f ), hi[c] = clamp( mean[c] + axis[c] * tmax, 0.0f, 255.0f );
+}
+
+uint Pack565( const float c[4] )
+{
+	return ((uint)(c[0] * (31.0f / 255) + 0.5f) << 11) + ((uint)(c[1] * (63.0f / 255) + 0.5f) << 5) + (uint)(c[2] * (31.0f / 255) + 0.5f);
+}
+
+// BC1 color block, always in 4-color mode; the alpha of 'texels' is ignored
+void EncodeBC1Colors( const uint texels[16], uchar* out )
+{
+	float p[16][4], lo[4], hi[4];
+	for (int i = 0; i < 16; i++) for (int c = 0; c < 3; c++) p[i][c] = (float)((texels[i] >> (8 * c)) & 255);
+	FitLine<3>( p, lo, hi );
+	uint c0 = Pack565( hi ), c1 = Pack565( lo );
+	if (c0 < c1) Swap( c0, c1 );
+	out[0] = c0 & 255, out[1] = c0 >> 8, out[2] = c1 & 255, out[3] = c1 >> 8;
+	uint palette[4], indices = 0;
+	BC1Palette( out, palette, true );
+	if (c0 != c1) for (int i = 0; i < 16; i++)
+	{
+		int best = 0, bestDist = INT_MAX;
+		for (int j = 0; j < 4; j++)
+		{
+			int dist = 0;
+			for (int c = 0; c < 3; c++) dist += sqr( (int)((texels[i] >> (8 * c)) & 255) - (int)((palette[j] >> (8 * c)) & 255) );
+			if (dist < bestDist) bestDist = dist, best = j;
+		}
+		indices |= best << (2 * i);
+	}
+	out[4] = indices & 255, out[5] = (indices >> 8) & 255, out[6] = (indices >> 16) & 255, out[7] = indices >> 24;
+}
+
+// BC4 block for byte 'channel' of the texels; 8-value mode
+void EncodeBC4Channel( const uint texels[16], const int channel, uchar* out )
+{
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; i++) { const int v = (texels[i] >> (8 * channel)) & 255; lo = min( lo, v ), hi = max( hi, v ); }
+	out[0] = (uchar)hi, out[1] = (uchar)lo;
+	uchar palette[8];
+	BC4Palette( out, palette );
+	uint64_t indices = 0;
+	if (hi > lo) for (int i = 0; i < 16; i++)
+	{
+		const int v = (texels[i] >> (8 * channel)) & 255;
+		int best = 0;
+		for (int j = 1; j < 8; j++) if (abs( v - palette[j] ) < abs( v - palette[best] )) best = j;
+		indices |= (uint64_t)best << (3 * i);
+	}
+	for (int i = 0; i < 6; i++) out[2 + i] = (uchar)(indices >> (8 * i));
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4-bit indices
+void EncodeBC7Block( const uint texels[16], uchar* out )
+{
+	float p[16][4], lo[4], hi[4];
+	for (int i = 0; i < 16; i++) for (int c = 0; c < 4; c++) p[i][c] = (float)((texels[i] >> (8 * c)) & 255);
+	FitLine<4>( p, lo, hi );
+	// quantize the endpoints; pick the p-bit that fits best
+	int e[2][4], pbit[2];
+	const float* ends[2] = { lo, hi };
+	for (int j = 0; j < 2; j++)
+	{
+		float bestErr = 1e30f;
+		for (int pb = 0; pb < 2; pb++)
+		{
+			int q[4];
+			float err = 0;
+			for (int c = 0; c < 4; c++) q[c] = clamp( (int)((ends[j][c] - pb) * 0.5f + 0.5f), 0, 127 ), err += sqr( (q[c] * 2 + pb) - ends[j][c] );
+			if (err < bestErr) { bestErr = err, pbit[j] = pb; for (int c = 0; c < 4; c++) e[j][c] = q[c]; }
+		}
+	}
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	int palette[16][4], index[16];
+	for (int i = 0; i < 16; i++) for (int c = 0; c < 4; c++)
+		palette[i][c] = ((64 - weights[i]) * (e[0][c] * 2 + pbit[0]) + weights[i] * (e[1][c] * 2 + pbit[1]) + 32) >> 6;
+	for (int i = 0; i < 16; i++)
+	{
+		int bestDist = INT_MAX;
+		for (int j = 0; j < 16; j++)
+		{
+			int dist = 0;
+			for (int c = 0; c < 4; c++) dist += sqr( (int)((texels[i] >> (8 * c)) & 255) - palette[j][c] );
+			if (dist < bestDist) bestDist = dist, index[i] = j;
+		}
+	}
+	// the anchor index is stored without its top bit; swap the endpoints if it is set
+	if (index[0] & 8)
+	{
+		for (int c = 0; c < 4; c++) Swap( e[0][c], e[1][c] );
+		Swap( pbit[0], pbit[1] );
+		for (int i = 0; i < 16; i++) index[i] = 15 - index[i];
+	}
+	uint64_t lo64 = 64, hi64 = (uint64_t)pbit[1]; // mode 6
+	for (int c = 0; c < 4; c++) for (int j = 0; j < 2; j++) lo64 |= (uint64_t)e[j][c] << (7 + c * 14 + j * 7);
+	lo64 |= (uint64_t)pbit[0] << 63;
+	for (int i = 0, shift = 1; i < 16; i++) hi64 |= (uint64_t)index[i] << shift, shift += i == 0 ? 3 : 4;
+	memcpy( out, &lo64, 8 ), memcpy( out + 8, &hi64, 8 );
+}
+
+// encode one level; edge blocks repeat the last row and column
+void EncodeBCLevel( const uint* src, const uint width, const uint height, const TexelStorage storage, uchar* out )
+{
+	const uint bw = (width + 3) >> 2, bh = (height + 3) >> 2, blockBytes = BCBlockBytes( storage );
+	ParallelFor( 0, (int)bh, [&]( int by ) {
+		uint texels[16];
+		for (uint bx = 0; bx < bw; bx++)
+		{
+			for (uint v = 0; v < 4; v++) for (uint u = 0; u < 4; u++)
+				texels[u + v * 4] = src[min( bx * 4 + u, width - 1 ) + min( by * 4 + v, height - 1 ) * width];
+			uchar* block = out + (by * bw + bx) * blockBytes;
+			switch (storage)
+			{
+			case TexelStorage::BC1: EncodeBC1Colors( texels, block ); break;
+			case TexelStorage::BC3: EncodeBC4Channel( texels, 3, block ), EncodeBC1Colors( texels, block + 8 ); break;
+			case TexelStorage::BC5: EncodeBC4Channel( texels, 0, block ), EncodeBC4Channel( texels, 1, block + 8 ); break;
+			default: EncodeBC7Block( texels, block ); break;
+			}
+		}
+	} );
+}
+
+} // namespace
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::ConstructMIPmaps                                              |
+//  |  Generate MIP levels for a loaded texture, down to 1x1. Level sizes are     |
+//  |  halved and rounded down, so non-power-of-two textures are supported.       |
+//  |  For sRGB textures, filtering is done in linear space. MIPfilter selects    |
+//  |  a box, Kaiser or Lanczos filter; the common case (box filter, even size,   |
+//  |  no sRGB) uses a fast SIMD path. Alpha is the minimum of the covered        |
+//  |  texels, so alpha-tested surfaces do not grow at a distance.                |
+//  |  Half precision HDR levels are filtered in full precision. A compressed     |
+//  |  texture is decompressed first.                                       LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::ConstructMIPmaps( const bool sRGB )
+{
+	if (bdata) Decompress(); // recompressed on the next sync
+	if (hdata)
+	{
+		vector<float4> level( width * height ), next;
+		HalfToFloat( hdata, (float*)level.data(), width * height * 4 );
+		ushort* dst = hdata + width * height * 4;
+		for (uint i = 1, pw = width, ph = height; i < MIPlevels; i++)
+		{
+			const uint w = max( 1u, pw >> 1 ), h = max( 1u, ph >> 1 );
+			next.resize( w * h );
+			ResampleHDR( level.data(), pw, ph, next.data(), w, h, MIPfilter );
+			FloatToHalf( (float*)next.data(), dst, w * h * 4 );
+			dst += w * h * 4, pw = w, ph = h;
+			level.swap( next );
 		}
-		// next layer
-		src = dst, dst += w * h, pw = w, ph = h, w >>= 1, h >>= 1;
+		return;
 	}
+	uint* src = (uint*)idata;
+	int pw = width, ph = height;
+	for (uint i = 1; i < MIPlevels; i++)
+	{
+		const int w = max( 1, pw >> 1 ), h = max( 1, ph >> 1 );
+		uint* dst = src + pw * ph;
+		if (MIPfilter == MIP_BOX && !sRGB && pw == w * 2 && ph == h * 2) ReduceBox2x2( src, pw, dst, w, h );
+		else Resample( src, pw, ph, dst, w, h, MIPfilter, sRGB );
+		src = dst, pw = w, ph = h;
+	}
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::StoreAsHalf                                                   |
+//  |  Replace the float4 texels of a HDR texture by RGBA16F texels, and add a    |
+//  |  MIP chain. Halves the memory used by the texture.                    LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::StoreAsHalf()
+{
+	if (!fdata) return;
+	MIPlevels = MIPlevelsNeeded( width, height );
+	hdata = (ushort*)MALLOC64( 4 * sizeof( ushort ) * PixelsNeeded( width, height, MIPlevels ) );
+	FloatToHalf( (float*)fdata, hdata, width * height * 4 );
+	FREE64( fdata );
+	fdata = 0;
+	ConstructMIPmaps();
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -161,49 +619,11 @@ void HostTexture::Load( const char* fileName, const uint modFlags, bool normalMa
 
 #ifdef CACHEIMAGES
 	// see if we can fetch a binary blob; faster than most FreeImage formats
-	if (strlen( fileName ) > 4) if (fileName[strlen( fileName ) - 4] == '.')
-	{
-		char binFile[1024];
-		memcpy( binFile, fileName, strlen( fileName ) + 1 );
-		binFile[strlen( fileName ) - 4] = 0;
-		strcat_s( binFile, ".bin" );
-		FILE* f;
-	#ifdef _MSC_VER
-		fopen_s( &f, binFile, "rb" );
-	#else
-		f = fopen( binFile, "rb" );
-	#endif
-		if (f)
-		{
-			uint version;
-			fread( &version, 1, 4, f );
-			if (version == BINTEXFILEVERSION)
-			{
-				fread( &width, 4, 1, f );
-				fread( &height, 4, 1, f );
-				int dataType;
-				fread( &dataType, 4, 1, f );
-				fread( &mods, 4, 1, f );
-				fread( &flags, 4, 1, f );
-				fread( &MIPlevels, 4, 1, f );
-				if (dataType == 0)
-				{
-					int pixelCount = PixelsNeeded( width, height, 1 /* no MIPS for HDR textures */ );
-					fdata = (float4*)MALLOC64( sizeof( float4 ) * pixelCount );
-					fread( fdata, sizeof( float4 ), pixelCount, f );
-				}
-				else
-				{
-					int pixelCount = PixelsNeeded( width, height, MIPLEVELCOUNT );
-					idata = (uchar4*)MALLOC64( sizeof( uchar4 ) * pixelCount );
-					fread( idata, 4, pixelCount, f );
-				}
-				fclose( f );
-				mods = modFlags;
-				return;
-			}
-		}
-	}
+	char binFile[1024];
+	snprintf( binFile, sizeof( binFile ), "%s.%02x.bin", fileName, modFlags | (normalMap ? 0x80 : 0) );
+	const uint64_t keyData[5] = { FileStamp( fileName ), modFlags, normalMap ? 1u : 0u, (uint64_t)MIPfilter, halfHDR ? 1u : 0u };
+	const uint64_t cacheKey = calccrc64( (uchar*)keyData, sizeof( keyData ) );
+	if (LoadFromCache( binFile, cacheKey )) { mods = modFlags; return; }
 #endif
 	// get filetype
 	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType( fileName, 0 );
@@ -225,30 +645,23 @@ void HostTexture::Load( const char* fileName, const uint modFlags, bool normalMa
 		// invert image if requested
 		if (mods & INVERTED) FreeImage_Invert( img );
 		// read pixels
-		idata = (uchar4*)MALLOC64( sizeof( uchar4 ) * PixelsNeeded( width, height, MIPLEVELCOUNT ) );
+		MIPlevels = MIPlevelsNeeded( width, height );
+		idata = (uchar4*)MALLOC64( sizeof( uchar4 ) * PixelsNeeded( width, height, MIPlevels ) );
 		flags |= LDR;
-		for (uint y = 0; y < height; y++, bytes += pitch) for (uint x = 0; x < width; x++)
-		{
-			// convert from FreeImage's 32-bit image format (usually BGRA) to 32-bit RGBA
-			uchar *pixel = &((uchar*)bytes)[x * 4];
-			uchar4 rgba = make_uchar4( pixel[FI_RGBA_RED], pixel[FI_RGBA_GREEN], pixel[FI_RGBA_BLUE], pixel[FI_RGBA_ALPHA] );
-			(mods & FLIPPED) ? idata[(y * width) + x] = rgba : idata[((height - 1 - y) * width) + x] = rgba;  // FreeImage stores the data upside down by default
-		}
+		// convert from FreeImage's 32-bit image format (usually BGRA) to 32-bit RGBA; FreeImage stores the data upside down by default
+		for (uint y = 0; y < height; y++, bytes += pitch) ConvertRowRGBA8( bytes, idata + ((mods & FLIPPED) ? y : (height - 1 - y)) * width, width );
 		// perform sRGB -> linear conversion if requested
 		if (mods & LINEARIZED) sRGBtoLinear( (uchar*)idata, width * height, 4 );
-		// produce the MIP maps
-		ConstructMIPmaps();
 	}
 	else // HDR
 	{
-		fdata = (float4*)MALLOC64( sizeof( float4 ) * PixelsNeeded( width, height, 1 /* no MIPs for HDR for now */ ) );
+		fdata = (float4*)MALLOC64( sizeof( float4 ) * PixelsNeeded( width, height, 1 /* MIPs are added by StoreAsHalf */ ) );
 		flags |= HDR;
-		for (uint y = 0; y < height; y++, bytes += pitch) for (uint x = 0; x < width; x++)
+		for (uint y = 0; y < height; y++, bytes += pitch)
 		{
-			float4 rgba;
-			if (bpp == 96) rgba = make_float4( ((float3*)bytes)[x], 1.0f );	// 96-bit RGB, append alpha channel
-			else if (bpp == 128) rgba = ((float4*)bytes)[x];				// 128-bit RGBA
-			(mods & FLIPPED) ? fdata[(y * width) + x] = rgba : fdata[((height - 1 - y) * width) + x] = rgba; // FreeImage stores the data upside down by default
+			float4* dst = fdata + ((mods & FLIPPED) ? y : (height - 1 - y)) * width; // FreeImage stores the data upside down by default
+			if (bpp == 96) ConvertRowRGBF( (float*)bytes, dst, width );	// 96-bit RGB, append alpha channel
+			else if (bpp == 128) memcpy( dst, bytes, width * sizeof( float4 ) ); // 128-bit RGBA
 		}
 	}
 	// mark normal map
@@ -259,58 +672,368 @@ void HostTexture::Load( const char* fileName, const uint modFlags, bool normalMa
 	// perform gamma correction
 	if (mods & GAMMACORRECTION)
 	{
-		for (uint p = 0; p < width * height; ++p)
-		{
-			if (flags & HDR)
-				fdata[p] = InverseGammaCorrect( fdata[p] );
-			else
-			{
-				const auto convert = []( const uchar in ) {
-					return (uchar)clamp( InverseGammaCorrect( in / 255.f ) * 255.f, 0.f, 255.f );
-				};
-
-				const auto in = idata[p];
-				idata[p] = make_uchar4(
-					convert( in.x ),
-					convert( in.y ),
-					convert( in.z ),
-					in.w );
-			}
-		}
+		if (flags & HDR) InverseGammaCorrect( fdata, width * height );
+		else sRGBtoLinear( (uchar*)idata, width * height, 4 );
 	}
+	// produce the MIP maps; after gamma correction, so all levels get it
+	if (idata) ConstructMIPmaps();
+	else if (halfHDR) StoreAsHalf();
 
 #ifdef CACHEIMAGES
 	// prepare binary blob to be faster next time
-	if (strlen( fileName ) > 4) if (fileName[strlen( fileName ) - 4] == '.')
-	{
-		char binFile[1024];
-		memcpy( binFile, fileName, strlen( fileName ) + 1 );
-		binFile[strlen( fileName ) - 4] = 0;
-		strcat_s( binFile, ".bin" );
-		FILE* f;
-	#ifdef _MSC_VER
-		fopen_s( &f, binFile, "rb" );
-	#else
-		f = fopen( binFile, "rb" );
-	#endif
-		if (f)
+	SaveToCache( binFile, cacheKey );
+#endif
+	// all done, mark for sync with core
+}
+
+// header of a texture cache file; followed by the texels, zlib compressed if that helps
+struct TexCacheHeader
+{
+	uint version;				// BINTEXFILEVERSION
+	uint hdr;					// texels: 0 = uchar4, 1 = float4, 2 = RGBA16F, 3 = blocks
+	uint blockFormat;			// for blocks: BC1..BC7
+	uint64_t key;				// source file stamp, load flags and HDR settings
+	uint width, height, flags, MIPlevels;
+	uint packed;				// payload is zlib compressed
+	uint payloadCRC;			// crc32 of the payload as stored
+	uint64_t rawSize, packedSize;
+};
+
+// helper: inflate bytes [skip, skip + size) of a zlib stream to 'dst'; the leading bytes pass through a small buffer
+static bool InflateRange( const uchar* packed, const uint64_t packedSize, uchar* dst, const size_t skip, const size_t size )
+{
+	z_stream stream = {};
+	if (inflateInit( &stream ) != Z_OK) return false;
+	stream.next_in = (Bytef*)packed, stream.avail_in = (uInt)packedSize;
+	uchar scratch[16384];
+	int result = Z_OK;
+	for (size_t skipped = 0; skipped < skip && result == Z_OK;)
+	{
+		const uInt chunk = (uInt)min( sizeof( scratch ), skip - skipped );
+		stream.next_out = scratch, stream.avail_out = chunk;
+		result = inflate( &stream, Z_NO_FLUSH );
+		skipped += chunk - stream.avail_out;
+	}
+	if (result == Z_OK)
+	{
+		stream.next_out = dst, stream.avail_out = (uInt)size;
+		result = inflate( &stream, Z_FINISH );
+	}
+	const bool complete = result == Z_STREAM_END && stream.avail_out == 0;
+	inflateEnd( &stream );
+	return complete;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::LoadFromCache                                                 |
+//  |  Fetch the converted texels, including the MIP chain, from a cache file.    |
+//  |  Entries for another source file version, other load flags or an older      |
+//  |  file format are rejected, and so are damaged files. Levels finer than      |
+//  |  'firstLevel' are skipped while decoding, so a partial chain never needs    |
+//  |  the memory of the full chain; see TextureStreamer.                   LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool HostTexture::LoadFromCache( const char* binFile, const uint64_t key, const uint firstLevel )
+{
+	MappedFile file( binFile );
+	if (file.size < sizeof( TexCacheHeader )) return false;
+	TexCacheHeader header;
+	memcpy( &header, file.data, sizeof( header ) );
+	if (header.version != BINTEXFILEVERSION || header.key != key) return false;
+	if (header.packedSize != file.size - sizeof( header )) return false; // truncated
+	const uchar* payload = file.data + sizeof( header );
+	if (crc32( 0, payload, (uInt)header.packedSize ) != header.payloadCRC) return false;
+	const uint64_t texelSize[3] = { sizeof( uchar4 ), sizeof( float4 ), 4 * sizeof( ushort ) };
+	if (header.hdr > 3) return false;
+	if (header.hdr == 3)
+	{
+		if (!IsBlockCompressed( (TexelStorage)header.blockFormat )) return false;
+		if (header.rawSize != BlockBytesNeeded( header.width, header.height, header.MIPlevels, (TexelStorage)header.blockFormat )) return false;
+	}
+	else if (header.rawSize != PixelsNeeded( header.width, header.height, header.hdr == 1 ? 1 : header.MIPlevels ) * texelSize[header.hdr]) return false;
+	// byte range of the requested levels; HDR textures without a MIP chain are loaded whole
+	const uint levels = (header.hdr == 1 || header.MIPlevels == 0) ? 0 : min( firstLevel, header.MIPlevels - 1 );
+	uint w = header.width, h = header.height;
+	for (uint i = 0; i < levels; i++) w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+	size_t skip = 0, keep = header.rawSize;
+	if (levels > 0)
+	{
+		if (header.hdr == 3)
 		{
-			uint version = BINTEXFILEVERSION;
-			fwrite( &version, 4, 1, f );
-			fwrite( &width, 4, 1, f );
-			fwrite( &height, 4, 1, f );
-			int dataType = fdata ? 0 : 1;
-			fwrite( &dataType, 4, 1, f );
-			fwrite( &mods, 4, 1, f );
-			fwrite( &flags, 4, 1, f );
-			fwrite( &MIPlevels, 4, 1, f );
-			if (dataType == 0) fwrite( fdata, sizeof( float4 ), PixelsNeeded( width, height, 1 ), f );
-			else fwrite( idata, 4, PixelsNeeded( width, height, MIPLEVELCOUNT ), f );
-			fclose( f );
+			const TexelStorage format = (TexelStorage)header.blockFormat;
+			skip = BlockBytesNeeded( header.width, header.height, levels, format ), keep = BlockBytesNeeded( w, h, header.MIPlevels - levels, format );
 		}
+		else skip = PixelsNeeded( header.width, header.height, levels ) * texelSize[header.hdr], keep = PixelsNeeded( w, h, header.MIPlevels - levels ) * texelSize[header.hdr];
+	}
+	uchar* texels = (uchar*)MALLOC64( keep );
+	if (!header.packed) memcpy( texels, payload + skip, keep );
+	else if (!InflateRange( payload, header.packedSize, texels, skip, keep ))
+	{
+		FREE64( texels );
+		return false;
 	}
+	width = w, height = h, flags = header.flags, MIPlevels = header.MIPlevels - levels, residentLevel = levels;
+	if (header.hdr == 3) bdata = texels, blockFormat = (TexelStorage)header.blockFormat;
+	else if (header.hdr == 2) hdata = (ushort*)texels;
+	else if (header.hdr == 1) fdata = (float4*)texels;
+	else idata = (uchar4*)texels;
+	return true;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::SaveToCache                                                   |
+//  |  Store the converted texels in a cache file. The file is written under a    |
+//  |  temporary name and then renamed, so an interrupted write never leaves a    |
+//  |  partial cache file behind.                                           LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::SaveToCache( const char* binFile, const uint64_t key ) const
+{
+	TexCacheHeader header = {};
+	header.version = BINTEXFILEVERSION, header.key = key, header.hdr = bdata ? 3 : (hdata ? 2 : (fdata ? 1 : 0));
+	header.width = width, header.height = height, header.flags = flags, header.MIPlevels = MIPlevels;
+	const uchar* texels = bdata ? bdata : (hdata ? (uchar*)hdata : (fdata ? (uchar*)fdata : (uchar*)idata));
+	if (bdata) header.rawSize = BlockBytesNeeded( width, height, MIPlevels, blockFormat ), header.blockFormat = blockFormat;
+	else if (hdata) header.rawSize = 4 * sizeof( ushort ) * PixelsNeeded( width, height, MIPlevels );
+	else if (fdata) header.rawSize = sizeof( float4 ) * PixelsNeeded( width, height, 1 );
+	else header.rawSize = sizeof( uchar4 ) * PixelsNeeded( width, height, MIPlevels );
+	// compress; keep the raw texels if that does not make them smaller
+	vector<uchar> packed( compressBound( (uLong)header.rawSize ) );
+	uLongf packedSize = (uLongf)packed.size();
+	const uchar* payload = texels;
+	header.packedSize = header.rawSize;
+	if (compress2( packed.data(), &packedSize, texels, (uLong)header.rawSize, Z_BEST_SPEED ) == Z_OK && packedSize < header.rawSize)
+		header.packed = 1, header.packedSize = packedSize, payload = packed.data();
+	header.payloadCRC = crc32( 0, payload, (uInt)header.packedSize );
+	// write under a name that is unique for this thread; parallel loads may target the same file
+	char tmpFile[1100];
+	const uint threadTag = (uint)std::hash<std::thread::id>()(std::this_thread::get_id());
+	snprintf( tmpFile, sizeof( tmpFile ), "%s.%08x.tmp", binFile, threadTag );
+	FILE* f;
+#ifdef _MSC_VER
+	fopen_s( &f, tmpFile, "wb" );
+#else
+	f = fopen( tmpFile, "wb" );
 #endif
-	// all done, mark for sync with core
+	if (!f) return; // read-only asset folder; no cache
+	bool written = fwrite( &header, sizeof( header ), 1, f ) == 1;
+	written &= fwrite( payload, 1, header.packedSize, f ) == header.packedSize;
+	written &= fclose( f ) == 0;
+	if (!written || !RenameFile( tmpFile, binFile )) remove( tmpFile );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::Release                                                       |
+//  |  Free the texels once a core holds a copy; they are written to a cache      |
+//  |  file, named after their 64-bit content hash, first. An existing file with  |
+//  |  that name is reused; Restore verifies the texels it returns. Dimensions    |
+//  |  and flags stay valid. Textures without a writable cache folder keep their  |
+//  |  texels, and so do partial MIP chains, which the TextureStreamer manages.   |
+//  |  Restore falls back to the source file, so textures that can not be         |
+//  |  rebuilt from it (embedded glTF images, edited texels such as converted     |
+//  |  bump maps) are kept as well.                                         LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::Release()
+{
+	if (releasedBytes > 0 || residentLevel > 0 || !TexelData()) return;
+	if (texelsEdited || origin.empty() || !FileExists( origin.c_str() )) return;
+	const uint64_t key = ContentHash();
+	const string file = TextureStreamer::CacheFile( key );
+	if (!FileExists( file.c_str() )) SaveToCache( file.c_str(), key );
+	if (!FileExists( file.c_str() )) return;
+	// the core has these texels already; do not report the pointer change as an edit
+	const bool dirty = IsDirty();
+	releasedStorage = ConvertToCoreTexDesc().storage;
+	releasedBytes = TexelBytes(), releasedKey = key;
+	FREE64( idata ); FREE64( fdata ); FREE64( hdata ); FREE64( bdata );
+	idata = 0, fdata = 0, hdata = 0, bdata = 0;
+	MarkAsNotDirty();
+	if (dirty) MarkAsDirty();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::Restore                                                       |
+//  |  Bring back released texels, from the cache file or, if that is gone or     |
+//  |  holds other texels, from the source file, which is compressed again if     |
+//  |  the released texels were. The result may differ from what the core holds,  |
+//  |  so the texture is then sent again. No-op for textures that were not        |
+//  |  released.                                                            LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::Restore()
+{
+	if (releasedBytes == 0) return;
+	const bool dirty = IsDirty();
+	bool cached = LoadFromCache( TextureStreamer::CacheFile( releasedKey ).c_str(), releasedKey );
+	if (cached && (TexelBytes() != releasedBytes || ContentHash() != releasedKey))
+	{
+		// the file carries the right key, but not the texels that were released
+		FREE64( idata ); FREE64( fdata ); FREE64( hdata ); FREE64( bdata );
+		idata = 0, fdata = 0, hdata = 0, bdata = 0;
+		cached = false;
+	}
+	if (!cached)
+	{
+		FATALERROR_IF( origin.empty() || !FileExists( origin.c_str() ), "Texels of texture %s were released and can not be restored", name.c_str() );
+		Load( origin.c_str(), mods, (flags & NORMALMAP) != 0 );
+		if (IsBlockCompressed( releasedStorage )) Compress();
+	}
+	releasedBytes = 0, releasedKey = 0;
+	MarkAsNotDirty();
+	if (dirty || !cached) MarkAsDirty();
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::Compress                                                      |
+//  |  Replace the texels, including the MIP chain, by BCn blocks. Normal maps    |
+//  |  use BC5; color uses BC1 / BC3 or BC7, see 'compression'. Encoded blocks    |
+//  |  are cached next to the source file, keyed by a hash of the texels.   LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::Compress()
+{
+	if (compression == COMPRESS_NONE || !idata || residentLevel > 0) return; // a partial chain would overwrite the cache entry
+	TexelStorage format = TexelStorage::BC5;
+	if (!(flags & NORMALMAP))
+	{
+		bool opaque = true;
+		for (uint i = 0; i < width * height && opaque; i++) opaque = idata[i].w == 255;
+		format = compression == COMPRESS_BC7 ? TexelStorage::BC7 : (opaque ? TexelStorage::BC1 : TexelStorage::BC3);
+	}
+	uchar4* texels = idata;
+#ifdef CACHEIMAGES
+	char binFile[1024] = {};
+	uint64_t key = 0;
+	if (!origin.empty() && FileExists( origin.c_str() ))
+	{
+		snprintf( binFile, sizeof( binFile ), "%s.%02x.bc.bin", origin.c_str(), mods );
+		const uint pixelCount = PixelsNeeded( width, height, MIPlevels );
+		const uint64_t keyData[4] = { crc32( 0, (uchar*)idata, pixelCount * 4 ), pixelCount, (uint64_t)format, ((uint64_t)width << 32) + height };
+		key = calccrc64( (uchar*)keyData, sizeof( keyData ) );
+		idata = 0; // the key only matches blocks of this format; LoadFromCache sets bdata
+		if (LoadFromCache( binFile, key )) { FREE64( texels ); return; }
+		idata = texels;
+	}
+#endif
+	bdata = (uchar*)MALLOC64( BlockBytesNeeded( width, height, MIPlevels, format ) );
+	uchar* dst = bdata;
+	for (uint i = 0, w = width, h = height; i < MIPlevels; i++)
+	{
+		EncodeBCLevel( (uint*)texels, w, h, format, dst );
+		texels += w * h, dst += BCLevelBytes( w, h, format );
+		w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+	}
+	FREE64( idata );
+	idata = 0, blockFormat = format;
+#ifdef CACHEIMAGES
+	if (binFile[0]) SaveToCache( binFile, key );
+#endif
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::Decompress                                                    |
+//  |  Restore 32-bit texels, e.g. before modifying the texture.            LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::Decompress()
+{
+	Restore();
+	if (!bdata) return;
+	idata = (uchar4*)MALLOC64( PixelsNeeded( width, height, MIPlevels ) * sizeof( uchar4 ) );
+	uint* dst = (uint*)idata;
+	const uchar* src = bdata;
+	for (uint i = 0, w = width, h = height; i < MIPlevels; i++)
+	{
+		DecodeBCLevel( src, w, h, blockFormat, dst );
+		dst += w * h, src += BCLevelBytes( w, h, blockFormat );
+		w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+	}
+	FREE64( bdata );
+	bdata = 0, blockFormat = ARGB32;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::Texel                                                         |
+//  |  Fetch a single texel of the base level of an LDR texture.            LH2'20|
+//  +-----------------------------------------------------------------------------+
+uint HostTexture::Texel( const uint x, const uint y )
+{
+	Restore();
+	if (bdata) return FetchBCTexel( bdata, width, blockFormat, x, y );
+	return ((uint*)idata)[x + y * width];
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::TexelBytes                                                    |
+//  |  Size of the texel data in memory, including the MIP chain.           LH2'20|
+//  +-----------------------------------------------------------------------------+
+size_t HostTexture::TexelBytes() const
+{
+	if (bdata) return BlockBytesNeeded( width, height, MIPlevels, blockFormat );
+	if (hdata) return (size_t)PixelsNeeded( width, height, MIPlevels ) * 4 * sizeof( ushort );
+	if (fdata) return (size_t)PixelsNeeded( width, height, 1 ) * sizeof( float4 );
+	return idata ? (size_t)PixelsNeeded( width, height, MIPlevels ) * sizeof( uchar4 ) : 0;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::ContentHash                                                   |
+//  |  Hash of the texels and their layout; identifies the texture data in a      |
+//  |  cache file, regardless of where it was loaded from. The texels get a full  |
+//  |  64-bit hash: cache files with a matching key are trusted.            LH2'20|
+//  +-----------------------------------------------------------------------------+
+uint64_t HostTexture::ContentHash() const
+{
+	const uint64_t keyData[5] = { FastHash64( TexelData(), TexelBytes() ), ((uint64_t)width << 32) + height, MIPlevels,
+		(uint64_t)(bdata ? blockFormat : ARGB32), (uint64_t)(hdata ? 2 : (fdata ? 1 : 0)) };
+	return calccrc64( (uchar*)keyData, sizeof( keyData ) );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::SameTexels                                                    |
+//  |  Exact comparison of the texels and their layout; used to confirm a         |
+//  |  ContentHash match before textures are merged.                        LH2'20|
+//  +-----------------------------------------------------------------------------+
+bool HostTexture::SameTexels( const HostTexture& other ) const
+{
+	if (width != other.width || height != other.height || MIPlevels != other.MIPlevels) return false;
+	if (!bdata != !other.bdata || !hdata != !other.hdata || !fdata != !other.fdata || blockFormat != other.blockFormat) return false;
+	const size_t bytes = TexelBytes();
+	return bytes == other.TexelBytes() && memcmp( TexelData(), other.TexelData(), bytes ) == 0;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::DropLevels                                                    |
+//  |  Free the 'count' finest levels of the MIP chain. The texture continues at  |
+//  |  a lower resolution; 'residentLevel' tells how many levels are missing.     |
+//  |  HDR textures without a MIP chain are left untouched.                 LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::DropLevels( const uint count )
+{
+	if (count == 0 || count >= MIPlevels || (!idata && !hdata && !bdata)) return;
+	uint w = width, h = height;
+	for (uint i = 0; i < count; i++) w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+	size_t skip, keep;
+	if (bdata) skip = BlockBytesNeeded( width, height, count, blockFormat ), keep = BlockBytesNeeded( w, h, MIPlevels - count, blockFormat );
+	else
+	{
+		const size_t texelSize = hdata ? 4 * sizeof( ushort ) : sizeof( uchar4 );
+		skip = PixelsNeeded( width, height, count ) * texelSize, keep = PixelsNeeded( w, h, MIPlevels - count ) * texelSize;
+	}
+	uchar* texels = bdata ? bdata : (hdata ? (uchar*)hdata : (uchar*)idata);
+	uchar* remaining = (uchar*)MALLOC64( keep );
+	memcpy( remaining, texels + skip, keep );
+	FREE64( texels );
+	if (bdata) bdata = remaining; else if (hdata) hdata = (ushort*)remaining; else idata = (uchar4*)remaining;
+	width = w, height = h, MIPlevels -= count, residentLevel += count;
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  HostTexture::AdoptTexels                                                   |
+//  |  Replace the texels by those of another texture object, which is left       |
+//  |  empty. Used to swap in texels that were loaded in the background.    LH2'20|
+//  +-----------------------------------------------------------------------------+
+void HostTexture::AdoptTexels( HostTexture* source )
+{
+	FREE64( idata ); FREE64( fdata ); FREE64( hdata ); FREE64( bdata );
+	idata = source->idata, fdata = source->fdata, hdata = source->hdata, bdata = source->bdata;
+	width = source->width, height = source->height, MIPlevels = source->MIPlevels;
+	blockFormat = source->blockFormat, residentLevel = source->residentLevel;
+	source->idata = 0, source->fdata = 0, source->hdata = 0, source->bdata = 0;
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -319,27 +1042,52 @@ void HostTexture::Load( const char* fileName, const uint modFlags, bool normalMa
 //  +-----------------------------------------------------------------------------+
 void HostTexture::BumpToNormalMap( float heightScale )
 {
-	uchar* normalMap = new uchar[width * height * 4];
-	const float stepZ = 1.0f / 255.0f;
-	for (uint i = 0; i < width * height; i++)
-	{
-		uint xCoord = i % width, yCoord = i / width;
-		float xPrev = xCoord > 0 ? idata[i - 1].x * stepZ : idata[i].x * stepZ;
-		float xNext = xCoord < width - 1 ? idata[i + 1].x * stepZ : idata[i].x * stepZ;
-		float yPrev = yCoord < height - 1 ? idata[i + width].x * stepZ : idata[i].x * stepZ;
-		float yNext = yCoord > 0 ? idata[i - width].x * stepZ : idata[i].x * stepZ;
-		float3 normal;
-		normal.x = (xPrev - xNext) * heightScale;
-		normal.y = (yPrev - yNext) * heightScale;
-		normal.z = 1;
-		normal = normalize( normal );
-		normalMap[i * 4 + 0] = (uchar)round( (normal.x * 0.5 + 0.5) * 255 );
-		normalMap[i * 4 + 1] = (uchar)round( (normal.y * 0.5 + 0.5) * 255 );
-		normalMap[i * 4 + 2] = (uchar)round( (normal.z * 0.5 + 0.5) * 255 );
-		normalMap[i * 4 + 3] = 255;
-	}
-	if (width * height > 0) memcpy( idata, normalMap, width * height * 4 );
-	delete normalMap;
+	if (width * height == 0) return;
+	if (bdata) Decompress();
+	texelsEdited = true;
+	const float* toFloat = TexelTables::Get().toFloat;
+	// heights of a scanline, padded with the edge texels on both sides
+	vector<float> heights( (width + 2) * height );
+	for (uint y = 0; y < height; y++)
+	{
+		float* row = heights.data() + y * (width + 2) + 1;
+		for (uint x = 0; x < width; x++) row[x] = toFloat[idata[x + y * width].x];
+		row[-1] = row[0], row[width] = row[width - 1];
+	}
+	uint* normalMap = (uint*)MALLOC64( width * height * sizeof( uint ) );
+	const __m256 scale8 = _mm256_set1_ps( heightScale ), half8 = _mm256_set1_ps( 0.5f ), one8 = _mm256_set1_ps( 1 );
+	const __m256 byte8 = _mm256_set1_ps( 255 );
+	// AVX has no 256-bit integer operations; channels are packed in 128-bit halves
+	auto pack = []( const __m128i r, const __m128i g, const __m128i b ) {
+		return _mm_or_si128( _mm_or_si128( r, _mm_slli_epi32( g, 8 ) ), _mm_or_si128( _mm_slli_epi32( b, 16 ), _mm_set1_epi32( 0xff000000 ) ) );
+	};
+	for (uint y = 0; y < height; y++)
+	{
+		const float* row = heights.data() + y * (width + 2) + 1;
+		const float* below = y < height - 1 ? row + width + 2 : row, * above = y > 0 ? row - width - 2 : row;
+		uint* out = normalMap + y * width, x = 0;
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m256 nx = _mm256_mul_ps( _mm256_sub_ps( _mm256_loadu_ps( row + x - 1 ), _mm256_loadu_ps( row + x + 1 ) ), scale8 );
+			const __m256 ny = _mm256_mul_ps( _mm256_sub_ps( _mm256_loadu_ps( below + x ), _mm256_loadu_ps( above + x ) ), scale8 );
+			const __m256 rcp = _mm256_div_ps( one8, _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( nx, nx ), _mm256_add_ps( _mm256_mul_ps( ny, ny ), one8 ) ) ) );
+			// (n * 0.5 + 0.5) * 255, rounded to nearest
+			const __m256i bx = _mm256_cvtps_epi32( _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_mul_ps( nx, rcp ), half8 ), half8 ), byte8 ) );
+			const __m256i by = _mm256_cvtps_epi32( _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_mul_ps( ny, rcp ), half8 ), half8 ), byte8 ) );
+			const __m256i bz = _mm256_cvtps_epi32( _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( rcp, half8 ), half8 ), byte8 ) );
+			_mm_storeu_si128( (__m128i*)(out + x), pack( _mm256_castsi256_si128( bx ), _mm256_castsi256_si128( by ), _mm256_castsi256_si128( bz ) ) );
+			_mm_storeu_si128( (__m128i*)(out + x + 4), pack( _mm256_extractf128_si256( bx, 1 ), _mm256_extractf128_si256( by, 1 ), _mm256_extractf128_si256( bz, 1 ) ) );
+		}
+		for (; x < width; x++)
+		{
+			const float3 normal = normalize( make_float3( (row[x - 1] - row[x + 1]) * heightScale, (below[x] - above[x]) * heightScale, 1 ) );
+			out[x] = (uint)roundf( (normal.x * 0.5f + 0.5f) * 255 ) + ((uint)roundf( (normal.y * 0.5f + 0.5f) * 255 ) << 8) +
+				((uint)roundf( (normal.z * 0.5f + 0.5f) * 255 ) << 16) + 0xff000000;
+		}
+	}
+	memcpy( idata, normalMap, width * height * sizeof( uint ) );
+	FREE64( normalMap );
+	ConstructMIPmaps();
 }
 
 // EOF
\ No newline at end of file
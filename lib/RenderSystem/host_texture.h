@@ -49,6 +49,18 @@ public:
 		INVERTED = 4,
 		GAMMACORRECTION = 8,
 	};
+	enum
+	{
+		MIP_BOX = 0,					// MIP filters, see ConstructMIPmaps
+		MIP_KAISER,
+		MIP_LANCZOS
+	};
+	enum
+	{
+		COMPRESS_NONE = 0,				// block compression modes, see Compress
+		COMPRESS_FAST,					// BC1 for opaque color, BC3 with alpha
+		COMPRESS_BC7					// BC7 for color
+	};
 	// constructor / destructor / conversion
 	HostTexture() = default;
 	HostTexture( const char* fileName, const uint modFlags = 0 );
@@ -59,17 +71,40 @@ public:
 	static void sRGBtoLinear( uchar* pixels, const uint size, const uint stride );
 	static float InverseGammaCorrect( float value );
 	static float4 InverseGammaCorrect( const float4& value );
+	static void InverseGammaCorrect( float4* pixels, const uint count );
 	void BumpToNormalMap( float heightScale );
-	uint* GetLDRPixels() { return (uint*)idata; }
-	float4* GetHDRPixels() { return fdata; }
+	uint* GetLDRPixels() { Restore(); texelsEdited = true; return (uint*)idata; }
+	float4* GetHDRPixels() { Restore(); texelsEdited = true; return fdata; }
+	ushort* GetHalfPixels() { Restore(); texelsEdited = true; return hdata; }
 	// internal methods
 	int PixelsNeeded( const int width, const int height, const int MIPlevels ) const;
-	void ConstructMIPmaps();
+	static uint MIPlevelsNeeded( const uint width, const uint height );
+	static size_t BlockBytesNeeded( const uint width, const uint height, const uint MIPlevels, const TexelStorage format );
+	void ConstructMIPmaps( const bool sRGB = false );
+	void StoreAsHalf();
+	void Compress();
+	void Decompress();
+	uint Texel( const uint x, const uint y );
+	size_t TexelBytes() const;
+	const uchar* TexelData() const { return bdata ? bdata : (hdata ? (uchar*)hdata : (fdata ? (uchar*)fdata : (uchar*)idata)); }
+	uint64_t ContentHash() const;
+	bool SameTexels( const HostTexture& other ) const;
+	void DropLevels( const uint count );
+	void AdoptTexels( HostTexture* source );
+	bool LoadFromCache( const char* binFile, const uint64_t key, const uint firstLevel = 0 );
+	void SaveToCache( const char* binFile, const uint64_t key ) const;
+	void Release();
+	void Restore();
+	bool Released() const { return releasedBytes > 0; }
+	static inline int MIPfilter = MIP_BOX;	// filter used for MIP construction
+	static inline bool halfHDR = true;		// store HDR textures as RGBA16F, with MIP levels
+	static inline int compression = COMPRESS_NONE;	// block compression of LDR textures
+	static inline bool releaseAfterUpload = false;	// drop host texels once the core has a copy, see Release; needs CoreAPI_Base::SkipsUnchangedTextures
 	// public properties
 public:
 	uint width = 0;						// width in pixels
 	uint height = 0;					// height in pixels
-	uint MIPlevels = 1;					// number of MIPmaps
+	uint MIPlevels = 1;					// number of MIPmaps, including the base level
 	uint ID = 0;						// unique integer ID of this texture
 	string name;						// texture name, not for unique identification
 	string origin;						// origin: file from which the data was loaded, with full path
@@ -78,6 +113,14 @@ public:
 	uint refCount = 1;					// the number of materials that use this texture
 	uchar4* idata = nullptr;			// pointer to a 32-bit ARGB bitmap
 	float4* fdata = nullptr;			// pointer to a 128-bit ARGB bitmap
+	ushort* hdata = nullptr;			// pointer to a 64-bit ARGB bitmap, half precision
+	uchar* bdata = nullptr;				// pointer to block compressed texels, see blockFormat
+	TexelStorage blockFormat = ARGB32;	// BC1..BC7 when compressed
+	uint residentLevel = 0;				// finest MIP level in memory; width and height are of this level, see TextureStreamer
+	size_t releasedBytes = 0;			// texel bytes dropped by Release; 0 if the texels are in memory
+	uint64_t releasedKey = 0;			// content hash of the released texels, names their cache file
+	TexelStorage releasedStorage = ARGB32;	// storage of the released texels, see ConvertToCoreTexDesc
+	bool texelsEdited = false;			// texels changed after loading, e.g. by BumpToNormalMap; see HostScene::FindOrAddTexture
 	TRACKCHANGES;						// add Changed(), MarkAsDirty() methods, see system.h
 };
 
@@ -138,8 +138,26 @@ enum class APIState
 static APIState currentApiState = APIState::Uninitialized;
 int catIndentCount = 0;
 
-std::map<std::string, std::vector<HostNode*>> instances;
-std::vector<HostNode*>* currentInstance = nullptr;
+// object definitions only record their shapes; each ObjectInstance then adds one node subtree that
+// refers to the shared meshes, so an object does not create nodes or lights of its own
+struct ObjectShape
+{
+	int meshID;
+	Transform transform;
+};
+std::map<std::string, std::vector<ObjectShape>> instances;
+std::vector<ObjectShape>* currentInstance = nullptr;
+
+// plymesh shapes are not loaded right away: files are gathered and then loaded in parallel
+// once the meshes are needed, i.e. at ObjectInstance and WorldEnd; see LoadPendingPLYMeshes
+struct PendingPLYMesh
+{
+	std::string filename;
+	Transform transform;
+	int materialIdx;
+	std::vector<ObjectShape>* instance;
+};
+static std::vector<PendingPLYMesh> pendingPLYMeshes;
 
 // API Macros
 #define VERIFY_INITIALIZED( func )                         \
@@ -211,6 +229,43 @@ static HostMesh* MakeShapes( const std::string& name,
 	return nullptr;
 }
 
+static void AddShapeNode( HostMesh* hostMesh, const Transform& ObjToWorld, std::vector<ObjectShape>* instance )
+{
+	// identical shapes, e.g. from included files, share one mesh
+	auto meshIdx = HostScene::FindOrAddMesh( hostMesh );
+	if (HostScene::meshPool[meshIdx] != hostMesh) delete hostMesh;
+	// Add _prims_ and _areaLights_ to scene or current instance
+	if (instance) instance->push_back( { meshIdx, ObjToWorld } );
+	else HostScene::AddInstance( new HostNode( meshIdx, ObjToWorld ) );
+}
+
+// Load the gathered plymesh shapes, a batch of files at a time, and add them in the order in which
+// they were specified. Files are read in parallel; meshes are built on this thread, as this
+// touches the scene.
+static void LoadPendingPLYMeshes()
+{
+	const size_t batchSize = 2 * max( 1u, std::thread::hardware_concurrency() );
+	for (size_t first = 0; first < pendingPLYMeshes.size(); first += batchSize)
+	{
+		const size_t count = min( batchSize, pendingPLYMeshes.size() - first );
+		std::vector<PLYData> data( count );
+		std::vector<char> loaded( count );
+		ParallelFor( 0, (int)count, [&]( int i ) { loaded[i] = LoadPLY( pendingPLYMeshes[first + i].filename, data[i] ); } );
+		for (size_t i = 0; i < count; i++)
+		{
+			const PendingPLYMesh& shape = pendingPLYMeshes[first + i];
+			if (!loaded[i])
+			{
+				Warning( "No mesh created for plymesh %s", shape.filename.c_str() );
+				continue;
+			}
+			AddShapeNode( CreatePLYMesh( data[i], shape.materialIdx ), shape.transform, shape.instance );
+			data[i] = PLYData();
+		}
+	}
+	pendingPLYMeshes.clear();
+}
+
 static HostMaterial* MakeMaterial( const std::string& name,
 	const TextureParams& mp )
 {
@@ -823,12 +878,14 @@ void pbrtShape( const std::string& name, const ParamSet& params )
 		// Sanity, ensure the material is emissive within LH2 definitions:
 		if (!mtl->IsEmissive()) Error( "None of the rgb components are larger than 1, material is not emissive!" );
 		if (twoSided) mtl->flags |= HostMaterial::EMISSIVE_TWOSIDED;
-		materialIdx = HostScene::AddMaterial( mtl );
+		materialIdx = HostScene::FindOrAddMaterial( mtl );
+		if (HostScene::materials[materialIdx] != mtl) delete mtl;
 	}
 	else
 	{
+		// the material stays with the graphics state, also when an identical material is used instead
 		auto mtl = graphicsState.GetMaterialForShape( params );
-		materialIdx = HostScene::AddMaterial( mtl );
+		materialIdx = HostScene::FindOrAddMaterial( mtl );
 	}
 	// Initialize _prims_ and _areaLights_ for static shape
 	// Create shapes for shape _name_
@@ -836,6 +893,12 @@ void pbrtShape( const std::string& name, const ParamSet& params )
 	// Transform* WorldToObj = transformCache.Lookup( Inverse( curTransform[0] ) );
 	Transform ObjToWorld = curTransform[0];
 	Transform WorldToObj = curTransform[0].Inverted();
+	if (name == "plymesh")
+	{
+		pendingPLYMeshes.push_back( { params.FindOneFilename( "filename", "" ), ObjToWorld, materialIdx, currentInstance } );
+		params.ReportUnused();
+		return;
+	}
 	auto hostMesh = MakeShapes( name, &ObjToWorld, &WorldToObj,
 		graphicsState.reverseOrientation, params, materialIdx );
 	// if ( shapes.empty() ) return;
@@ -852,14 +915,7 @@ void pbrtShape( const std::string& name, const ParamSet& params )
 	prims.push_back(
 		std::make_shared<GeometricPrimitive>( s, mtl, area, mi ) );
 #endif
-	auto meshIdx = HostScene::AddMesh( hostMesh );
-	HostNode* newNode = new HostNode( meshIdx, ObjToWorld );
-	// Add _prims_ and _areaLights_ to scene or current instance
-	if (currentInstance)
-		// Abusing HostNode instance (this is not an instance of the mesh _yet_)
-		// because it keeps track of the transform.
-		currentInstance->push_back( newNode );
-	else HostScene::AddInstance( newNode );
+	AddShapeNode( hostMesh, ObjToWorld, currentInstance );
 }
 
 // Attempt to determine if the ParamSet for a shape may provide a value for
@@ -919,7 +975,8 @@ void pbrtObjectBegin( const std::string& name )
 	VERIFY_WORLD( "ObjectBegin" );
 	pbrtAttributeBegin();
 	if (currentInstance) Error( "ObjectBegin called inside of instance definition" );
-	instances[name] = std::vector<HostNode*>();
+	if (instances.find( name ) != instances.end()) LoadPendingPLYMeshes(); // pending shapes may refer to the old definition
+	instances[name] = std::vector<ObjectShape>();
 	currentInstance = &instances[name];
 	if (PbrtOptions.cat || PbrtOptions.toPly) printf( "%*sObjectBegin \"%s\"\n", catIndentCount, "", name.c_str() );
 }
@@ -952,6 +1009,7 @@ void pbrtObjectInstance( const std::string& name )
 		Error( "Unable to find instance named \"%s\"", name.c_str() );
 		return;
 	}
+	LoadPendingPLYMeshes();
 	auto& in = instances[name];
 	if (in.empty()) return;
 	// static_assert( MaxTransforms == 2,
@@ -966,12 +1024,21 @@ void pbrtObjectInstance( const std::string& name )
 	// std::shared_ptr<Primitive> prim(
 	// 	std::make_shared<TransformedPrimitive>( in[0], animatedInstanceToWorld ) );
 	// primitives.push_back( prim );
-	for (auto& mesh : in) HostScene::AddInstance( new HostNode( *mesh ) );
+	// a single shape becomes a single node; otherwise the shapes are children of a node that
+	// holds the instance transform
+	if (in.size() == 1)
+	{
+		HostScene::AddInstance( new HostNode( in[0].meshID, curTransform[0] * in[0].transform ) );
+		return;
+	}
+	const int rootID = HostScene::AddInstance( new HostNode( -1, curTransform[0] ) );
+	for (const ObjectShape& shape : in) HostScene::AddChildNode( rootID, new HostNode( shape.meshID, shape.transform ) );
 }
 
 void pbrtWorldEnd()
 {
 	VERIFY_WORLD( "WorldEnd" );
+	LoadPendingPLYMeshes();
 	// Ensure there are no pushed graphics states
 	while (pushedGraphicsStates.size())
 	{
@@ -649,6 +649,38 @@ struct ParamListItem
 	bool isString = false;
 };
 
+// Scratch memory for the values of a parameter list. The parser resets it after each parameter,
+// so long scene files do not accumulate memory; blocks beyond the first are released at that point.
+class ParamArena
+{
+public:
+	ParamArena() { blocks.push_back( Block( blockSize ) ); }
+	template <typename T> T* Alloc( size_t n )
+	{
+		const size_t bytes = (n * sizeof( T ) + 15) & ~(size_t)15;
+		while (current < blocks.size() && offset + bytes > blocks[current].size) current++, offset = 0;
+		if (current == blocks.size()) blocks.push_back( Block( std::max( blockSize, bytes ) ) );
+		T* p = (T*)(blocks[current].data.get() + offset);
+		offset += bytes;
+		return p;
+	}
+	void Reset()
+	{
+		blocks.erase( blocks.begin() + 1, blocks.end() );
+		current = offset = 0;
+	}
+private:
+	struct Block
+	{
+		Block( size_t n ) : data( new char[n] ), size( n ) {}
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+	static constexpr size_t blockSize = 256 * 1024;
+	std::vector<Block> blocks;
+	size_t current = 0, offset = 0;
+};
+
 PBRT_CONSTEXPR int TokenOptional = 0;
 PBRT_CONSTEXPR int TokenRequired = 1;
 
@@ -950,7 +982,7 @@ static void AddParam( ParamSet& ps, const ParamListItem& item, SpectrumType spec
 }
 
 template <typename Next, typename Unget>
-ParamSet parseParams( Next nextToken, Unget ungetToken, SpectrumType spectrumType )
+ParamSet parseParams( Next nextToken, Unget ungetToken, ParamArena& arena, SpectrumType spectrumType )
 {
 	ParamSet ps;
 	while (true)
@@ -977,12 +1009,12 @@ ParamSet parseParams( Next nextToken, Unget ungetToken, SpectrumType spectrumTyp
 				if (item.size == nAlloc)
 				{
 					nAlloc = std::max<size_t>( 2 * item.size, 4 );
-					const char** newData = new const char*[nAlloc];
+					const char** newData = arena.Alloc<const char*>( nAlloc );
 					std::copy( item.stringValues, item.stringValues + item.size, newData );
 					item.stringValues = newData;
 				}
 				val = dequoteString( val );
-				char* buf = new char[val.size() + 1];
+				char* buf = arena.Alloc<char>( val.size() + 1 );
 				memcpy( buf, val.data(), val.size() );
 				buf[val.size()] = '\0';
 				item.stringValues[item.size++] = buf;
@@ -997,7 +1029,7 @@ ParamSet parseParams( Next nextToken, Unget ungetToken, SpectrumType spectrumTyp
 				if (item.size == nAlloc)
 				{
 					nAlloc = std::max<size_t>( 2 * item.size, 4 );
-					double* newData = new double[nAlloc];
+					double* newData = arena.Alloc<double>( nAlloc );
 					std::copy( item.doubleValues, item.doubleValues + item.size, newData );
 					item.doubleValues = newData;
 				}
@@ -1013,7 +1045,7 @@ ParamSet parseParams( Next nextToken, Unget ungetToken, SpectrumType spectrumTyp
 		}
 		else addVal( val );
 		AddParam( ps, item, spectrumType );
-		// arena.Reset();
+		arena.Reset();
 	}
 	return ps;
 }
@@ -1074,7 +1106,7 @@ static void parse( std::unique_ptr<Tokenizer> t )
 		ungetTokenSet = true;
 	};
 
-	// MemoryArena arena;
+	ParamArena arena;
 
 	// Helper function for pbrt API entrypoints that take a single string
 	// parameter and a ParamSet (e.g. pbrtShape()).
@@ -1084,7 +1116,7 @@ static void parse( std::unique_ptr<Tokenizer> t )
 		string_view token = nextToken( TokenRequired );
 		string_view dequoted = dequoteString( token );
 		std::string n = toString( dequoted );
-		ParamSet params = parseParams( nextToken, ungetToken, spectrumType );
+		ParamSet params = parseParams( nextToken, ungetToken, arena, spectrumType );
 		apiFunc( n, std::move( params ) );
 	};
 
@@ -381,6 +381,15 @@ void pbrtParseFile( std::string filename );
 void pbrtParseString( std::string str );
 
 // Creating meshes
+struct PLYData
+{
+	std::vector<int> indices;	// three per triangle; quads are split
+	std::vector<Point3f> vertices;
+	std::vector<Normal3f> normals;	// optional
+	std::vector<Point2f> uvs;	// optional
+};
+bool LoadPLY( const std::string& filename, PLYData& data );
+HostMesh* CreatePLYMesh( const PLYData& data, const int materialIdx );
 HostMesh* CreatePLYMesh( const Transform* o2w, const Transform* w2o, bool reverseOrientation,
 	const ParamSet& params, const int materialIdx, std::map<std::string, 
 	HostMaterial::ScalarValue*>* floatTextures = nullptr );
@@ -31,6 +31,7 @@
  */
 
 #include "materials/pbrt/pbrtparser.h"
+#include <sstream>
 
 #if defined( _MSC_VER )
 #pragma warning( disable : 4996 )
@@ -182,21 +183,178 @@ int rply_face_callback( p_ply_argument argument )
 	return 1;
 }
 
-HostMesh* CreatePLYMesh(
-	const Transform* o2w, const Transform* w2o, bool reverseOrientation, const ParamSet& params, 
-	const int materialIdx, map<string, HostMaterial::ScalarValue*>* floatTextures )
+// Binary little-endian PLY files with a fixed vertex layout are read straight from a mapped file.
+// Returns false if the file does not qualify, so that the caller can fall back to rply; 'error'
+// is set if the file qualifies but is invalid.
+struct PLYProperty { string name; int size, offset; bool isFloat; };
+
+static int PLYTypeSize( const string& type )
+{
+	if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") return 1;
+	if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") return 2;
+	if (type == "int" || type == "uint" || type == "int32" || type == "uint32" || type == "float" || type == "float32") return 4;
+	if (type == "double" || type == "float64") return 8;
+	return 0;
+}
+
+static bool ReadBinaryPLY( const string& filename, PLYData& data, bool& error )
+{
+	error = false;
+	MappedFile file( filename.c_str() );
+	if (!file.Valid() || file.size < 16 || memcmp( file.data, "ply", 3 )) return false;
+	// header
+	size_t pos = 0;
+	auto nextLine = [&]( string& line ) {
+		const size_t start = pos;
+		while (pos < file.size && file.data[pos] != '\n') pos++;
+		line.assign( (const char*)file.data + start, pos - start );
+		if (line.size() && line.back() == '\r') line.pop_back();
+		if (pos < file.size) pos++;
+		return pos < file.size;
+	};
+	string line, element;
+	long vertexCount = 0, faceCount = 0;
+	vector<PLYProperty> vertexProps;
+	int vertexStride = 0, faceBefore = 0, faceAfter = 0, countSize = 0, indexSize = 0;
+	bool binaryLE = false, faceList = false, seenVertex = false, seenFace = false;
+	while (nextLine( line ))
+	{
+		istringstream words( line );
+		string word;
+		words >> word;
+		if (word == "format") { string format; words >> format; binaryLE = format == "binary_little_endian"; }
+		else if (word == "element")
+		{
+			long count;
+			words >> element >> count;
+			// the data is read as one vertex block followed by one face block; other layouts use rply
+			if ((element == "vertex" && (seenVertex || seenFace)) || (element == "face" && (!seenVertex || seenFace))) return false;
+			if (element == "vertex") vertexCount = count, seenVertex = true;
+			else if (element == "face") faceCount = count, seenFace = true;
+			else if (count > 0) return false; // other elements: use rply
+		}
+		else if (word == "property")
+		{
+			string type, name;
+			words >> type;
+			if (type == "list")
+			{
+				string count, index;
+				words >> count >> index >> name;
+				// one vertex index list per face, with 32-bit indices
+				if (element != "face" || faceList || (name != "vertex_indices" && name != "vertex_index") || PLYTypeSize( index ) != 4) return false;
+				countSize = PLYTypeSize( count ), indexSize = 4, faceList = true;
+				if (countSize == 0 || countSize == 8) return false;
+				continue;
+			}
+			words >> name;
+			const int size = PLYTypeSize( type );
+			if (size == 0) return false;
+			if (element == "vertex")
+			{
+				vertexProps.push_back( { name, size, vertexStride, type == "float" || type == "float32" } );
+				vertexStride += size;
+			}
+			else if (element == "face") (faceList ? faceAfter : faceBefore) += size;
+		}
+		else if (word == "end_header") break;
+	}
+	if (!binaryLE || line != "end_header" || !faceList || vertexCount <= 0 || faceCount <= 0) return false;
+	// vertex attributes; the fast path needs them as floats
+	auto find = [&]( const char* name ) -> const PLYProperty* {
+		for (const auto& prop : vertexProps) if (prop.name == name) return &prop;
+		return nullptr;
+	};
+	const PLYProperty* p[3] = { find( "x" ), find( "y" ), find( "z" ) };
+	const PLYProperty* n[3] = { find( "nx" ), find( "ny" ), find( "nz" ) };
+	const PLYProperty* t[2] = { nullptr, nullptr };
+	const char* uvNames[4][2] = { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } };
+	for (int i = 0; i < 4 && !t[0]; i++) if (find( uvNames[i][0] ) && find( uvNames[i][1] )) t[0] = find( uvNames[i][0] ), t[1] = find( uvNames[i][1] );
+	if (!p[0] || !p[1] || !p[2]) return false;
+	const bool hasNormals = n[0] && n[1] && n[2], hasUvs = t[0] != nullptr;
+	for (int i = 0; i < 3; i++) if (!p[i]->isFloat || (hasNormals && !n[i]->isFloat) || (hasUvs && i < 2 && !t[i]->isFloat)) return false;
+	const uchar* vertexData = file.data + pos;
+	if (file.size - pos < (size_t)vertexCount * vertexStride) { error = true; return true; }
+	data.vertices.resize( vertexCount );
+	if (hasNormals) data.normals.resize( vertexCount );
+	if (hasUvs) data.uvs.resize( vertexCount );
+	const int blockSize = 65536;
+	if (vertexStride == 12 && p[0]->offset == 0 && p[1]->offset == 4 && p[2]->offset == 8) memcpy( data.vertices.data(), vertexData, vertexCount * 12 );
+	else ParallelFor( 0, (int)((vertexCount + blockSize - 1) / blockSize), [&]( int block ) {
+		for (long i = (long)block * blockSize, last = min( vertexCount, i + blockSize ); i < last; i++)
+		{
+			const uchar* v = vertexData + i * vertexStride;
+			memcpy( &data.vertices[i].x, v + p[0]->offset, 4 ), memcpy( &data.vertices[i].y, v + p[1]->offset, 4 ), memcpy( &data.vertices[i].z, v + p[2]->offset, 4 );
+			if (hasNormals) memcpy( &data.normals[i].x, v + n[0]->offset, 4 ), memcpy( &data.normals[i].y, v + n[1]->offset, 4 ), memcpy( &data.normals[i].z, v + n[2]->offset, 4 );
+			if (hasUvs) memcpy( &data.uvs[i].x, v + t[0]->offset, 4 ), memcpy( &data.uvs[i].y, v + t[1]->offset, 4 );
+		}
+	} );
+	// faces; if the size of the face block matches an all-triangle layout, faces are copied in parallel
+	const uchar* faceData = vertexData + (size_t)vertexCount * vertexStride;
+	const size_t faceBytes = file.size - (faceData - file.data), triStride = faceBefore + countSize + 3 * indexSize + faceAfter;
+	atomic<bool> invalid( false ), irregular( false );
+	auto readCount = [&]( const uchar* c ) { uint count = 0; memcpy( &count, c, countSize ); return count; };
+	if (faceBytes == faceCount * triStride)
+	{
+		data.indices.resize( faceCount * 3 );
+		ParallelFor( 0, (int)((faceCount + blockSize - 1) / blockSize), [&]( int block ) {
+			for (long i = (long)block * blockSize, last = min( faceCount, i + blockSize ); i < last; i++)
+			{
+				const uchar* f = faceData + i * triStride + faceBefore;
+				if (readCount( f ) != 3) { irregular = true; return; }
+				memcpy( &data.indices[i * 3], f + countSize, 12 );
+			}
+		} );
+	}
+	if (faceBytes != faceCount * triStride || irregular)
+	{
+		// variable face sizes: walk the faces; quads are split, other polygons are skipped
+		data.indices.clear();
+		data.indices.reserve( faceCount * 3 );
+		const uchar* f = faceData, *end = file.data + file.size;
+		for (long i = 0; i < faceCount; i++)
+		{
+			if (f + faceBefore + countSize > end) { error = true; return true; }
+			const uint count = readCount( f + faceBefore );
+			const int* idx = (const int*)(f + faceBefore + countSize);
+			f += faceBefore + countSize + count * indexSize + faceAfter;
+			if (f > end) { error = true; return true; }
+			int face[4];
+			if (count == 3 || count == 4) memcpy( face, idx, count * 4 );
+			if (count == 3) data.indices.insert( data.indices.end(), face, face + 3 );
+			else if (count == 4)
+			{
+				const int quad[6] = { face[0], face[1], face[2], face[3], face[0], face[2] };
+				data.indices.insert( data.indices.end(), quad, quad + 6 );
+			}
+			else Warning( "plymesh: Ignoring face with %i vertices (only triangles and quads are supported!)", (int)count );
+		}
+	}
+	ParallelFor( 0, (int)((data.indices.size() + blockSize - 1) / blockSize), [&]( int block ) {
+		for (size_t i = (size_t)block * blockSize, last = min( data.indices.size(), i + blockSize ); i < last; i++)
+			if (data.indices[i] < 0 || data.indices[i] >= vertexCount) invalid = true;
+	} );
+	if (invalid)
+	{
+		Error( "plymesh: Vertex reference out of bounds in %s", filename.c_str() );
+		error = true;
+	}
+	return true;
+}
+
+// generic path: rply, with a callback per property value
+static bool ReadPLYWithRply( const string& filename, PLYData& data )
 {
-	const string filename = params.FindOneFilename( "filename", "" );
 	p_ply ply = ply_open( filename.c_str(), rply_message_callback, 0, nullptr );
 	if (!ply)
 	{
 		Error( "Couldn't open PLY file \"%s\"", filename.c_str() );
-		return nullptr;
+		return false;
 	}
 	if (!ply_read_header( ply ))
 	{
 		Error( "Unable to read the header of PLY file \"%s\"", filename.c_str() );
-		return nullptr;
+		return false;
 	}
 
 	p_ply_element element = nullptr;
@@ -215,7 +373,7 @@ HostMesh* CreatePLYMesh(
 	if (vertexCount == 0 || faceCount == 0)
 	{
 		Error( "%s: PLY file is invalid! No face/vertex elements found!", filename.c_str() );
-		return nullptr;
+		return false;
 	}
 
 	CallbackContext context;
@@ -229,7 +387,7 @@ HostMesh* CreatePLYMesh(
 	else
 	{
 		Error( "%s: Vertex coordinate property not found!", filename.c_str() );
-		return nullptr;
+		return false;
 	}
 
 	if (ply_set_read_cb( ply, "vertex", "nx", rply_vertex_callback, &context, 0x130 ) &&
@@ -260,11 +418,34 @@ HostMesh* CreatePLYMesh(
 	{
 		Error( "%s: unable to read the contents of PLY file", filename.c_str() );
 		ply_close( ply );
-		return nullptr;
+		return false;
 	}
 	ply_close( ply );
-	if (context.error) return nullptr;
+	if (context.error) return false;
+	data.indices.assign( context.indices, context.indices + context.indexCtr );
+	data.vertices.assign( context.p, context.p + vertexCount );
+	if (context.n) data.normals.assign( context.n, context.n + vertexCount );
+	if (context.uv) data.uvs.assign( context.uv, context.uv + vertexCount );
+	return true;
+}
 
+// read a PLY file; safe to call from multiple threads
+bool LoadPLY( const string& filename, PLYData& data )
+{
+	Timer timer;
+	bool error;
+	if (ReadBinaryPLY( filename, data, error ))
+	{
+		if (error) Error( "%s: unable to read the contents of PLY file", filename.c_str() );
+		else printf( "loaded %s (binary) in %5.3fs\n", filename.c_str(), timer.elapsed() );
+		return !error;
+	}
+	data = PLYData();
+	return ReadPLYWithRply( filename, data );
+}
+
+HostMesh* CreatePLYMesh( const PLYData& data, const int materialIdx )
+{
 #if 0
 	// Look up an alpha texture, if applicable
 	HostMaterial::Vec3Value alphaTex;
@@ -293,19 +474,22 @@ HostMesh* CreatePLYMesh(
 	const vector<HostMesh::Pose> noPose;
 	const vector<uint4> noJoints;
 	const vector<float4> noWeights;
-
-	vector<int> indices( context.indices, context.indices + context.indexCtr );
-	vector<Point3f> vertices( context.p, context.p + vertexCount );
-	vector<Normal3f> normals;
-	if (context.n) normals = { context.n, context.n + vertexCount };
-	vector<Point2f> uvs, uv2s /* second layer uvs not used for this type of mesh */;
-	if (context.uv) uvs = { context.uv, context.uv + vertexCount };
-	vector<float4> dummyT;
-	mesh->BuildFromIndexedData( indices, vertices, normals, uvs, uv2s, dummyT, noPose, noJoints, noWeights, materialIdx );
-
+	const vector<Point2f> uv2s /* second layer uvs not used for this type of mesh */;
+	const vector<float4> dummyT;
+	mesh->BuildFromIndexedData( data.indices, data.vertices, data.normals, data.uvs, uv2s, dummyT, noPose, noJoints, noWeights, materialIdx );
 	return mesh;
 }
 
+HostMesh* CreatePLYMesh(
+	const Transform* o2w, const Transform* w2o, bool reverseOrientation, const ParamSet& params, 
+	const int materialIdx, map<string, HostMaterial::ScalarValue*>* floatTextures )
+{
+	const string filename = params.FindOneFilename( "filename", "" );
+	PLYData data;
+	if (!LoadPLY( filename, data )) return nullptr;
+	return CreatePLYMesh( data, materialIdx );
+}
+
 HostMesh* CreateTriangleMeshShape(
 	const Transform* o2w, const Transform* w2o, bool reverseOrientation,
 	const ParamSet& params, const int materialIdx,
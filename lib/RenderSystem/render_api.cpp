@@ -86,6 +86,21 @@ int RenderAPI::AddScene( const char* file, const mat4& transform )
 	return renderer->scene->AddScene( file, transform );
 }
 
+int RenderAPI::AddSceneAsync( const char* file, const char* dir, const mat4& transform )
+{
+	return renderer->scene->AddSceneAsync( file, dir, transform );
+}
+
+bool RenderAPI::SceneLoaded( const int handle )
+{
+	return renderer->scene->SceneLoaded( handle );
+}
+
+int RenderAPI::CommitScene( const int handle )
+{
+	return renderer->scene->CommitScene( handle );
+}
+
 int RenderAPI::AddQuad( const float3 N, const float3 pos, const float width, const float height, const int material, const int meshID )
 {
 	return renderer->scene->AddQuad( N, pos, width, height, material, meshID );
@@ -121,6 +136,22 @@ void RenderAPI::UpdateAnimation( const int animId, const float dt )
 	renderer->scene->UpdateAnimation( animId, dt );
 }
 
+void RenderAPI::UpdateAnimations( const float dt )
+{
+	renderer->scene->UpdateAnimations( dt );
+}
+
+void RenderAPI::BakeAnimations( const float rate )
+{
+	renderer->scene->BakeAnimations( rate );
+}
+
+void RenderAPI::SetAnimationLOD( const vector<AnimationLOD>& tiers, const AnimationLOD& offscreen )
+{
+	renderer->scene->animationLOD = tiers;
+	renderer->scene->offscreenAnimationLOD = offscreen;
+}
+
 int RenderAPI::AnimationCount()
 {
 	return renderer->scene->AnimationCount();
@@ -232,6 +263,11 @@ void RenderAPI::SetProbePos( const int2 pos )
 	renderer->SetProbePos( pos );
 }
 
+void RenderAPI::RequestTextureLevel( const int texId, const uint level )
+{
+	renderer->streamer.Request( texId, level );
+}
+
 CoreStats RenderAPI::GetCoreStats() const
 {
 	return renderer->GetCoreStats();
@@ -40,6 +40,9 @@ public:
 	int AddMesh( const char* file, const float scale = 1.0f, const bool flatShaded = false );
 	int AddScene( const char* file, const char* dir, const mat4& transform = mat4::Identity() );
 	int AddScene( const char* file, const mat4& transform = mat4::Identity() );
+	int AddSceneAsync( const char* file, const char* dir, const mat4& transform = mat4::Identity() );
+	bool SceneLoaded( const int handle );
+	int CommitScene( const int handle );
 	int AddMesh( const int triCount );
 	void AddTriToMesh( const int meshId, const float3& v0, const float3& v1, const float3& v2, const int matId );
 	int AddQuad( const float3 N, const float3 pos, const float width, const float height, const int material, const int meshID = -1 );
@@ -49,6 +52,9 @@ public:
 	const mat4& GetNodeTransform( const int nodeId );
 	void ResetAnimation( const int animId );
 	void UpdateAnimation( const int animId, const float dt );
+	void UpdateAnimations( const float dt );
+	void BakeAnimations( const float rate = 30 );
+	void SetAnimationLOD( const vector<AnimationLOD>& tiers, const AnimationLOD& offscreen );
 	int AnimationCount();
 	void SynchronizeSceneData();
 	void Render( Convergence converge, bool async = false );
@@ -71,6 +77,7 @@ public:
 	int AddDirectionalLight( const float3 direction, const float3 radiance, bool enabled = true );
 	void SetTarget( GLTexture* tex, const uint spp );
 	void SetProbePos( const int2 pos );
+	void RequestTextureLevel( const int texId, const uint level );
 	CoreStats GetCoreStats() const;
 	SystemStats GetSystemStats();
 };
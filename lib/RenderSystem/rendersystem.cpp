@@ -45,33 +45,110 @@ void RenderSystem::SetTarget( GLTexture* target, const uint spp )
 //  |  RenderSystem::SynchronizeSky                                               |
 //  |  Detect changes to the skydome. If a change is found, send the new data to  |
 //  |  the core. Note: does not detect changes to pixel data. When this data is   |
-//  |  modified, 'MarkAsDirty' should be called on the sky dome object.     LH2'19|
+//  |  modified, 'MarkAsDirty' should be called on the sky dome object.           |
+//  |  The importance sampling table is only built for cores that use it.   LH2'19|
 //  +-----------------------------------------------------------------------------+
 void RenderSystem::SynchronizeSky()
 {
+	const bool wantsSampler = scene->sky && core->WantsSkySampler();
+	if (wantsSampler) scene->sky->GetSamplingTable(); // builds the table once; before the change check, as this modifies the sky
 	if (scene->sky && scene->sky->Changed())
 	{
 		// send sky data to core
 		HostSkyDome* sky = scene->sky;
-		core->SetSkyData( sky->pixels, sky->width, sky->height, sky->worldToLight );
+		if (wantsSampler && sky->samplingTable) core->SetSkySampler( sky->samplingTable, IBLWIDTH, IBLHEIGHT );
+		if (!sky->halfPixels) core->SetSkyData( sky->pixels, sky->width, sky->height, sky->worldToLight );
+		else if (!core->SetSkyDataHalf( sky->halfPixels, sky->width, sky->height, sky->worldToLight ))
+		{
+			// core takes float3 sky data only; expand temporarily
+			const int texels = sky->width * sky->height;
+			vector<float4> rgba( texels );
+			vector<float3> rgb( texels );
+			HalfToFloat( sky->halfPixels, (float*)rgba.data(), texels * 4 );
+			for (int i = 0; i < texels; i++) rgb[i] = make_float3( rgba[i] );
+			core->SetSkyData( rgb.data(), sky->width, sky->height, sky->worldToLight );
+		}
 	}
 }
 
 //  +-----------------------------------------------------------------------------+
 //  |  RenderSystem::SynchronizeTextures                                          |
-//  |  Detect changes to the textures. TODO: currently, the system always sends   |
-//  |  all textures to the core whenever any of them changes.               LH2'19|
+//  |  Detect changes to the textures. The system sends all texture descriptors   |
+//  |  to the core whenever any of them changes; CoreTexDesc::version tells the   |
+//  |  core which texels actually changed.                                        |
+//  |  With a texture budget, the streamer first adjusts the resident MIP levels. |
+//  |  Without one, HostTexture::releaseAfterUpload drops the host texels once    |
+//  |  the core has them, if the core skips unchanged textures; those are then    |
+//  |  resent without texels, and only changed textures are restored.       LH2'19|
 //  +-----------------------------------------------------------------------------+
 void RenderSystem::SynchronizeTextures()
 {
 	bool texturesDirty = false;
-	for (auto texture : scene->textures) if (texture->Changed()) texturesDirty = true;
+	for (auto texture : scene->textures) if (!streamer.Pending( texture->ID )) texture->Compress(); // no-op unless HostTexture::compression is set
+	if (settings.textureBudget > 0)
+	{
+		// the cores take texture dimensions from the materials; resend those if textures were resized
+		if (streamer.Update( settings.textureBudget )) for (auto material : scene->materials) material->MarkAsDirty();
+	}
+	coreTextureVersion.resize( scene->textures.size(), 0 );
+	vector<bool> changed( scene->textures.size(), false );
+	for (size_t i = 0; i < scene->textures.size(); i++) if (scene->textures[i]->Changed()) coreTextureVersion[i] = ++textureChanges, changed[i] = texturesDirty = true;
 	if (texturesDirty)
 	{
-		// send texture data to core
+		// send texture data to core; a core that skips unchanged textures only gets the texels of changed ones
 		vector<CoreTexDesc> gpuTex;
-		for (auto texture : scene->textures) gpuTex.push_back( texture->ConvertToCoreTexDesc() );
+		vector<vector<float4>> expanded; // half precision textures, for cores that do not take them
+		vector<vector<uint>> decoded; // block compressed textures, idem
+		const bool acceptsHalf = core->AcceptsTexelStorage( TexelStorage::ARGB64 );
+		const bool skipsUnchanged = core->SkipsUnchangedTextures();
+		for (size_t i = 0; i < scene->textures.size(); i++)
+		{
+			HostTexture* texture = scene->textures[i];
+			const bool sendTexels = changed[i] || !skipsUnchanged;
+			if (sendTexels) texture->Restore(); // no-op unless released
+			CoreTexDesc desc = texture->ConvertToCoreTexDesc();
+			desc.version = coreTextureVersion[i];
+			if (!sendTexels) desc.bdata = 0; // the core has this version; the layout must still match
+			if (desc.storage == TexelStorage::ARGB64 && !acceptsHalf)
+			{
+				const uint texels = texture->width * texture->height;
+				if (sendTexels)
+				{
+					expanded.push_back( vector<float4>( texels ) );
+					HalfToFloat( desc.hdata, (float*)expanded.back().data(), texels * 4 );
+					desc.fdata = expanded.back().data();
+				}
+				desc.storage = TexelStorage::ARGB128, desc.pixelCount = texels, desc.MIPlevels = 1;
+			}
+			else if (IsBlockCompressed( desc.storage ) && !core->AcceptsTexelStorage( desc.storage ))
+			{
+				if (sendTexels)
+				{
+					decoded.push_back( vector<uint>( desc.pixelCount ) );
+					uint* dst = decoded.back().data();
+					const uchar* src = desc.bdata;
+					for (uint i = 0, w = desc.width, h = desc.height; i < desc.MIPlevels; i++)
+					{
+						DecodeBCLevel( src, w, h, desc.storage, dst );
+						dst += w * h, src += BCLevelBytes( w, h, desc.storage );
+						w = max( 1u, w >> 1 ), h = max( 1u, h >> 1 );
+					}
+					desc.idata = (uchar4*)decoded.back().data();
+				}
+				desc.storage = desc.storage == TexelStorage::BC5 ? TexelStorage::NRM32 : TexelStorage::ARGB32;
+			}
+			gpuTex.push_back( desc );
+		}
 		core->SetTextures( gpuTex.data(), (int)gpuTex.size() );
+		// the streamer reads the texels of every texture each frame; releasing only applies without it
+		if (HostTexture::releaseAfterUpload && skipsUnchanged && settings.textureBudget == 0)
+			for (auto texture : scene->textures) texture->Release();
+	}
+	// memory accounting
+	if (settings.textureBudget > 0) stats.textureBytes = streamer.ResidentBytes(), stats.releasedTextureBytes = 0; else
+	{
+		stats.textureBytes = 0, stats.releasedTextureBytes = 0;
+		for (auto texture : scene->textures) stats.textureBytes += texture->TexelBytes(), stats.releasedTextureBytes += texture->releasedBytes;
 	}
 }
 
@@ -103,20 +180,30 @@ void RenderSystem::SynchronizeMaterials()
 
 //  +-----------------------------------------------------------------------------+
 //  |  RenderSystem::SynchronizeMeshes                                            |
-//  |  Detect changes to scene models. Note: right now, if a single model was     |
-//  |  modified, all geometry is sent to the core. This works fine when all       |
-//  |  geometry is initialized at once, but for more dynamic scenes we will need  |
-//  |  a better system.                                                     LH2'19|
+//  |  Detect changes to scene models. Meshes that were only re-posed (skinning,  |
+//  |  morph targets) since the last sync send just their vertex positions and    |
+//  |  normals, if the core supports this. Otherwise the full mesh is sent.       |
+//  |                                                                       LH2'20|
 //  +-----------------------------------------------------------------------------+
 void RenderSystem::SynchronizeMeshes()
 {
+	coreVertexCount.resize( scene->meshPool.size(), -1 );
 	for (int s = (int)scene->meshPool.size(), modelIdx = 0; modelIdx < s; modelIdx++)
 	{
 		HostMesh* mesh = scene->meshPool[modelIdx];
 		if (mesh->Changed())
 		{
+			const uint streams = mesh->poseStreams;
+			mesh->poseStreams = 0;
 			mesh->MarkAsNotDirty();
-			core->SetGeometry( modelIdx, mesh->vertices.data(), (int)mesh->vertices.size(), (int)mesh->triangles.size(), (CoreTri*)mesh->triangles.data() );
+			const int vertexCount = (int)mesh->vertices.size();
+			const float3* normals = (streams & HostMesh::NORMALS) ? mesh->vertexNormals.data() : 0;
+			if (!(streams & HostMesh::POSITIONS) || coreVertexCount[modelIdx] != vertexCount ||
+				!core->UpdateGeometry( modelIdx, mesh->vertices.data(), normals, vertexCount ))
+			{
+				core->SetGeometry( modelIdx, mesh->vertices.data(), vertexCount, (int)mesh->triangles.size(), (CoreTri*)mesh->triangles.data() );
+				coreVertexCount[modelIdx] = vertexCount;
+			}
 			meshesChanged = true; // trigger scene graph update
 		}
 	}
@@ -141,6 +228,9 @@ void RenderSystem::UpdateSceneGraph()
 		mat4 T;
 		instancesChanged |= node->Update( T /* start with an identity matrix */, instances, instanceCount );
 	}
+	HostScene::UpdateMorphTargets();
+	// skinned instances may have created pose copies; the core must have these before it gets the instances
+	if (scene->meshPool.size() > coreVertexCount.size()) SynchronizeMeshes();
 	stats.sceneUpdateTime = timer.elapsed();
 	// synchronize instances to device if anything changed
 	if (instancesChanged || meshesChanged || instances.size() != instanceCount)
@@ -153,7 +243,7 @@ void RenderSystem::UpdateSceneGraph()
 			HostNode* node = HostScene::nodePool[instances[instanceIdx]];
 			node->instanceID = instanceIdx;
 			int dummy = node->Changed(); // prevent superfluous update in the next frame
-			core->SetInstance( instanceIdx, node->meshID, node->combinedTransform );
+			core->SetInstance( instanceIdx, node->RenderMeshID(), node->combinedTransform );
 		}
 		core->SetInstance( instanceCount, -1 );
 		meshesChanged = false;
@@ -162,34 +252,105 @@ void RenderSystem::UpdateSceneGraph()
 	core->FinalizeInstances();
 }
 
+// helper: find the changed lights in a list of point, spot or directional lights. Returns false
+// if the set of lights that the core received changed, in which case all lights must be resent.
+template <class T> static bool FindChangedLights( const vector<T*>& lights, const vector<int>& coreIdx, vector<int>& changed )
+{
+	bool sameSet = lights.size() == coreIdx.size();
+	for (int s = (int)lights.size(), i = 0; i < s; i++) if (lights[i]->Changed())
+	{
+		if (!sameSet || lights[i]->enabled != (coreIdx[i] > -1)) sameSet = false;
+		else if (lights[i]->enabled) changed.push_back( i );
+	}
+	return sameSet;
+}
+
+// helper: send changed lights to the core, batched in runs of consecutive core light indices.
+template <class H, class C, class F> static bool SendChangedLights( const vector<H*>& lights, vector<int>& changed,
+	const vector<int>& coreIdx, C( H::* convert )(), F update )
+{
+	sort( changed.begin(), changed.end() );
+	changed.erase( unique( changed.begin(), changed.end() ), changed.end() );
+	vector<C> data;
+	for (int s = (int)changed.size(), i = 0; i < s; )
+	{
+		const int first = coreIdx[changed[i]];
+		data.clear();
+		do data.push_back( (lights[changed[i]]->*convert)() ); while (++i < s && coreIdx[changed[i]] == first + (int)data.size());
+		if (!update( first, data.data(), (int)data.size() )) return false;
+	}
+	return true;
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  RenderSystem::SynchronizeLights                                            |
-//  |  Detect changes to the lights. Note: light data is small, so we can safely  |
-//  |  send all data when something changes.                                LH2'19|
+//  |  Detect changes to the lights. If only light properties changed, just the   |
+//  |  modified lights are sent to the core. Adding, removing, enabling or        |
+//  |  disabling lights, or a core without support for partial updates, causes    |
+//  |  all light data to be sent.                                           LH2'20|
 //  +-----------------------------------------------------------------------------+
 void RenderSystem::SynchronizeLights()
 {
-	bool lightsDirty = false;
-	for (auto light : scene->triLights) if (light->Changed()) lightsDirty = true;
-	for (auto light : scene->pointLights) if (light->Changed()) lightsDirty = true;
-	for (auto light : scene->spotLights) if (light->Changed()) lightsDirty = true;
-	for (auto light : scene->directionalLights) if (light->Changed()) lightsDirty = true;
-	if (lightsDirty)
+	// find changed lights; tri lights are reported explicitly, see HostScene::MarkTriLightDirty
+	bool rebuild = scene->triLightListChanged || scene->triLights.size() != coreTriLightIdx.size();
+	vector<int> changedTri, changedPoint, changedSpot, changedDirectional;
+	if (!rebuild) for (int handle : scene->dirtyTriLights)
+	{
+		const int idx = scene->GetTriLightIndex( handle );
+		if (scene->triLights[idx]->enabled != (coreTriLightIdx[idx] > -1)) rebuild = true;
+		else if (scene->triLights[idx]->enabled) changedTri.push_back( idx );
+	}
+	rebuild |= !FindChangedLights( scene->pointLights, corePointLightIdx, changedPoint );
+	rebuild |= !FindChangedLights( scene->spotLights, coreSpotLightIdx, changedSpot );
+	rebuild |= !FindChangedLights( scene->directionalLights, coreDirectionalLightIdx, changedDirectional );
+	scene->dirtyTriLights.clear();
+	scene->triLightListChanged = false;
+	// send just the modified lights, if the core supports this
+	if (!rebuild)
+	{
+		if (SendChangedLights( scene->triLights, changedTri, coreTriLightIdx, &HostTriLight::ConvertToCoreLightTri,
+			[this]( const int first, const CoreLightTri* data, const int count ) { return core->UpdateTriLights( first, data, count ); } ) &&
+			SendChangedLights( scene->pointLights, changedPoint, corePointLightIdx, &HostPointLight::ConvertToCorePointLight,
+			[this]( const int first, const CorePointLight* data, const int count ) { return core->UpdatePointLights( first, data, count ); } ) &&
+			SendChangedLights( scene->spotLights, changedSpot, coreSpotLightIdx, &HostSpotLight::ConvertToCoreSpotLight,
+			[this]( const int first, const CoreSpotLight* data, const int count ) { return core->UpdateSpotLights( first, data, count ); } ) &&
+			SendChangedLights( scene->directionalLights, changedDirectional, coreDirectionalLightIdx, &HostDirectionalLight::ConvertToCoreDirectionalLight,
+			[this]( const int first, const CoreDirectionalLight* data, const int count ) { return core->UpdateDirectionalLights( first, data, count ); } ))
+			return;
+	}
+	// send all lights to core; disabled lights are skipped, so record where each light ends up
+	vector<CoreLightTri> gpuTriLights;
+	vector<CorePointLight> gpuPointLights;
+	vector<CoreSpotLight> gpuSpotLights;
+	vector<CoreDirectionalLight> gpuDirectionalLights;
+	coreTriLightIdx.resize( scene->triLights.size() );
+	corePointLightIdx.resize( scene->pointLights.size() );
+	coreSpotLightIdx.resize( scene->spotLights.size() );
+	coreDirectionalLightIdx.resize( scene->directionalLights.size() );
+	for (int s = (int)scene->triLights.size(), i = 0; i < s; i++)
+	{
+		coreTriLightIdx[i] = scene->triLights[i]->enabled ? (int)gpuTriLights.size() : -1;
+		if (scene->triLights[i]->enabled) gpuTriLights.push_back( scene->triLights[i]->ConvertToCoreLightTri() );
+	}
+	for (int s = (int)scene->pointLights.size(), i = 0; i < s; i++)
+	{
+		corePointLightIdx[i] = scene->pointLights[i]->enabled ? (int)gpuPointLights.size() : -1;
+		if (scene->pointLights[i]->enabled) gpuPointLights.push_back( scene->pointLights[i]->ConvertToCorePointLight() );
+	}
+	for (int s = (int)scene->spotLights.size(), i = 0; i < s; i++)
+	{
+		coreSpotLightIdx[i] = scene->spotLights[i]->enabled ? (int)gpuSpotLights.size() : -1;
+		if (scene->spotLights[i]->enabled) gpuSpotLights.push_back( scene->spotLights[i]->ConvertToCoreSpotLight() );
+	}
+	for (int s = (int)scene->directionalLights.size(), i = 0; i < s; i++)
 	{
-		// send lights to core
-		vector<CoreLightTri> gpuTriLights;
-		vector<CorePointLight> gpuPointLights;
-		vector<CoreSpotLight> gpuSpotLights;
-		vector<CoreDirectionalLight> gpuDirectionalLights;
-		for (auto light : scene->triLights) if (light->enabled) gpuTriLights.push_back( light->ConvertToCoreLightTri() );
-		for (auto light : scene->pointLights) if (light->enabled) gpuPointLights.push_back( light->ConvertToCorePointLight() );
-		for (auto light : scene->spotLights) if (light->enabled) gpuSpotLights.push_back( light->ConvertToCoreSpotLight() );
-		for (auto light : scene->directionalLights) if (light->enabled) gpuDirectionalLights.push_back( light->ConvertToCoreDirectionalLight() );
-		core->SetLights( gpuTriLights.data(), (int)gpuTriLights.size(),
-			gpuPointLights.data(), (int)gpuPointLights.size(),
-			gpuSpotLights.data(), (int)gpuSpotLights.size(),
-			gpuDirectionalLights.data(), (int)gpuDirectionalLights.size() );
+		coreDirectionalLightIdx[i] = scene->directionalLights[i]->enabled ? (int)gpuDirectionalLights.size() : -1;
+		if (scene->directionalLights[i]->enabled) gpuDirectionalLights.push_back( scene->directionalLights[i]->ConvertToCoreDirectionalLight() );
 	}
+	core->SetLights( gpuTriLights.data(), (int)gpuTriLights.size(),
+		gpuPointLights.data(), (int)gpuPointLights.size(),
+		gpuSpotLights.data(), (int)gpuSpotLights.size(),
+		gpuDirectionalLights.data(), (int)gpuDirectionalLights.size() );
 }
 
 //  +-----------------------------------------------------------------------------+
@@ -292,6 +453,8 @@ int RenderSystem::GetTriangleNode( const int coreInstId, const int coreTriId )
 //  +-----------------------------------------------------------------------------+
 void RenderSystem::Shutdown()
 {
+	// stop background texture jobs; these reference scene textures
+	streamer.Shutdown();
 	// delete scene
 	delete scene;
 	// shutdown core
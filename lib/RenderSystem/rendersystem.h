@@ -44,6 +44,7 @@ typedef int tinygltfMaterial;
 typedef int tinyobjMaterial;
 #endif
 #include "host_texture.h"
+#include "host_streaming.h"
 #include "host_material.h"
 #include "host_mesh.h"
 #include "host_light.h"
@@ -69,6 +70,7 @@ struct RenderSettings
 	float filterIndirectClamp = 2.5f;
 	uint filterEnabled = 1;
 	uint TAAEnabled = 1;
+	size_t textureBudget = 0;				// bytes of texels in host memory; 0 disables texture streaming
 };
 
 //  +-----------------------------------------------------------------------------+
@@ -105,9 +107,17 @@ private:
 	CoreAPI_Base* core = nullptr;			// low-level rendering functionality
 	GLTexture* renderTarget = nullptr;		// CUDA will render to this OpenGL texture
 	bool meshesChanged = false;				// rebuild scene graph if a mesh was rebuilt / refit
+	vector<int> coreVertexCount;			// per mesh: vertex count sent to the core via SetGeometry; -1 if not sent yet
+	vector<uint> coreTextureVersion;		// per texture: CoreTexDesc::version, bumped when the texels change
+	uint textureChanges = 0;				// source of texture versions
+	vector<int> coreTriLightIdx;			// per host light: position in the core light array; -1 if not sent (disabled)
+	vector<int> corePointLightIdx;			// idem, for point lights
+	vector<int> coreSpotLightIdx;			// idem, for spot lights
+	vector<int> coreDirectionalLightIdx;	// idem, for directional lights
 	SystemStats stats;						// performance counters
 	vector<int> instances;					// node indices that have been sent to the core as instances
 public:
+	TextureStreamer streamer;				// texture residency, see RenderSettings::textureBudget
 	// public data members
 	HostScene* scene = nullptr;				// scene I/O and management module
 	RenderSettings settings;				// render settings container
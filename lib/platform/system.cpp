@@ -36,6 +36,8 @@ extern "C"
 #include <sys/stat.h>
 #ifndef WIN32
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #endif
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -277,6 +279,68 @@ void TextFileWrite( const string& text, const char* _File )
 	s.write( text.c_str(), len );
 }
 
+bool RenameFile( const char* from, const char* to )
+{
+#ifdef WIN32
+	return MoveFileExA( from, to, MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+	return rename( from, to ) == 0; // atomic on POSIX
+#endif
+}
+
+uint64_t FileStamp( const char* f )
+{
+	struct stat s;
+	if (stat( f, &s )) return 0;
+	const uint64_t stamp[2] = { (uint64_t)s.st_size, (uint64_t)s.st_mtime };
+	return calccrc64( (uchar*)stamp, sizeof( stamp ) );
+}
+
+//  +-----------------------------------------------------------------------------+
+//  |  MappedFile                                                                 |
+//  |  Maps a file into memory, read-only. Invalid if the file is missing or      |
+//  |  empty.                                                               LH2'20|
+//  +-----------------------------------------------------------------------------+
+MappedFile::MappedFile( const char* fileName )
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+	if (file == INVALID_HANDLE_VALUE) return;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx( file, &length ) && length.QuadPart > 0)
+	{
+		HANDLE mapping = CreateFileMapping( file, 0, PAGE_READONLY, 0, 0, 0 );
+		if (mapping)
+		{
+			data = (const uchar*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+			if (data) size = (size_t)length.QuadPart;
+			CloseHandle( mapping ); // the view keeps the mapping alive
+		}
+	}
+	CloseHandle( file );
+#else
+	int fd = open( fileName, O_RDONLY );
+	if (fd == -1) return;
+	struct stat s;
+	if (fstat( fd, &s ) == 0 && s.st_size > 0)
+	{
+		void* ptr = mmap( 0, s.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		if (ptr != MAP_FAILED) data = (const uchar*)ptr, size = s.st_size;
+	}
+	close( fd );
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	if (!data) return;
+#ifdef WIN32
+	UnmapViewOfFile( data );
+#else
+	munmap( (void*)data, size );
+#endif
+}
+
 string LowerCase( string s )
 {
 	transform( s.begin(), s.end(), s.begin(), ::tolower );
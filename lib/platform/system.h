@@ -20,11 +20,14 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <half.hpp>
 #ifdef _MSC_VER
+#include <intrin.h>
 #include <ppl.h>
 #endif
 #include <string>
@@ -40,6 +43,8 @@ using namespace half_float;
 #include "../RenderSystem/common_settings.h"
 #include "../RenderSystem/common_classes.h"
 #include "../RenderSystem/common_functions.h"
+#include "../RenderSystem/common_bcn.h"
+#include "../RenderSystem/common_texelpool.h"
 #include <GLFW/glfw3.h>		// needed for Timer class
 
 // https://devblogs.microsoft.com/cppblog/msvc-preprocessor-progress-towards-conformance/
@@ -79,6 +84,57 @@ struct Timer
 __inline float sqr( const float x ) { return x * x; }
 template <class T> void Swap( T& x, T& y ) { T t; t = x; x = y; y = t; }
 
+// parallel for loop over [first, last); uses PPL on Windows, a set of std::threads elsewhere
+template <class F> void ParallelFor( const int first, const int last, const F& f )
+{
+#ifdef _MSC_VER
+	concurrency::parallel_for<int>( first, last, f );
+#else
+	const int threadCount = min( last - first, (int)thread::hardware_concurrency() );
+	if (threadCount < 2) { for (int i = first; i < last; i++) f( i ); return; }
+	atomic<int> next( first );
+	vector<thread> workers;
+	for (int t = 0; t < threadCount; t++) workers.push_back( thread( [&]() { for (int i = next++; i < last; i = next++) f( i ); } ) );
+	for (auto& worker : workers) worker.join();
+#endif
+}
+
+// bulk float to half conversion, e.g. for RGBA16F texels; values beyond the half range are clamped.
+// F16C is not part of AVX: MSVC emits the instructions regardless, so the CPU is checked at run time;
+// other compilers use them when the build targets F16C. Otherwise, the half library converts.
+#if defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#define F16C_CONVERSION
+inline bool CPUHasF16C()
+{
+	static const bool f16c = []() { int info[4]; __cpuid( info, 1 ); return (info[2] & (1 << 29)) != 0; }();
+	return f16c;
+}
+#elif defined( __F16C__ )
+#define F16C_CONVERSION
+inline bool CPUHasF16C() { return true; }
+#endif
+inline void FloatToHalf( const float* src, ushort* dst, const size_t count )
+{
+	size_t i = 0;
+#ifdef F16C_CONVERSION
+	const __m256 maxHalf = _mm256_set1_ps( 65504.0f ), minHalf = _mm256_set1_ps( -65504.0f );
+	if (CPUHasF16C()) for (; i + 8 <= count; i += 8)
+	{
+		const __m256 v = _mm256_max_ps( minHalf, _mm256_min_ps( maxHalf, _mm256_loadu_ps( src + i ) ) );
+		_mm_storeu_si128( (__m128i*)(dst + i), _mm256_cvtps_ph( v, _MM_FROUND_TO_NEAREST_INT ) );
+	}
+#endif
+	for (; i < count; i++) dst[i] = (ushort)detail::float2half<(std::float_round_style)HALF_ROUND_STYLE>( max( -65504.0f, min( 65504.0f, src[i] ) ) );
+}
+inline void HalfToFloat( const ushort* src, float* dst, const size_t count )
+{
+	size_t i = 0;
+#ifdef F16C_CONVERSION
+	if (CPUHasF16C()) for (; i + 8 <= count; i += 8) _mm256_storeu_ps( dst + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(src + i) ) ) );
+#endif
+	for (; i < count; i++) dst[i] = detail::half2float<float>( src[i] );
+}
+
 // crc64, from https://sourceforge.net/projects/crc64/
 #define UINT64C(x) ((uint64_t) x##ULL)
 #define CLEARCRC64 (UINT64C( 0xffffffffffffffff ))
@@ -166,6 +222,32 @@ void MarkAsDirty() { dirty++; } \
 void MarkAsNotDirty() { Changed(); } \
 private: uint64_t crc64 = CLEARCRC64; uint dirty = 0; \
 
+// fast 64-bit hash for comparing large buffers, after xxHash64 (Yann Collet); eight bytes per step
+// instead of one for calccrc64. Deterministic, so it also names cache files, see HostTexture::ContentHash.
+inline uint64_t FastHash64( const void* data, const size_t bytes, const uint64_t seed = 0 )
+{
+	const uint64_t P1 = UINT64C( 0x9E3779B185EBCA87 ), P2 = UINT64C( 0xC2B2AE3D27D4EB4F ), P3 = UINT64C( 0x165667B19E3779F9 );
+	const uint64_t P4 = UINT64C( 0x85EBCA77C2B2AE63 ), P5 = UINT64C( 0x27D4EB2F165667C5 );
+	auto rotl = []( const uint64_t x, const int r ) { return (x << r) | (x >> (64 - r)); };
+	auto round = [&]( const uint64_t acc, const uint64_t v ) { return rotl( acc + v * P2, 31 ) * P1; };
+	const unsigned char* p = (const unsigned char*)data, * end = p + bytes;
+	uint64_t h, w;
+	if (bytes >= 32)
+	{
+		// four independent lanes
+		uint64_t v[4] = { seed + P1 + P2, seed + P2, seed, seed - P1 };
+		for (; p + 32 <= end; p += 32) for (int i = 0; i < 4; i++) memcpy( &w, p + i * 8, 8 ), v[i] = round( v[i], w );
+		h = rotl( v[0], 1 ) + rotl( v[1], 7 ) + rotl( v[2], 12 ) + rotl( v[3], 18 );
+		for (int i = 0; i < 4; i++) h = (h ^ round( 0, v[i] )) * P1 + P4;
+	}
+	else h = seed + P5;
+	h += bytes;
+	for (; p + 8 <= end; p += 8) memcpy( &w, p, 8 ), h = rotl( h ^ round( 0, w ), 27 ) * P1 + P4;
+	for (; p < end; p++) h = rotl( h ^ (*p * P5), 11 ) * P1;
+	h ^= h >> 33, h *= P2, h ^= h >> 29, h *= P3;
+	return h ^ (h >> 32);
+}
+
 // rng
 uint RandomUInt();
 uint RandomUInt( uint& seed );
@@ -182,10 +264,26 @@ bool FileExists( const char* f );
 bool RemoveFile( const char* f );
 string TextFileRead( const char* _File );
 void TextFileWrite( const string& text, const char* _File );
+bool RenameFile( const char* from, const char* to ); // replaces 'to' if it exists
+uint64_t FileStamp( const char* f ); // size and modification time; 0 if the file does not exist
 string LowerCase( string s );
 void SerializeString( string s, FILE* f );
 string DeserializeString( FILE* f );
 
+// read-only memory mapped file
+class MappedFile
+{
+public:
+	MappedFile( const char* fileName );
+	~MappedFile();
+	bool Valid() const { return data != 0; }
+	const uchar* data = 0;
+	size_t size = 0;
+private:
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator = ( const MappedFile& ) = delete;
+};
+
 // globally accessible classes
 namespace lighthouse2
 {
@@ -431,6 +431,26 @@ void RenderCore::FinalizeInstances()
 	gpuHasSceneData = true;
 }
 
+// helper: make room for 'size' texels, keeping the current contents; returns true if the buffer was replaced
+template <class T> static bool ReserveTexels( CoreBuffer<T>*& buffer, const uint size )
+{
+	if (buffer && buffer->GetSize() >= size) return false;
+	uint64_t capacity = max( (uint64_t)16 /* OptiX does not tolerate empty buffers... */, (uint64_t)size );
+	if (buffer) capacity = max( capacity, buffer->GetSize() + (buffer->GetSize() >> 1) ); // grow by 50%, so growing is rare
+	CoreBuffer<T>* grown = new CoreBuffer<T>( capacity, ON_HOST | ON_DEVICE | STAGED );
+	if (buffer) memcpy( grown->HostPtr(), buffer->HostPtr(), buffer->GetSizeInBytes() );
+	delete buffer;
+	buffer = grown;
+	return true;
+}
+
+// helper: copy the texels of one texture to its range; the device copy is skipped if the full buffer follows
+template <class T> static void CopyTexels( CoreBuffer<T>* buffer, const CoreTexDesc& desc, const bool toDevice )
+{
+	memcpy( buffer->HostPtr() + desc.firstPixel, desc.idata, desc.pixelCount * sizeof( T ) );
+	if (toDevice) buffer->CopyToDevice( desc.firstPixel, desc.pixelCount );
+}
+
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::SetTextures                                                    |
 //  |  Set the texture data.                                                LH2'19|
@@ -440,6 +460,7 @@ void RenderCore::SetTextures( const CoreTexDesc* tex, const int textures )
 	// copy the supplied array of texture descriptors
 	delete texDescs; texDescs = 0;
 	textureCount = textures;
+	for (int i = 0; i < 3; i++) texelPool[i].Trim( textureCount );
 	if (textureCount == 0) return; // scene has no textures
 	texDescs = new CoreTexDesc[textureCount];
 	memcpy( texDescs, tex, textureCount * sizeof( CoreTexDesc ) );
@@ -452,53 +473,45 @@ void RenderCore::SetTextures( const CoreTexDesc* tex, const int textures )
 //  +-----------------------------------------------------------------------------+
 //  |  RenderCore::SyncStorageType                                                |
 //  |  Copies texel data for one storage type (argb32, argb128 or nrm32) to the   |
-//  |  device. Note that this data is obtained from the original HostTexture      |
+//  |  device. Each texture keeps its range of the buffer, see TexelPool, so only |
+//  |  new and changed textures are copied; the full buffer is sent only when it  |
+//  |  grows. Note that this data is obtained from the original HostTexture       |
 //  |  texel arrays.                                                        LH2'19|
 //  +-----------------------------------------------------------------------------+
 void RenderCore::SyncStorageType( const TexelStorage storage )
 {
-	uint texelTotal = 0;
-	for (int i = 0; i < textureCount; i++) if (texDescs[i].storage == storage) texelTotal += texDescs[i].pixelCount;
-	texelTotal = max( 16, texelTotal ); // OptiX does not tolerate empty buffers...
-	// construct the continuous arrays
+	// find a range for each texture of this type
+	TexelPool& pool = texelPool[storage];
+	vector<int> changed;
+	for (int i = 0; i < textureCount; i++)
+	{
+		if (texDescs[i].storage != storage) { pool.Remove( i ); continue; }
+		if (pool.Place( i, texDescs[i].pixelCount, texDescs[i].version )) changed.push_back( i );
+		texDescs[i].firstPixel = pool.Offset( i );
+	}
+	// copy the changed textures; a grown buffer gets a new device pointer and a full copy
+	bool grown = false;
 	switch (storage)
 	{
 	case TexelStorage::ARGB32:
-		delete texel32Buffer;
-		texel32Buffer = new CoreBuffer<uint>( texelTotal, ON_HOST | ON_DEVICE | STAGED );
-		stageARGB32Pixels( texel32Buffer->DevPtr() );
-		coreStats.argb32TexelCount = texelTotal;
+		grown = ReserveTexels( texel32Buffer, pool.Size() );
+		for (const int i : changed) CopyTexels( texel32Buffer, texDescs[i], !grown );
+		if (grown) stageARGB32Pixels( texel32Buffer->DevPtr() ), texel32Buffer->StageCopyToDevice();
+		coreStats.argb32TexelCount = pool.Size();
 		break;
 	case TexelStorage::ARGB128:
-		delete texel128Buffer;
-		stageARGB128Pixels( (texel128Buffer = new CoreBuffer<float4>( texelTotal, ON_HOST | ON_DEVICE | STAGED ))->DevPtr() );
-		coreStats.argb128TexelCount = texelTotal;
+		grown = ReserveTexels( texel128Buffer, pool.Size() );
+		for (const int i : changed) CopyTexels( texel128Buffer, texDescs[i], !grown );
+		if (grown) stageARGB128Pixels( texel128Buffer->DevPtr() ), texel128Buffer->StageCopyToDevice();
+		coreStats.argb128TexelCount = pool.Size();
 		break;
 	case TexelStorage::NRM32:
-		delete normal32Buffer;
-		stageNRM32Pixels( (normal32Buffer = new CoreBuffer<uint>( texelTotal, ON_HOST | ON_DEVICE | STAGED ))->DevPtr() );
-		coreStats.nrm32TexelCount = texelTotal;
+		grown = ReserveTexels( normal32Buffer, pool.Size() );
+		for (const int i : changed) CopyTexels( normal32Buffer, texDescs[i], !grown );
+		if (grown) stageNRM32Pixels( normal32Buffer->DevPtr() ), normal32Buffer->StageCopyToDevice();
+		coreStats.nrm32TexelCount = pool.Size();
 		break;
 	}
-	// copy texel data to arrays
-	texelTotal = 0;
-	for (int i = 0; i < textureCount; i++) if (texDescs[i].storage == storage)
-	{
-		void* destination = 0;
-		switch (storage)
-		{
-		case TexelStorage::ARGB32:  destination = texel32Buffer->HostPtr() + texelTotal; break;
-		case TexelStorage::ARGB128: destination = texel128Buffer->HostPtr() + texelTotal; break;
-		case TexelStorage::NRM32:   destination = normal32Buffer->HostPtr() + texelTotal; break;
-		}
-		memcpy( destination, texDescs[i].idata, texDescs[i].pixelCount * sizeof( uint ) );
-		texDescs[i].firstPixel = texelTotal;
-		texelTotal += texDescs[i].pixelCount;
-	}
-	// move to device
-	if (storage == TexelStorage::ARGB32) if (texel32Buffer) texel32Buffer->StageCopyToDevice();
-	if (storage == TexelStorage::ARGB128) if (texel128Buffer) texel128Buffer->StageCopyToDevice();
-	if (storage == TexelStorage::NRM32) if (normal32Buffer) normal32Buffer->StageCopyToDevice();
 }
 
 //  +-----------------------------------------------------------------------------+
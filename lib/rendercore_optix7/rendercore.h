@@ -49,6 +49,7 @@ public:
 	// passing data. Note: RenderCore always copies what it needs; the passed data thus remains the
 	// property of the caller, and can be safely deleted or modified as soon as these calls return.
 	void SetTextures( const CoreTexDesc* tex, const int textureCount );
+	bool SkipsUnchangedTextures() const override { return true; }
 	void SetMaterials( CoreMaterial* mat, const int materialCount ); // textures must be in sync when calling this
 	void SetLights( const CoreLightTri* triLights, const int triLightCount,
 		const CorePointLight* pointLights, const int pointLightCount,
@@ -115,6 +116,7 @@ private:
 	CoreBuffer<OptixInstance>* instanceArray = 0;	// instance descriptors for Optix
 	CoreBuffer<Params>* optixParams;				// parameters to be used in optix code
 	CoreTexDesc* texDescs = 0;						// array of texture descriptors
+	TexelPool texelPool[3];							// ranges in texel buffers 0..2, see SyncStorageType
 	int textureCount = 0;							// size of texture descriptor array
 	int SMcount = 0;								// multiprocessor count, used for persistent threads
 	int computeCapability;							// device compute capability